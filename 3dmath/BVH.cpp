@@ -0,0 +1,807 @@
+#include <float.h>
+#include <string.h>
+#include <algorithm>
+#include "BVH.h"
+
+// Ranges larger than this are binned by all threads together and split into
+// subtrees that are then built one per thread
+#define BVH_PARALLEL_SIZE		32768
+#define BVH_PARALLEL_CHUNKS		64
+
+// Below this depth splits are forced to the median, which bounds the depth
+// of the tree and so the traversal stack
+#define BVH_MEDIAN_DEPTH		(BVH_MAX_DEPTH - 32)
+
+struct BVHBounds
+{
+	float min[3];
+	float max[3];
+
+	void Reset()
+	{
+		min[0] = min[1] = min[2] = FLT_MAX;
+		max[0] = max[1] = max[2] = -FLT_MAX;
+	}
+
+	void Grow(const float *lo, const float *hi)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			min[k] = lo[k] < min[k] ? lo[k] : min[k];
+			max[k] = hi[k] > max[k] ? hi[k] : max[k];
+		}
+	}
+
+	void Grow(const BVHBounds &b) { Grow(b.min, b.max); }
+
+	float HalfArea() const
+	{
+		float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+		return dx < 0.0f ? 0.0f : dx * dy + dy * dz + dz * dx;
+	}
+};
+
+struct BVHPrimitive
+{
+	BVHBounds bounds;
+	float centroid[3];
+};
+
+struct BVHBin
+{
+	BVHBounds bounds;
+	int count;
+};
+
+// Small ranges use fewer bins, down to one per triangle
+struct BVHBins
+{
+	BVHBin bin[3][BVH_BINS];
+	int count;
+
+	void Reset(int binCount)
+	{
+		count = binCount;
+		for (int axis = 0; axis < 3; axis++)
+			for (int i = 0; i < count; i++)
+			{
+				bin[axis][i].bounds.Reset();
+				bin[axis][i].count = 0;
+			}
+	}
+
+	void Merge(const BVHBins &b)
+	{
+		for (int axis = 0; axis < 3; axis++)
+			for (int i = 0; i < count; i++)
+			{
+				bin[axis][i].bounds.Grow(b.bin[axis][i].bounds);
+				bin[axis][i].count += b.bin[axis][i].count;
+			}
+	}
+};
+
+struct BVHBuildJob
+{
+	int slot;
+	int begin;
+	int end;
+	int depth;
+};
+
+// The tree is built into a sparse node array of two slots per triangle: the
+// children of a node split at position mid of the triangle order go to
+// slots 2 * mid and 2 * mid + 1. Split positions are unique, so subtrees
+// built in parallel never share a slot. The tree is compacted afterwards.
+struct BVHBuilder
+{
+	const BVHPrimitive *primitives;
+	unsigned int *order;
+	BVHNode *nodes;
+	int maxLeafSize;
+	std::vector<BVHBuildJob> jobs;
+};
+
+static inline void TriangleBounds(BVHBounds &bounds, const float *vertices, const unsigned int *indices, unsigned int triangle)
+{
+	bounds.Reset();
+	for (int k = 0; k < 3; k++)
+	{
+		const float *v = vertices + indices[triangle * 3 + k] * 3;
+		bounds.Grow(v, v);
+	}
+}
+
+static inline int BinIndex(float centroid, float lo, float scale, int bins)
+{
+	int bin = int((centroid - lo) * scale);
+	return bin < 0 ? 0 : (bin >= bins ? bins - 1 : bin);
+}
+
+// Bounds of the triangles and of their centroids over [begin, end)
+static void BoundsInto(BVHBounds &bounds, BVHBounds &centroids, const BVHBuilder &b, int begin, int end)
+{
+	bounds.Reset();
+	centroids.Reset();
+	for (int i = begin; i < end; i++)
+	{
+		const BVHPrimitive &p = b.primitives[b.order[i]];
+		bounds.Grow(p.bounds);
+		centroids.Grow(p.centroid, p.centroid);
+	}
+}
+
+static void RangeBounds(BVHBounds &bounds, BVHBounds &centroids, const BVHBuilder &b, int begin, int end, bool parallel)
+{
+	if (!parallel)
+	{
+		BoundsInto(bounds, centroids, b, begin, end);
+		return;
+	}
+
+	BVHBounds chunkBounds[BVH_PARALLEL_CHUNKS], chunkCentroids[BVH_PARALLEL_CHUNKS];
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int c = 0; c < BVH_PARALLEL_CHUNKS; c++)
+	{
+		int first = begin + int((long long)(end - begin) * c / BVH_PARALLEL_CHUNKS);
+		int last = begin + int((long long)(end - begin) * (c + 1) / BVH_PARALLEL_CHUNKS);
+		BoundsInto(chunkBounds[c], chunkCentroids[c], b, first, last);
+	}
+
+	bounds = chunkBounds[0];
+	centroids = chunkCentroids[0];
+	for (int c = 1; c < BVH_PARALLEL_CHUNKS; c++)
+	{
+		bounds.Grow(chunkBounds[c]);
+		centroids.Grow(chunkCentroids[c]);
+	}
+}
+
+static void BinInto(BVHBins &bins, int binCount, const BVHBuilder &b, const BVHBounds &centroids, const float scale[3], int begin, int end)
+{
+	bins.Reset(binCount);
+	for (int i = begin; i < end; i++)
+	{
+		const BVHPrimitive &p = b.primitives[b.order[i]];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			BVHBin &bin = bins.bin[axis][BinIndex(p.centroid[axis], centroids.min[axis], scale[axis], binCount)];
+			bin.bounds.Grow(p.bounds);
+			bin.count++;
+		}
+	}
+}
+
+static void BinRange(BVHBins &bins, int binCount, const BVHBuilder &b, const BVHBounds &centroids, const float scale[3], int begin, int end, bool parallel)
+{
+	if (!parallel)
+	{
+		BinInto(bins, binCount, b, centroids, scale, begin, end);
+		return;
+	}
+
+	std::vector<BVHBins> chunkBins(BVH_PARALLEL_CHUNKS);
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int c = 0; c < BVH_PARALLEL_CHUNKS; c++)
+	{
+		int first = begin + int((long long)(end - begin) * c / BVH_PARALLEL_CHUNKS);
+		int last = begin + int((long long)(end - begin) * (c + 1) / BVH_PARALLEL_CHUNKS);
+		BinInto(chunkBins[c], binCount, b, centroids, scale, first, last);
+	}
+
+	bins = chunkBins[0];
+	for (int c = 1; c < BVH_PARALLEL_CHUNKS; c++)
+		bins.Merge(chunkBins[c]);
+}
+
+// Cheapest binned split in units of triangle intersections, relative to a
+// traversal step; bestAxis is -1 if no split separates anything
+static float FindSplit(int &bestAxis, int &bestBin, const BVHBins &bins, float parentArea)
+{
+	float bestCost = FLT_MAX;
+	bestAxis = -1;
+	bestBin = 0;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		// Right side areas and counts, swept from the top bin down
+		float rightArea[BVH_BINS];
+		int rightCount[BVH_BINS];
+		BVHBounds right;
+		right.Reset();
+		int count = 0;
+		for (int i = bins.count - 1; i > 0; i--)
+		{
+			right.Grow(bins.bin[axis][i].bounds);
+			count += bins.bin[axis][i].count;
+			rightArea[i] = right.HalfArea();
+			rightCount[i] = count;
+		}
+
+		BVHBounds left;
+		left.Reset();
+		count = 0;
+		for (int i = 0; i < bins.count - 1; i++)
+		{
+			left.Grow(bins.bin[axis][i].bounds);
+			count += bins.bin[axis][i].count;
+			if (count == 0 || rightCount[i + 1] == 0)
+				continue;
+
+			float cost = left.HalfArea() * count + rightArea[i + 1] * rightCount[i + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = i;
+			}
+		}
+	}
+	return parentArea > 0.0f ? 1.0f + bestCost / parentArea : 1.0f;
+}
+
+struct CentroidLess
+{
+	const BVHPrimitive *primitives;
+	int axis;
+	bool operator()(unsigned int a, unsigned int b) const { return primitives[a].centroid[axis] < primitives[b].centroid[axis]; }
+};
+
+struct InLeftBin
+{
+	const BVHPrimitive *primitives;
+	int axis, bin, bins;
+	float lo, scale;
+	bool operator()(unsigned int t) const { return BinIndex(primitives[t].centroid[axis], lo, scale, bins) <= bin; }
+};
+
+static void BuildRange(BVHBuilder &b, int slot, int begin, int end, int depth, bool parallel)
+{
+	BVHBounds bounds, centroids;
+	RangeBounds(bounds, centroids, b, begin, end, parallel);
+
+	BVHNode &node = b.nodes[slot];
+	for (int k = 0; k < 3; k++)
+	{
+		node.min[k] = bounds.min[k];
+		node.max[k] = bounds.max[k];
+	}
+
+	int count = end - begin;
+	int longest = 0;
+	for (int k = 1; k < 3; k++)
+		if (centroids.max[k] - centroids.min[k] > centroids.max[longest] - centroids.min[longest])
+			longest = k;
+	bool flat = centroids.max[longest] <= centroids.min[longest];
+
+	int mid = -1;
+	bool median = false;
+	if (count == 1 || (flat && count <= b.maxLeafSize))
+		mid = -1;
+	else if (flat || depth >= BVH_MEDIAN_DEPTH)
+		median = true;
+	else
+	{
+		int binCount = count < BVH_BINS ? count : BVH_BINS;
+		float scale[3];
+		for (int k = 0; k < 3; k++)
+		{
+			float extent = centroids.max[k] - centroids.min[k];
+			scale[k] = extent > 0.0f ? binCount / extent : 0.0f;
+		}
+
+		BVHBins bins;
+		BinRange(bins, binCount, b, centroids, scale, begin, end, parallel);
+		int axis, bin;
+		float cost = FindSplit(axis, bin, bins, bounds.HalfArea());
+
+		if (axis >= 0 && (count > b.maxLeafSize || cost < float(count)))
+		{
+			InLeftBin inLeft = {b.primitives, axis, bin, binCount, centroids.min[axis], scale[axis]};
+			mid = int(std::partition(b.order + begin, b.order + end, inLeft) - b.order);
+		}
+		else if (count > b.maxLeafSize)
+			median = true;
+	}
+
+	// Median splits order the triangles along the longest axis first
+	if (median)
+	{
+		mid = begin + count / 2;
+		if (!flat)
+		{
+			CentroidLess less = {b.primitives, longest};
+			std::nth_element(b.order + begin, b.order + mid, b.order + end, less);
+		}
+	}
+
+	if (mid < 0)
+	{
+		node.offset = begin;
+		node.count = count;
+		return;
+	}
+
+	node.offset = 2 * mid;
+	node.count = 0;
+
+	int ranges[2][2] = {{begin, mid}, {mid, end}};
+	for (int k = 0; k < 2; k++)
+	{
+		int size = ranges[k][1] - ranges[k][0];
+		if (parallel && size > BVH_PARALLEL_SIZE)
+			BuildRange(b, 2 * mid + k, ranges[k][0], ranges[k][1], depth + 1, true);
+		else if (parallel)
+		{
+			BVHBuildJob job = {2 * mid + k, ranges[k][0], ranges[k][1], depth + 1};
+			b.jobs.push_back(job);
+		}
+		else
+			BuildRange(b, 2 * mid + k, ranges[k][0], ranges[k][1], depth + 1, false);
+	}
+}
+
+BVH::BVH() : m_nodes(NULL), m_nodeCount(0), m_vertices(NULL), m_indices(NULL)
+{
+
+}
+
+void BVH::Build(const M3DVector3f *vertices, const unsigned int *indices, int triangleCount, int maxLeafSize)
+{
+	m_vertices = vertices[0];
+	m_indices = indices;
+	m_order.resize(triangleCount);
+	m_nodes = NULL;
+	m_nodeCount = 0;
+	if (triangleCount <= 0)
+		return;
+
+	std::vector<BVHPrimitive> primitives(triangleCount);
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if(triangleCount > BVH_PARALLEL_SIZE)
+#endif
+	for (int i = 0; i < triangleCount; i++)
+	{
+		BVHPrimitive &p = primitives[i];
+		TriangleBounds(p.bounds, m_vertices, m_indices, i);
+		for (int k = 0; k < 3; k++)
+			p.centroid[k] = 0.5f * (p.bounds.min[k] + p.bounds.max[k]);
+		m_order[i] = i;
+	}
+
+	std::vector<BVHNode> sparse(2 * triangleCount);
+	BVHBuilder b;
+	b.primitives = &primitives[0];
+	b.order = &m_order[0];
+	b.nodes = &sparse[0];
+	b.maxLeafSize = maxLeafSize < 1 ? 1 : maxLeafSize;
+
+	// Slot 1 is never a child slot (a split at 0 separates nothing), use it
+	// for the root
+	BuildRange(b, 1, 0, triangleCount, 0, triangleCount > BVH_PARALLEL_SIZE);
+
+	int jobs = int(b.jobs.size());
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic, 1)
+#endif
+	for (int j = 0; j < jobs; j++)
+		BuildRange(b, b.jobs[j].slot, b.jobs[j].begin, b.jobs[j].end, b.jobs[j].depth, false);
+
+	// Compact depth first: root at 0, sibling pairs from 2 on
+	std::vector<BVHNode> compact;
+	compact.reserve(2 * triangleCount);
+	compact.push_back(sparse[1]);
+	compact.push_back(sparse[1]);
+
+	int stack[2 * BVH_MAX_DEPTH][2];
+	int top = 0;
+	stack[top][0] = 1;
+	stack[top][1] = 0;
+	top++;
+	while (top > 0)
+	{
+		top--;
+		int from = stack[top][0], to = stack[top][1];
+		if (sparse[from].count > 0)
+			continue;
+
+		int children = int(compact.size());
+		compact[to].offset = children;
+		for (int k = 0; k < 2; k++)
+		{
+			compact.push_back(sparse[sparse[from].offset + k]);
+			stack[top][0] = sparse[from].offset + k;
+			stack[top][1] = children + k;
+			top++;
+		}
+	}
+
+	m_nodeCount = int(compact.size());
+	m_storage.resize(m_nodeCount * sizeof(BVHNode) + 64);
+	size_t address = (size_t)&m_storage[0];
+	m_nodes = (BVHNode *)(&m_storage[0] + ((64 - address % 64) % 64));
+	memcpy(m_nodes, &compact[0], m_nodeCount * sizeof(BVHNode));
+}
+
+void BVH::Build(const CVector *vertices, const unsigned int *indices, int triangleCount, int maxLeafSize)
+{
+	Build(reinterpret_cast<const M3DVector3f *>(vertices), indices, triangleCount, maxLeafSize);
+}
+
+// Children always come after their parent, so one backward pass over the
+// nodes sees every child before its parent. Leaves, which hold all the
+// triangle work, are done in parallel first.
+void BVH::Refit(const M3DVector3f *vertices)
+{
+	m_vertices = vertices[0];
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if(m_nodeCount > BVH_PARALLEL_SIZE)
+#endif
+	for (int i = 0; i < m_nodeCount; i++)
+	{
+		BVHNode &node = m_nodes[i];
+		if (node.count == 0 || i == 1)
+			continue;
+
+		BVHBounds bounds, triangle;
+		bounds.Reset();
+		for (unsigned int k = 0; k < node.count; k++)
+		{
+			TriangleBounds(triangle, m_vertices, m_indices, m_order[node.offset + k]);
+			bounds.Grow(triangle);
+		}
+		memcpy(node.min, bounds.min, sizeof(node.min));
+		memcpy(node.max, bounds.max, sizeof(node.max));
+	}
+
+	for (int i = m_nodeCount - 1; i >= 0; i--)
+	{
+		BVHNode &node = m_nodes[i];
+		if (node.count > 0 || i == 1)
+			continue;
+
+		const BVHNode &left = m_nodes[node.offset], &right = m_nodes[node.offset + 1];
+		for (int k = 0; k < 3; k++)
+		{
+			node.min[k] = left.min[k] < right.min[k] ? left.min[k] : right.min[k];
+			node.max[k] = left.max[k] > right.max[k] ? left.max[k] : right.max[k];
+		}
+	}
+}
+
+void BVH::Refit(const CVector *vertices)
+{
+	Refit(reinterpret_cast<const M3DVector3f *>(vertices));
+}
+
+// Distance at which the ray enters the box, or FLT_MAX if it misses it
+// within [0, maxDistance]
+static inline float SlabTest(const BVHNode &node, const float origin[3], const float invDirection[3], float maxDistance)
+{
+	float tmin = 0.0f, tmax = maxDistance;
+	for (int k = 0; k < 3; k++)
+	{
+		float t0 = (node.min[k] - origin[k]) * invDirection[k];
+		float t1 = (node.max[k] - origin[k]) * invDirection[k];
+		// 0 * inf: parallel to the slab and on one of its planes, so inside
+		if (t0 != t0 || t1 != t1)
+			continue;
+		if (t0 > t1)
+		{
+			float t = t0;
+			t0 = t1;
+			t1 = t;
+		}
+		tmin = t0 > tmin ? t0 : tmin;
+		tmax = t1 < tmax ? t1 : tmax;
+	}
+	return tmin <= tmax ? tmin : FLT_MAX;
+}
+
+// Moller-Trumbore
+bool BVH::IntersectTriangle(BVHHit &hit, unsigned int triangle, const float origin[3], const float direction[3], float maxDistance) const
+{
+	const float *v0 = m_vertices + m_indices[triangle * 3] * 3;
+	const float *v1 = m_vertices + m_indices[triangle * 3 + 1] * 3;
+	const float *v2 = m_vertices + m_indices[triangle * 3 + 2] * 3;
+
+	M3DVector3f e1, e2, p, s, q;
+	m3dSubtractVectors3(e1, v1, v0);
+	m3dSubtractVectors3(e2, v2, v0);
+	m3dCrossProduct(p, direction, e2);
+	float det = m3dDotProduct(e1, p);
+	if (det == 0.0f)
+		return false;
+
+	float invDet = 1.0f / det;
+	m3dSubtractVectors3(s, origin, v0);
+	float u = m3dDotProduct(s, p) * invDet;
+	if (u < 0.0f || u > 1.0f)
+		return false;
+
+	m3dCrossProduct(q, s, e1);
+	float v = m3dDotProduct(direction, q) * invDet;
+	if (v < 0.0f || u + v > 1.0f)
+		return false;
+
+	float t = m3dDotProduct(e2, q) * invDet;
+	if (t < 0.0f || t > maxDistance)
+		return false;
+
+	hit.distance = t;
+	hit.triangle = triangle;
+	hit.u = u;
+	hit.v = v;
+	return true;
+}
+
+bool BVH::Intersect(BVHHit &hit, const M3DVector3f origin, const M3DVector3f direction, float maxDistance) const
+{
+	if (m_nodeCount == 0)
+		return false;
+
+	float invDirection[3] = {1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2]};
+	if (SlabTest(m_nodes[0], origin, invDirection, maxDistance) == FLT_MAX)
+		return false;
+
+	bool found = false;
+	int stack[BVH_MAX_DEPTH];
+	int top = 0;
+	int index = 0;
+	for (;;)
+	{
+		const BVHNode &node = m_nodes[index];
+		if (node.count > 0)
+		{
+			for (unsigned int k = 0; k < node.count; k++)
+				if (IntersectTriangle(hit, m_order[node.offset + k], origin, direction, maxDistance))
+				{
+					maxDistance = hit.distance;
+					found = true;
+				}
+		}
+		else
+		{
+			// Visit the nearer child first, the farther one may be culled
+			// by a hit in the nearer one
+			int left = node.offset;
+			float tl = SlabTest(m_nodes[left], origin, invDirection, maxDistance);
+			float tr = SlabTest(m_nodes[left + 1], origin, invDirection, maxDistance);
+			if (tl != FLT_MAX && tr != FLT_MAX)
+			{
+				index = tl <= tr ? left : left + 1;
+				stack[top++] = tl <= tr ? left + 1 : left;
+				continue;
+			}
+			if (tl != FLT_MAX || tr != FLT_MAX)
+			{
+				index = tl != FLT_MAX ? left : left + 1;
+				continue;
+			}
+		}
+
+		// Pop, skipping nodes that are now beyond the closest hit
+		for (;;)
+		{
+			if (top == 0)
+				return found;
+			index = stack[--top];
+			if (SlabTest(m_nodes[index], origin, invDirection, maxDistance) != FLT_MAX)
+				break;
+		}
+	}
+}
+
+bool BVH::Occluded(const M3DVector3f origin, const M3DVector3f direction, float maxDistance) const
+{
+	if (m_nodeCount == 0)
+		return false;
+
+	float invDirection[3] = {1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2]};
+	if (SlabTest(m_nodes[0], origin, invDirection, maxDistance) == FLT_MAX)
+		return false;
+
+	BVHHit hit;
+	int stack[BVH_MAX_DEPTH];
+	int top = 0;
+	int index = 0;
+	for (;;)
+	{
+		const BVHNode &node = m_nodes[index];
+		if (node.count > 0)
+		{
+			for (unsigned int k = 0; k < node.count; k++)
+				if (IntersectTriangle(hit, m_order[node.offset + k], origin, direction, maxDistance))
+					return true;
+		}
+		else
+		{
+			int left = node.offset;
+			bool hl = SlabTest(m_nodes[left], origin, invDirection, maxDistance) != FLT_MAX;
+			bool hr = SlabTest(m_nodes[left + 1], origin, invDirection, maxDistance) != FLT_MAX;
+			if (hl || hr)
+			{
+				if (hl && hr)
+					stack[top++] = left + 1;
+				index = hl ? left : left + 1;
+				continue;
+			}
+		}
+
+		if (top == 0)
+			return false;
+		index = stack[--top];
+	}
+}
+
+//---------------------------------------------------------------------------
+// Ray packets
+
+struct BVHPacket
+{
+	float origin[3][BVH_PACKET_SIZE];
+	float direction[3][BVH_PACKET_SIZE];
+	float invDirection[3][BVH_PACKET_SIZE];
+	float tmax[BVH_PACKET_SIZE];					// -1 for unused lanes
+};
+
+// Bit mask of the lanes whose ray enters the box within [0, tmax], and the
+// smallest entry distance of those. A ray parallel to a slab that starts on
+// one of its planes gives 0 * inf = NaN there, which min and max would turn
+// into a miss; as in SlabTest such a slab does not clip the lane.
+static inline unsigned int PacketSlabTest(float &entry, const BVHNode &node, const BVHPacket &p)
+{
+	entry = FLT_MAX;
+
+#if defined(M3D_AVX)
+	__m256 tmin = _mm256_setzero_ps(), tmax = _mm256_loadu_ps(p.tmax);
+	for (int k = 0; k < 3; k++)
+	{
+		__m256 o = _mm256_loadu_ps(p.origin[k]), inv = _mm256_loadu_ps(p.invDirection[k]);
+		__m256 t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.min[k]), o), inv);
+		__m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.max[k]), o), inv);
+		__m256 clips = _mm256_cmp_ps(t0, t1, _CMP_ORD_Q);
+		tmin = _mm256_blendv_ps(tmin, _mm256_max_ps(_mm256_min_ps(t0, t1), tmin), clips);
+		tmax = _mm256_blendv_ps(tmax, _mm256_min_ps(_mm256_max_ps(t0, t1), tmax), clips);
+	}
+	__m256 hit = _mm256_cmp_ps(tmin, tmax, _CMP_LE_OQ);
+	unsigned int mask = _mm256_movemask_ps(hit);
+	if (mask != 0)
+	{
+		__m256 t = _mm256_blendv_ps(_mm256_set1_ps(FLT_MAX), tmin, hit);
+		__m128 m = _mm_min_ps(_mm256_castps256_ps128(t), _mm256_extractf128_ps(t, 1));
+		m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+		entry = _mm_cvtss_f32(_mm_min_ss(m, _mm_shuffle_ps(m, m, 1)));
+	}
+	return mask;
+#elif defined(M3D_SSE2)
+	unsigned int mask = 0;
+	__m128 nearest = _mm_set1_ps(FLT_MAX);
+	for (int j = 0; j < BVH_PACKET_SIZE; j += 4)
+	{
+		__m128 tmin = _mm_setzero_ps(), tmax = _mm_loadu_ps(p.tmax + j);
+		for (int k = 0; k < 3; k++)
+		{
+			__m128 o = _mm_loadu_ps(p.origin[k] + j), inv = _mm_loadu_ps(p.invDirection[k] + j);
+			__m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.min[k]), o), inv);
+			__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.max[k]), o), inv);
+			__m128 clips = _mm_cmpord_ps(t0, t1);
+			tmin = _mm_or_ps(_mm_and_ps(clips, _mm_max_ps(_mm_min_ps(t0, t1), tmin)), _mm_andnot_ps(clips, tmin));
+			tmax = _mm_or_ps(_mm_and_ps(clips, _mm_min_ps(_mm_max_ps(t0, t1), tmax)), _mm_andnot_ps(clips, tmax));
+		}
+		__m128 hit = _mm_cmple_ps(tmin, tmax);
+		mask |= _mm_movemask_ps(hit) << j;
+		nearest = _mm_min_ps(nearest, _mm_or_ps(_mm_and_ps(hit, tmin), _mm_andnot_ps(hit, _mm_set1_ps(FLT_MAX))));
+	}
+	if (mask != 0)
+	{
+		nearest = _mm_min_ps(nearest, _mm_movehl_ps(nearest, nearest));
+		entry = _mm_cvtss_f32(_mm_min_ss(nearest, _mm_shuffle_ps(nearest, nearest, 1)));
+	}
+	return mask;
+#else
+	unsigned int mask = 0;
+	for (int j = 0; j < BVH_PACKET_SIZE; j++)
+	{
+		float origin[3] = {p.origin[0][j], p.origin[1][j], p.origin[2][j]};
+		float invDirection[3] = {p.invDirection[0][j], p.invDirection[1][j], p.invDirection[2][j]};
+		float t = SlabTest(node, origin, invDirection, p.tmax[j]);
+		if (t != FLT_MAX)
+		{
+			mask |= 1u << j;
+			entry = t < entry ? t : entry;
+		}
+	}
+	return mask;
+#endif
+}
+
+int BVH::Intersect(BVHHit *hits, const M3DRaySoA &rays, const float *maxDistance, int count) const
+{
+	int found = 0;
+
+	for (int first = 0; first < count; first += BVH_PACKET_SIZE)
+	{
+		int lanes = count - first < BVH_PACKET_SIZE ? count - first : BVH_PACKET_SIZE;
+
+		// Unused lanes repeat the first ray with a negative range, which
+		// never enters a box
+		BVHPacket p;
+		for (int j = 0; j < BVH_PACKET_SIZE; j++)
+		{
+			int i = first + (j < lanes ? j : 0);
+			for (int k = 0; k < 3; k++)
+			{
+				p.origin[k][j] = rays.origin[k][i];
+				p.direction[k][j] = rays.direction[k][i];
+				p.invDirection[k][j] = 1.0f / rays.direction[k][i];
+			}
+			p.tmax[j] = j < lanes ? maxDistance[i] : -1.0f;
+		}
+		for (int j = 0; j < lanes; j++)
+			hits[first + j].distance = -1.0f;
+
+		float entry;
+		unsigned int mask = m_nodeCount > 0 ? PacketSlabTest(entry, m_nodes[0], p) : 0;
+		int stack[BVH_MAX_DEPTH];
+		int top = 0;
+		int index = 0;
+		while (mask != 0)
+		{
+			const BVHNode &node = m_nodes[index];
+			if (node.count > 0)
+			{
+				for (int j = 0; j < lanes; j++)
+				{
+					if ((mask & (1u << j)) == 0)
+						continue;
+
+					float origin[3] = {p.origin[0][j], p.origin[1][j], p.origin[2][j]};
+					float direction[3] = {p.direction[0][j], p.direction[1][j], p.direction[2][j]};
+					for (unsigned int k = 0; k < node.count; k++)
+						if (IntersectTriangle(hits[first + j], m_order[node.offset + k], origin, direction, p.tmax[j]))
+							p.tmax[j] = hits[first + j].distance;
+				}
+			}
+			else
+			{
+				// Nearer child first as in the single ray traversal, by the
+				// first entry of any ray of the packet
+				int left = node.offset;
+				float tl, tr;
+				unsigned int ml = PacketSlabTest(tl, m_nodes[left], p);
+				unsigned int mr = PacketSlabTest(tr, m_nodes[left + 1], p);
+				if (ml != 0 && mr != 0)
+				{
+					index = tl <= tr ? left : left + 1;
+					mask = tl <= tr ? ml : mr;
+					stack[top++] = tl <= tr ? left + 1 : left;
+					continue;
+				}
+				if (ml != 0 || mr != 0)
+				{
+					index = ml != 0 ? left : left + 1;
+					mask = ml | mr;
+					continue;
+				}
+			}
+
+			// Pop, retesting against the hits found since the push
+			for (mask = 0; mask == 0 && top > 0; )
+			{
+				index = stack[--top];
+				mask = PacketSlabTest(entry, m_nodes[index], p);
+			}
+		}
+
+		for (int j = 0; j < lanes; j++)
+			if (hits[first + j].distance >= 0.0f)
+				found++;
+	}
+	return found;
+}
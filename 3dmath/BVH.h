@@ -0,0 +1,90 @@
+#ifndef BVH_H
+#define BVH_H
+#include <vector>
+#include "math3dBatch.h"
+#include "Vector.h"
+
+//---------------------------------------------------------------------------
+// class BVH
+//
+// Bounding volume hierarchy over an indexed triangle mesh, for ray casts.
+// The tree is built top down with the surface area heuristic evaluated on
+// binned centroids. The first levels bin in parallel; the subtrees below
+// them are built in parallel when the library is built with OpenMP.
+//
+// The BVH refers to the vertex and index arrays it was built from, which
+// must stay alive. After vertices move (skinning, morphing) Refit updates
+// the bounds without changing the tree, which is much cheaper than a
+// rebuild but degrades as the mesh deforms away from the built pose.
+
+#define BVH_BINS			16
+#define BVH_MAX_DEPTH		128
+#define BVH_PACKET_SIZE		8
+
+// 32 bytes. Node 0 is the root and node 1 is padding; from there on the two
+// children of a node are stored next to each other at an even index, so a
+// sibling pair shares one cache line.
+struct BVHNode
+{
+	float min[3];
+	unsigned int offset;		// inner: index of the left child, the right one follows
+								// leaf: first entry of the triangle order
+	float max[3];
+	unsigned int count;			// leaf: number of triangles, 0 for inner nodes
+};
+
+struct BVHHit
+{
+	float distance;				// in units of the ray direction
+	unsigned int triangle;
+	float u, v;					// barycentrics of vertices 1 and 2
+};
+
+class BVH
+{
+public:
+	BVH();
+
+	// Build over triangleCount triangles given as three vertex indices each.
+	// Leaves hold up to maxLeafSize triangles.
+	void Build(const M3DVector3f *vertices, const unsigned int *indices, int triangleCount, int maxLeafSize = 4);
+	void Build(const CVector *vertices, const unsigned int *indices, int triangleCount, int maxLeafSize = 4);
+
+	// Recompute the bounds for moved vertices, same indices as the build.
+	// vertices may be a different array than the one built from.
+	void Refit(const M3DVector3f *vertices);
+	void Refit(const CVector *vertices);
+
+	// Closest hit along origin + t * direction, 0 <= t <= maxDistance. The
+	// direction need not be unit length.
+	bool Intersect(BVHHit &hit, const M3DVector3f origin, const M3DVector3f direction, float maxDistance) const;
+
+	// Any hit in the same range, for shadow and visibility rays
+	bool Occluded(const M3DVector3f origin, const M3DVector3f direction, float maxDistance) const;
+
+	// Closest hits for count rays, traversed BVH_PACKET_SIZE at a time: a
+	// node is visited once for all rays of the packet that enter it, which
+	// pays off for coherent rays (camera or light samples, picking). Ray i
+	// is limited to maxDistance[i] and hits[i].distance is < 0 if it misses.
+	// Returns the number of rays that hit.
+	int Intersect(BVHHit *hits, const M3DRaySoA &rays, const float *maxDistance, int count) const;
+
+	const BVHNode *GetNodes() const { return m_nodes; }
+	int GetNodeCount() const { return m_nodeCount; }
+	const unsigned int *GetTriangleOrder() const { return m_order.empty() ? NULL : &m_order[0]; }
+
+private:
+	BVH(const BVH &);
+	const BVH &operator=(const BVH &);
+
+	bool IntersectTriangle(BVHHit &hit, unsigned int triangle, const float origin[3], const float direction[3], float maxDistance) const;
+
+	std::vector<char> m_storage;		// nodes, aligned to 64 bytes inside
+	BVHNode *m_nodes;
+	int m_nodeCount;
+	std::vector<unsigned int> m_order;	// triangles in leaf order
+	const float *m_vertices;
+	const unsigned int *m_indices;
+};
+
+#endif // BVH_H
@@ -0,0 +1,140 @@
+#include <math.h>
+#include <string.h>
+#include <stddef.h>
+#include "BlendShapes.h"
+#include "math3dBatch.h"
+
+// Vertices per work item. All targets are applied to one block before moving
+// on, so the block of positions stays in the cache.
+#define BLENDSHAPE_BLOCK_SIZE	4096
+
+int CompressBlendShape(unsigned int *indices, float *delta[3], const CVector *deltas, int vertexCount, float epsilon)
+{
+	int count = 0;
+	for (int i = 0; i < vertexCount; i++)
+	{
+		const CVector &d = deltas[i];
+		if (fabs(d.x) <= epsilon && fabs(d.y) <= epsilon && fabs(d.z) <= epsilon)
+			continue;
+
+		indices[count] = i;
+		delta[0][count] = d.x;
+		delta[1][count] = d.y;
+		delta[2][count] = d.z;
+		count++;
+	}
+	return count;
+}
+
+// First entry of the sorted indices that is >= value
+static int LowerBound(const unsigned int *indices, int count, unsigned int value)
+{
+	int first = 0;
+	while (count > 0)
+	{
+		int half = count / 2;
+		if (indices[first + half] < value)
+		{
+			first += half + 1;
+			count -= half + 1;
+		}
+		else
+			count = half;
+	}
+	return first;
+}
+
+// out += w * delta for entries [first, last) of one target. Runs of
+// consecutive vertex indices, which is what the deltas of a region of the
+// mesh usually look like, are added with full vector loads and stores; the
+// rest is scattered one vertex at a time.
+static void AccumulateTarget(float *out[3], const BlendShapeTarget &target, float w, int first, int last)
+{
+	const unsigned int *indices = target.indices;
+	int i = first;
+
+#if defined(M3D_AVX)
+	__m256 vw = _mm256_set1_ps(w);
+	for (; i + 8 <= last; i += 8)
+	{
+		unsigned int v = indices[i];
+		for (int k = 0; k < 3; k++)
+		{
+			__m256 d = _mm256_mul_ps(_mm256_loadu_ps(target.delta[k] + i), vw);
+			if (indices[i + 7] - v == 7)
+				_mm256_storeu_ps(out[k] + v, _mm256_add_ps(_mm256_loadu_ps(out[k] + v), d));
+			else
+			{
+				float scatter[8];
+				_mm256_storeu_ps(scatter, d);
+				for (int j = 0; j < 8; j++)
+					out[k][indices[i + j]] += scatter[j];
+			}
+		}
+	}
+#elif defined(M3D_SSE2)
+	__m128 vw = _mm_set1_ps(w);
+	for (; i + 4 <= last; i += 4)
+	{
+		unsigned int v = indices[i];
+		for (int k = 0; k < 3; k++)
+		{
+			__m128 d = _mm_mul_ps(_mm_loadu_ps(target.delta[k] + i), vw);
+			if (indices[i + 3] - v == 3)
+				_mm_storeu_ps(out[k] + v, _mm_add_ps(_mm_loadu_ps(out[k] + v), d));
+			else
+			{
+				float scatter[4];
+				_mm_storeu_ps(scatter, d);
+				for (int j = 0; j < 4; j++)
+					out[k][indices[i + j]] += scatter[j];
+			}
+		}
+	}
+#endif
+
+	for (; i < last; i++)
+	{
+		unsigned int v = indices[i];
+		out[0][v] += target.delta[0][i] * w;
+		out[1][v] += target.delta[1][i] * w;
+		out[2][v] += target.delta[2][i] * w;
+	}
+}
+
+static void ApplyBlendShapesRange(float *out[3], const float *base[3], const BlendShapeTarget *targets, const float *weights, int targetCount, int begin, int end)
+{
+	for (int k = 0; k < 3; k++)
+	{
+		if (out[k] != base[k])
+			memcpy(out[k] + begin, base[k] + begin, (end - begin) * sizeof(float));
+	}
+
+	for (int t = 0; t < targetCount; t++)
+	{
+		const BlendShapeTarget &target = targets[t];
+		if (weights[t] == 0.0f || target.count == 0)
+			continue;
+
+		int first = LowerBound(target.indices, target.count, begin);
+		int last = first + LowerBound(target.indices + first, target.count - first, end);
+		if (first < last)
+			AccumulateTarget(out, target, weights[t], first, last);
+	}
+}
+
+void ApplyBlendShapes(float *out[3], const float *base[3], int vertexCount,
+					  const BlendShapeTarget *targets, const float *weights, int targetCount)
+{
+	int blocks = (vertexCount + BLENDSHAPE_BLOCK_SIZE - 1) / BLENDSHAPE_BLOCK_SIZE;
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic) if(blocks > 1)
+#endif
+	for (int b = 0; b < blocks; b++)
+	{
+		int begin = b * BLENDSHAPE_BLOCK_SIZE;
+		int end = begin + BLENDSHAPE_BLOCK_SIZE < vertexCount ? begin + BLENDSHAPE_BLOCK_SIZE : vertexCount;
+		ApplyBlendShapesRange(out, base, targets, weights, targetCount, begin, end);
+	}
+}
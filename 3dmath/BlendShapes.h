@@ -0,0 +1,32 @@
+#ifndef BLENDSHAPES_H
+#define BLENDSHAPES_H
+#include "Vector.h"
+
+//---------------------------------------------------------------------------
+// Morph targets (blend shapes)
+//
+// A target only stores the vertices it moves: a sorted list of vertex
+// indices and one delta per index, as three float streams. Applying a set
+// of targets costs one pass over the base positions plus the deltas of the
+// targets with a non-zero weight, rather than targets * vertices.
+
+struct BlendShapeTarget
+{
+	const unsigned int *indices;	// ascending, no duplicates
+	const float *delta[3];
+	int count;
+};
+
+// Compress a dense target with one CVector per vertex into the sparse form,
+// dropping deltas with all components within epsilon of zero. indices and
+// delta[] need room for vertexCount entries; returns the number written.
+int CompressBlendShape(unsigned int *indices, float *delta[3], const CVector *deltas, int vertexCount, float epsilon);
+
+// out = base + sum(weights[t] * targets[t]) over vertexCount SoA positions.
+// out may be base to accumulate into the positions in place, which also
+// skips the copy. Large meshes are split into vertex ranges that are
+// processed in parallel when built with OpenMP.
+void ApplyBlendShapes(float *out[3], const float *base[3], int vertexCount,
+					  const BlendShapeTarget *targets, const float *weights, int targetCount);
+
+#endif // BLENDSHAPES_H
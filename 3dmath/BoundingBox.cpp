@@ -0,0 +1,370 @@
+#include <float.h>
+#include <math.h>
+#include "BoundingBox.h"
+#include "Matrix.h"
+
+// Guards the cross product axes of the OBB test against parallel edges,
+// whose cross products are near zero and would make any box pair disjoint
+#define OBB_EPSILON		1e-6f
+
+static inline const float &Component(const CVector &v, int k)
+{
+	return (&v.x)[k];
+}
+
+static inline float &Component(CVector &v, int k)
+{
+	return (&v.x)[k];
+}
+
+// Column k of the upper 3x3 block
+static inline CVector Column(const Matrix &mat, int k)
+{
+	return CVector(mat.m_data[k*4], mat.m_data[k*4+1], mat.m_data[k*4+2]);
+}
+
+// The matrix without its translation applied to a direction
+static inline CVector TransformDirection(const Matrix &mat, const CVector &v)
+{
+	return Column(mat, 0) * v.x + Column(mat, 1) * v.y + Column(mat, 2) * v.z;
+}
+
+// Complete the unit axes where valid[k] is false, from a zero column of a
+// flat or degenerate box, to a right-handed frame with the valid ones
+static void CompleteFrame(CVector axis[3], const bool valid[3])
+{
+	int count = int(valid[0]) + int(valid[1]) + int(valid[2]);
+	if (count == 3)
+		return;
+	if (count == 0)
+	{
+		axis[0] = CVector(1, 0, 0);
+		axis[1] = CVector(0, 1, 0);
+		axis[2] = CVector(0, 0, 1);
+		return;
+	}
+
+	// The odd one out: the valid axis of one, the missing axis of two
+	bool odd = count == 1;
+	int k = 0;
+	while (valid[k] != odd)
+		k++;
+	int k1 = (k + 1) % 3, k2 = (k + 2) % 3;
+	if (count == 1)
+	{
+		// Any perpendicular to the one axis, by way of the world axis least
+		// aligned with it
+		const CVector &a = axis[k];
+		CVector other = fabs(a.x) <= fabs(a.y) && fabs(a.x) <= fabs(a.z) ? CVector(1, 0, 0)
+					  : (fabs(a.y) <= fabs(a.z) ? CVector(0, 1, 0) : CVector(0, 0, 1));
+		axis[k1] = (a ^ other).UnitVector();
+		axis[k2] = a ^ axis[k1];
+	}
+	else
+		axis[k] = axis[k1] ^ axis[k2];
+}
+
+// Clip [tmin, tmax] by the slab lo <= origin + t * direction <= hi, with
+// invDirection = 1 / direction. False once the interval is empty.
+static inline bool ClipSlab(float &tmin, float &tmax, float lo, float hi, float origin, float invDirection)
+{
+	float t0 = (lo - origin) * invDirection;
+	float t1 = (hi - origin) * invDirection;
+	// 0 * inf: parallel to the slab and on one of its planes, so inside
+	if (t0 != t0 || t1 != t1)
+		return tmin <= tmax;
+	if (t0 > t1)
+	{
+		float t = t0;
+		t0 = t1;
+		t1 = t;
+	}
+	tmin = t0 > tmin ? t0 : tmin;
+	tmax = t1 < tmax ? t1 : tmax;
+	return tmin <= tmax;
+}
+
+// Squared distance of a coordinate from [-extent, extent]
+static inline float Excess2(float d, float extent)
+{
+	float excess = fabs(d) - extent;
+	return excess > 0.0f ? excess * excess : 0.0f;
+}
+
+//---------------------------------------------------------------------------
+// AABB
+
+AABB::AABB()
+{
+	Reset();
+}
+
+void AABB::Reset()
+{
+	min = CVector(FLT_MAX, FLT_MAX, FLT_MAX);
+	max = CVector(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+}
+
+bool AABB::IsEmpty() const
+{
+	return min.x > max.x || min.y > max.y || min.z > max.z;
+}
+
+void AABB::Expand(const CVector &point)
+{
+	for (int k = 0; k < 3; k++)
+	{
+		float p = Component(point, k);
+		Component(min, k) = p < Component(min, k) ? p : Component(min, k);
+		Component(max, k) = p > Component(max, k) ? p : Component(max, k);
+	}
+}
+
+void AABB::Expand(const AABB &box)
+{
+	for (int k = 0; k < 3; k++)
+	{
+		Component(min, k) = Component(box.min, k) < Component(min, k) ? Component(box.min, k) : Component(min, k);
+		Component(max, k) = Component(box.max, k) > Component(max, k) ? Component(box.max, k) : Component(max, k);
+	}
+}
+
+void AABB::Expand(const CVector *points, int count)
+{
+	for (int i = 0; i < count; i++)
+		Expand(points[i]);
+}
+
+AABB AABB::Transform(const Matrix &mat) const
+{
+	if (IsEmpty())
+		return AABB();
+
+	// Each output coordinate is the translation plus one term per input
+	// axis, and every term is smallest at either the min or the max corner
+	AABB box(CVector(mat.m_data[12], mat.m_data[13], mat.m_data[14]), CVector(mat.m_data[12], mat.m_data[13], mat.m_data[14]));
+	for (int j = 0; j < 3; j++)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			float a = mat.m_data[j*4+i] * Component(min, j);
+			float b = mat.m_data[j*4+i] * Component(max, j);
+			Component(box.min, i) += a < b ? a : b;
+			Component(box.max, i) += a < b ? b : a;
+		}
+	}
+	return box;
+}
+
+bool AABB::Contains(const CVector &point) const
+{
+	return point.x >= min.x && point.x <= max.x &&
+		   point.y >= min.y && point.y <= max.y &&
+		   point.z >= min.z && point.z <= max.z;
+}
+
+bool AABB::Overlaps(const AABB &box) const
+{
+	return box.min.x <= max.x && min.x <= box.max.x &&
+		   box.min.y <= max.y && min.y <= box.max.y &&
+		   box.min.z <= max.z && min.z <= box.max.z;
+}
+
+bool AABB::Overlaps(const CVector &sphereCenter, float radius) const
+{
+	CVector d = sphereCenter - GetCenter();
+	CVector e = GetExtents();
+	return Excess2(d.x, e.x) + Excess2(d.y, e.y) + Excess2(d.z, e.z) <= radius * radius;
+}
+
+int AABB::ClassifyPlane(const M3DVector4f plane) const
+{
+	CVector c = GetCenter(), e = GetExtents();
+	float s = c.x * plane[0] + c.y * plane[1] + c.z * plane[2] + plane[3];
+	float r = e.x * fabs(plane[0]) + e.y * fabs(plane[1]) + e.z * fabs(plane[2]);
+	return s > r ? 1 : (s < -r ? -1 : 0);
+}
+
+bool AABB::IntersectRay(float &distance, const CVector &origin, const CVector &direction, float maxDistance) const
+{
+	float tmin = 0.0f, tmax = maxDistance;
+	for (int k = 0; k < 3; k++)
+		if (!ClipSlab(tmin, tmax, Component(min, k), Component(max, k), Component(origin, k), 1.0f / Component(direction, k)))
+			return false;
+	distance = tmin;
+	return true;
+}
+
+//---------------------------------------------------------------------------
+// OBB
+
+OBB::OBB()
+{
+	axis[0] = CVector(1, 0, 0);
+	axis[1] = CVector(0, 1, 0);
+	axis[2] = CVector(0, 0, 1);
+}
+
+OBB::OBB(const AABB &box)
+	: center(box.GetCenter()), extents(box.GetExtents())
+{
+	axis[0] = CVector(1, 0, 0);
+	axis[1] = CVector(0, 1, 0);
+	axis[2] = CVector(0, 0, 1);
+}
+
+OBB::OBB(const AABB &box, const Matrix &mat)
+{
+	*this = OBB(box).Transform(mat);
+}
+
+OBB OBB::FromMatrix(const Matrix &box)
+{
+	OBB obb;
+	bool valid[3];
+	obb.center = CVector(box.m_data[12], box.m_data[13], box.m_data[14]);
+	for (int k = 0; k < 3; k++)
+	{
+		CVector column = Column(box, k);
+		float length = column.Length();
+		Component(obb.extents, k) = length;
+		valid[k] = length > 0.0f;
+		if (valid[k])
+			obb.axis[k] = column / length;
+	}
+	CompleteFrame(obb.axis, valid);
+	return obb;
+}
+
+Matrix OBB::ToMatrix() const
+{
+	Matrix mat;
+	mat.LoadIdentity();
+	for (int k = 0; k < 3; k++)
+	{
+		CVector column = axis[k] * Component(extents, k);
+		mat.m_data[k*4] = column.x;
+		mat.m_data[k*4+1] = column.y;
+		mat.m_data[k*4+2] = column.z;
+	}
+	mat.m_data[12] = center.x;
+	mat.m_data[13] = center.y;
+	mat.m_data[14] = center.z;
+	return mat;
+}
+
+OBB OBB::Transform(const Matrix &mat) const
+{
+	OBB obb;
+	bool valid[3];
+	obb.center = mat * center;
+	for (int k = 0; k < 3; k++)
+	{
+		// Carry the unit axis, so the frame survives zero extents
+		CVector a = TransformDirection(mat, axis[k]);
+		float length = a.Length();
+		Component(obb.extents, k) = Component(extents, k) * length;
+		valid[k] = length > 0.0f;
+		if (valid[k])
+			obb.axis[k] = a / length;
+	}
+	CompleteFrame(obb.axis, valid);
+	return obb;
+}
+
+AABB OBB::GetBounds() const
+{
+	CVector e;
+	for (int k = 0; k < 3; k++)
+		Component(e, k) = fabs(Component(axis[0], k)) * extents.x +
+						  fabs(Component(axis[1], k)) * extents.y +
+						  fabs(Component(axis[2], k)) * extents.z;
+	return AABB(center - e, center + e);
+}
+
+bool OBB::Contains(const CVector &point) const
+{
+	CVector d = point - center;
+	return fabs(d % axis[0]) <= extents.x && fabs(d % axis[1]) <= extents.y && fabs(d % axis[2]) <= extents.z;
+}
+
+// Separating axis test over the 15 candidate axes: the face normals of both
+// boxes and the cross products of their edges
+bool OBB::Overlaps(const OBB &box) const
+{
+	float r[3][3], absR[3][3];
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			r[i][j] = axis[i] % box.axis[j];
+			absR[i][j] = fabs(r[i][j]) + OBB_EPSILON;
+		}
+	}
+
+	// Centre offset in the frame of this box
+	CVector d = box.center - center;
+	float t[3] = {d % axis[0], d % axis[1], d % axis[2]};
+	const float *a = &extents.x, *b = &box.extents.x;
+
+	for (int i = 0; i < 3; i++)
+	{
+		if (fabs(t[i]) > a[i] + b[0] * absR[i][0] + b[1] * absR[i][1] + b[2] * absR[i][2])
+			return false;
+	}
+
+	for (int j = 0; j < 3; j++)
+	{
+		float s = t[0] * r[0][j] + t[1] * r[1][j] + t[2] * r[2][j];
+		if (fabs(s) > a[0] * absR[0][j] + a[1] * absR[1][j] + a[2] * absR[2][j] + b[j])
+			return false;
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+		for (int j = 0; j < 3; j++)
+		{
+			int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+			float ra = a[i1] * absR[i2][j] + a[i2] * absR[i1][j];
+			float rb = b[j1] * absR[i][j2] + b[j2] * absR[i][j1];
+			if (fabs(t[i2] * r[i1][j] - t[i1] * r[i2][j]) > ra + rb)
+				return false;
+		}
+	}
+	return true;
+}
+
+bool OBB::Overlaps(const AABB &box) const
+{
+	return Overlaps(OBB(box));
+}
+
+bool OBB::Overlaps(const CVector &sphereCenter, float radius) const
+{
+	CVector d = sphereCenter - center;
+	return Excess2(d % axis[0], extents.x) + Excess2(d % axis[1], extents.y) + Excess2(d % axis[2], extents.z) <= radius * radius;
+}
+
+int OBB::ClassifyPlane(const M3DVector4f plane) const
+{
+	CVector n(plane[0], plane[1], plane[2]);
+	float s = (n % center) + plane[3];
+	float r = extents.x * fabs(n % axis[0]) + extents.y * fabs(n % axis[1]) + extents.z * fabs(n % axis[2]);
+	return s > r ? 1 : (s < -r ? -1 : 0);
+}
+
+// The slab test in the frame of the box
+bool OBB::IntersectRay(float &distance, const CVector &origin, const CVector &direction, float maxDistance) const
+{
+	CVector d = origin - center;
+	float tmin = 0.0f, tmax = maxDistance;
+	for (int k = 0; k < 3; k++)
+	{
+		float e = Component(extents, k);
+		if (!ClipSlab(tmin, tmax, -e, e, d % axis[k], 1.0f / (direction % axis[k])))
+			return false;
+	}
+	distance = tmin;
+	return true;
+}
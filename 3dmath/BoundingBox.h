@@ -0,0 +1,92 @@
+#ifndef BOUNDINGBOX_H
+#define BOUNDINGBOX_H
+#include "math3d.h"
+#include "Vector.h"
+class Matrix;
+
+//---------------------------------------------------------------------------
+// Bounding boxes
+//
+// An AABB is stored as its corners and an OBB as a centre, three unit axes
+// and the half extents along them. The overlap tests are conservative only
+// in the sense of touching boxes counting as overlapping. Planes are in the
+// form of m3dGetPlaneEquation, with unit normals.
+//
+// Batches of boxes (transforms, overlap and ray tests, merging) are in
+// math3dBatch.h, on M3DBoxSoA streams.
+
+class AABB
+{
+public:
+	CVector min;
+	CVector max;
+
+	// An empty box: min = FLT_MAX, max = -FLT_MAX, so that expanding it by a
+	// point gives that point
+	AABB();
+	AABB(const CVector &minimum, const CVector &maximum) : min(minimum), max(maximum) {}
+
+	void Reset();
+	bool IsEmpty() const;
+	void Expand(const CVector &point);
+	void Expand(const AABB &box);
+	void Expand(const CVector *points, int count);
+
+	CVector GetCenter() const { return (min + max) * 0.5f; }
+	CVector GetExtents() const { return (max - min) * 0.5f; }
+
+	// Bounds of the box after mat, from the matrix entries and the corners
+	// per axis (Arvo) instead of transforming all eight corners. Exact for
+	// affine matrices; the projective row is ignored.
+	AABB Transform(const Matrix &mat) const;
+
+	bool Contains(const CVector &point) const;
+	bool Overlaps(const AABB &box) const;
+	bool Overlaps(const CVector &sphereCenter, float radius) const;
+
+	// 1 if the box is entirely in front of the plane, -1 if entirely behind
+	// it, 0 if the plane cuts it
+	int ClassifyPlane(const M3DVector4f plane) const;
+
+	// Slab test: distance at which origin + t * direction enters the box, 0
+	// if the origin is inside, within [0, maxDistance]
+	bool IntersectRay(float &distance, const CVector &origin, const CVector &direction, float maxDistance) const;
+};
+
+class OBB
+{
+public:
+	CVector center;
+	CVector axis[3];
+	CVector extents;		// half extents along the axes
+
+	OBB();
+	explicit OBB(const AABB &box);
+
+	// box carried through mat, a rotation and translation with a scale along
+	// the axes of the box, such as T * R * S. The scale goes into the
+	// extents. Any other scale, or a shear, does not map the box onto a box:
+	// the axes come out no longer perpendicular.
+	OBB(const AABB &box, const Matrix &mat);
+
+	// From a matrix mapping the cube [-1, 1]^3 onto the box, as FitOBB
+	// returns: the columns are the axes scaled by the half extents. Zero
+	// columns of a flat or degenerate box get axes completing the frame.
+	static OBB FromMatrix(const Matrix &box);
+	Matrix ToMatrix() const;
+
+	// Same condition as the constructor from a matrix, with the axes of this
+	// box: mat may scale uniformly or along them.
+	OBB Transform(const Matrix &mat) const;
+
+	AABB GetBounds() const;
+
+	bool Contains(const CVector &point) const;
+	bool Overlaps(const OBB &box) const;
+	bool Overlaps(const AABB &box) const;
+	bool Overlaps(const CVector &sphereCenter, float radius) const;
+	int ClassifyPlane(const M3DVector4f plane) const;
+	bool IntersectRay(float &distance, const CVector &origin, const CVector &direction, float maxDistance) const;
+};
+
+#endif // BOUNDINGBOX_H
@@ -0,0 +1,666 @@
+#include <math.h>
+#include <float.h>
+#include <vector>
+#include <algorithm>
+#include "BoundingSphere.h"
+#include "math3dBatch.h"
+
+// Balls copied out of the input at a time for the SIMD kernels
+#define BOUNDINGSPHERE_BLOCK		256
+// Balls per part of a parallel pass; the parts are combined in order
+#define BOUNDINGSPHERE_PART_SIZE	16384
+// A point counts as inside when its squared distance is within this factor
+// of the squared radius, so that rounding cannot make Minimal cycle
+#define BOUNDINGSPHERE_TOLERANCE	(1.0 + 8.0 * FLT_EPSILON)
+// Support sets flatter than this, relative to their size, have no sphere
+#define BOUNDINGSPHERE_DEGENERATE	1e-10
+#define BOUNDINGSPHERE_MAX_PIVOTS	1000
+
+// Centres through strided pointers, and radii; points have none
+struct BallStream
+{
+	const float *p[3];
+	const float *radius;
+	int stride;
+};
+
+struct BallBlock
+{
+	float p[3][BOUNDINGSPHERE_BLOCK];
+	float radius[BOUNDINGSPHERE_BLOCK];
+	int count;
+};
+
+// Extremes along the axes: the smallest centre - radius and the largest
+// centre + radius, and the first ball reaching each
+struct BallRange
+{
+	float lo[3], hi[3];
+	int loBall[3], hiBall[3];
+};
+
+static BallStream PointStream(const float *x, const float *y, const float *z, int stride)
+{
+	BallStream s = {{x, y, z}, NULL, stride};
+	return s;
+}
+
+static BallStream SphereStream(const float *x, const float *y, const float *z, const float *radius, int stride)
+{
+	BallStream s = {{x, y, z}, radius, stride};
+	return s;
+}
+
+static inline BoundingSphere Ball(const BallStream &s, int i)
+{
+	size_t k = size_t(i) * s.stride;
+	return BoundingSphere(CVector(s.p[0][k], s.p[1][k], s.p[2][k]), s.radius != NULL ? s.radius[k] : 0.0f);
+}
+
+static void LoadBlock(BallBlock &block, const BallStream &s, int begin, int end)
+{
+	block.count = end - begin < BOUNDINGSPHERE_BLOCK ? end - begin : BOUNDINGSPHERE_BLOCK;
+	for (int j = 0; j < block.count; j++)
+	{
+		size_t k = size_t(begin + j) * s.stride;
+		block.p[0][j] = s.p[0][k];
+		block.p[1][j] = s.p[1][k];
+		block.p[2][j] = s.p[2][k];
+		block.radius[j] = s.radius != NULL ? s.radius[k] : 0.0f;
+	}
+}
+
+#if defined(M3D_SSE2)
+static inline float HorizontalMin(__m128 v)
+{
+	v = _mm_min_ps(v, _mm_movehl_ps(v, v));
+	return _mm_cvtss_f32(_mm_min_ss(v, _mm_shuffle_ps(v, v, 1)));
+}
+
+static inline float HorizontalMax(__m128 v)
+{
+	v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+	return _mm_cvtss_f32(_mm_max_ss(v, _mm_shuffle_ps(v, v, 1)));
+}
+#endif
+
+// Widens [lo, hi] by centre - radius and centre + radius of a block along
+// one axis
+static void BlockRange(float &lo, float &hi, const float *p, const float *radius, int n)
+{
+	int j = 0;
+#if defined(M3D_AVX)
+	__m256 vLo = _mm256_set1_ps(lo), vHi = _mm256_set1_ps(hi);
+	for (; j + 8 <= n; j += 8)
+	{
+		__m256 c = _mm256_loadu_ps(p + j), r = _mm256_loadu_ps(radius + j);
+		vLo = _mm256_min_ps(vLo, _mm256_sub_ps(c, r));
+		vHi = _mm256_max_ps(vHi, _mm256_add_ps(c, r));
+	}
+	lo = HorizontalMin(_mm_min_ps(_mm256_castps256_ps128(vLo), _mm256_extractf128_ps(vLo, 1)));
+	hi = HorizontalMax(_mm_max_ps(_mm256_castps256_ps128(vHi), _mm256_extractf128_ps(vHi, 1)));
+#elif defined(M3D_SSE2)
+	__m128 vLo = _mm_set1_ps(lo), vHi = _mm_set1_ps(hi);
+	for (; j + 4 <= n; j += 4)
+	{
+		__m128 c = _mm_loadu_ps(p + j), r = _mm_loadu_ps(radius + j);
+		vLo = _mm_min_ps(vLo, _mm_sub_ps(c, r));
+		vHi = _mm_max_ps(vHi, _mm_add_ps(c, r));
+	}
+	lo = HorizontalMin(vLo);
+	hi = HorizontalMax(vHi);
+#endif
+
+	for (; j < n; j++)
+	{
+		lo = p[j] - radius[j] < lo ? p[j] - radius[j] : lo;
+		hi = p[j] + radius[j] > hi ? p[j] + radius[j] : hi;
+	}
+}
+
+// First ball from j on that is not inside the sphere, n if none
+static int FirstOutside(const BallBlock &block, int j, const BoundingSphere &sphere)
+{
+	int n = block.count;
+	const float *x = block.p[0], *y = block.p[1], *z = block.p[2], *r = block.radius;
+#if defined(M3D_AVX)
+	__m256 cx = _mm256_set1_ps(sphere.center.x), cy = _mm256_set1_ps(sphere.center.y), cz = _mm256_set1_ps(sphere.center.z);
+	__m256 radius = _mm256_set1_ps(sphere.radius);
+	for (; j + 8 <= n; j += 8)
+	{
+		__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + j), cx);
+		__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + j), cy);
+		__m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z + j), cz);
+		__m256 d2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+		__m256 reach = _mm256_add_ps(_mm256_sqrt_ps(d2), _mm256_loadu_ps(r + j));
+		int mask = _mm256_movemask_ps(_mm256_cmp_ps(reach, radius, _CMP_GT_OQ));
+		if (mask != 0)
+		{
+			while (!(mask & 1))
+			{
+				mask >>= 1;
+				j++;
+			}
+			return j;
+		}
+	}
+#elif defined(M3D_SSE2)
+	__m128 cx = _mm_set1_ps(sphere.center.x), cy = _mm_set1_ps(sphere.center.y), cz = _mm_set1_ps(sphere.center.z);
+	__m128 radius = _mm_set1_ps(sphere.radius);
+	for (; j + 4 <= n; j += 4)
+	{
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(x + j), cx);
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(y + j), cy);
+		__m128 dz = _mm_sub_ps(_mm_loadu_ps(z + j), cz);
+		__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		__m128 reach = _mm_add_ps(_mm_sqrt_ps(d2), _mm_loadu_ps(r + j));
+		int mask = _mm_movemask_ps(_mm_cmpgt_ps(reach, radius));
+		if (mask != 0)
+		{
+			while (!(mask & 1))
+			{
+				mask >>= 1;
+				j++;
+			}
+			return j;
+		}
+	}
+#endif
+
+	for (; j < n; j++)
+	{
+		float dx = x[j] - sphere.center.x, dy = y[j] - sphere.center.y, dz = z[j] - sphere.center.z;
+		if (sqrtf(dx * dx + dy * dy + dz * dz) + r[j] > sphere.radius)
+			return j;
+	}
+	return n;
+}
+
+// Squared distances of a block from center into d2, and the largest
+static float BlockDistances(float *d2, const BallBlock &block, const float center[3])
+{
+	int n = block.count, j = 0;
+	const float *x = block.p[0], *y = block.p[1], *z = block.p[2];
+	float largest = -1.0f;
+#if defined(M3D_AVX)
+	__m256 cx = _mm256_set1_ps(center[0]), cy = _mm256_set1_ps(center[1]), cz = _mm256_set1_ps(center[2]);
+	__m256 vLargest = _mm256_set1_ps(largest);
+	for (; j + 8 <= n; j += 8)
+	{
+		__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + j), cx);
+		__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + j), cy);
+		__m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z + j), cz);
+		__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+		_mm256_storeu_ps(d2 + j, d);
+		vLargest = _mm256_max_ps(vLargest, d);
+	}
+	largest = HorizontalMax(_mm_max_ps(_mm256_castps256_ps128(vLargest), _mm256_extractf128_ps(vLargest, 1)));
+#elif defined(M3D_SSE2)
+	__m128 cx = _mm_set1_ps(center[0]), cy = _mm_set1_ps(center[1]), cz = _mm_set1_ps(center[2]);
+	__m128 vLargest = _mm_set1_ps(largest);
+	for (; j + 4 <= n; j += 4)
+	{
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(x + j), cx);
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(y + j), cy);
+		__m128 dz = _mm_sub_ps(_mm_loadu_ps(z + j), cz);
+		__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		_mm_storeu_ps(d2 + j, d);
+		vLargest = _mm_max_ps(vLargest, d);
+	}
+	largest = HorizontalMax(vLargest);
+#endif
+
+	for (; j < n; j++)
+	{
+		float dx = x[j] - center[0], dy = y[j] - center[1], dz = z[j] - center[2];
+		d2[j] = dx * dx + dy * dy + dz * dz;
+		largest = d2[j] > largest ? d2[j] : largest;
+	}
+	return largest;
+}
+
+static void PartRange(BallRange &range, const BallStream &s, int begin, int end)
+{
+	BallBlock block;
+	for (int b = begin; b < end; b += BOUNDINGSPHERE_BLOCK)
+	{
+		LoadBlock(block, s, b, end);
+		for (int k = 0; k < 3; k++)
+		{
+			// Only a block that moves an extreme is searched for the ball
+			float lo = range.lo[k], hi = range.hi[k];
+			BlockRange(lo, hi, block.p[k], block.radius, block.count);
+			for (int j = 0; j < block.count && lo < range.lo[k]; j++)
+				if (block.p[k][j] - block.radius[j] == lo)
+				{
+					range.lo[k] = lo;
+					range.loBall[k] = b + j;
+				}
+			for (int j = 0; j < block.count && hi > range.hi[k]; j++)
+				if (block.p[k][j] + block.radius[j] == hi)
+				{
+					range.hi[k] = hi;
+					range.hiBall[k] = b + j;
+				}
+		}
+	}
+}
+
+// Appends the balls of [begin, end) that stick out of the sphere, growing
+// it by each if grow is set
+static void PartOutside(std::vector<int> &outside, BoundingSphere sphere, bool grow, const BallStream &s, int begin, int end)
+{
+	BallBlock block;
+	for (int b = begin; b < end; b += BOUNDINGSPHERE_BLOCK)
+	{
+		LoadBlock(block, s, b, end);
+		for (int j = FirstOutside(block, 0, sphere); j < block.count; j = FirstOutside(block, j + 1, sphere))
+		{
+			outside.push_back(b + j);
+			if (grow)
+				sphere.Expand(BoundingSphere(CVector(block.p[0][j], block.p[1][j], block.p[2][j]), block.radius[j]));
+		}
+	}
+}
+
+// Farthest ball centre from center in [begin, end), the first if several
+static int PartFarthest(float &distance2, const BallStream &s, const float center[3], int begin, int end)
+{
+	BallBlock block;
+	float d2[BOUNDINGSPHERE_BLOCK];
+	int farthest = -1;
+	distance2 = -1.0f;
+	for (int b = begin; b < end; b += BOUNDINGSPHERE_BLOCK)
+	{
+		LoadBlock(block, s, b, end);
+		float largest = BlockDistances(d2, block, center);
+		for (int j = 0; j < block.count && largest > distance2; j++)
+			if (d2[j] == largest)
+			{
+				distance2 = largest;
+				farthest = b + j;
+			}
+	}
+	return farthest;
+}
+
+static inline int PartCount(int count)
+{
+	return (count + BOUNDINGSPHERE_PART_SIZE - 1) / BOUNDINGSPHERE_PART_SIZE;
+}
+
+static inline int PartEnd(int part, int count)
+{
+	int end = (part + 1) * BOUNDINGSPHERE_PART_SIZE;
+	return end < count ? end : count;
+}
+
+// Ritter: the sphere over the pair of extremes farthest apart, then grown
+// by every ball outside it. Each part grows its own copy and keeps the few
+// balls that grew it; the sphere grown by those, in order, is about what
+// one serial pass gives. A last pass grows it by anything still outside.
+static BoundingSphere Ritter(const BallStream &s, int count)
+{
+	if (count <= 0)
+		return BoundingSphere();
+
+	int parts = PartCount(count);
+	std::vector<BallRange> ranges(parts);
+#ifdef _OPENMP
+	#pragma omp parallel for if(parts > 1)
+#endif
+	for (int p = 0; p < parts; p++)
+	{
+		BallRange &range = ranges[p];
+		for (int k = 0; k < 3; k++)
+		{
+			range.lo[k] = FLT_MAX;
+			range.hi[k] = -FLT_MAX;
+			range.loBall[k] = range.hiBall[k] = p * BOUNDINGSPHERE_PART_SIZE;
+		}
+		PartRange(range, s, p * BOUNDINGSPHERE_PART_SIZE, PartEnd(p, count));
+	}
+
+	BallRange range = ranges[0];
+	for (int p = 1; p < parts; p++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			if (ranges[p].lo[k] < range.lo[k])
+			{
+				range.lo[k] = ranges[p].lo[k];
+				range.loBall[k] = ranges[p].loBall[k];
+			}
+			if (ranges[p].hi[k] > range.hi[k])
+			{
+				range.hi[k] = ranges[p].hi[k];
+				range.hiBall[k] = ranges[p].hiBall[k];
+			}
+		}
+	}
+
+	int axis = 0;
+	for (int k = 1; k < 3; k++)
+		if (range.hi[k] - range.lo[k] > range.hi[axis] - range.lo[axis])
+			axis = k;
+	BoundingSphere start = Ball(s, range.loBall[axis]);
+	start.Expand(Ball(s, range.hiBall[axis]));
+
+	BoundingSphere sphere = start;
+	std::vector<std::vector<int> > outside(parts);
+	for (int pass = 0; pass < 2; pass++)
+	{
+#ifdef _OPENMP
+		#pragma omp parallel for if(parts > 1)
+#endif
+		for (int p = 0; p < parts; p++)
+		{
+			outside[p].clear();
+			PartOutside(outside[p], sphere, pass == 0, s, p * BOUNDINGSPHERE_PART_SIZE, PartEnd(p, count));
+		}
+
+		// Growing never drops a ball, so whatever was inside stays inside
+		for (int p = 0; p < parts; p++)
+			for (size_t i = 0; i < outside[p].size(); i++)
+				sphere.Expand(Ball(s, outside[p][i]));
+		if (parts == 1)
+			break;
+	}
+	return sphere;
+}
+
+// Welzl's algorithm with move-to-front and pivoting, after Gaertner's
+// Miniball. The support set holds the up to four points on the boundary of
+// the sphere being built. That sphere is the one through the support set as
+// it was after the last push; popping only shrinks the set and keeps the
+// sphere. The list holds the points that have been in a support set, most
+// recent first, and is short: every other point is only ever met by the
+// pivot search.
+class MinimalSphere
+{
+public:
+	MinimalSphere(const BallStream &s) : m_stream(s), m_size(0), m_supportEnd(0)
+	{
+		m_center[0] = m_center[1] = m_center[2] = 0.0;
+		m_radius2 = -1.0;
+	}
+
+	BoundingSphere Build(int count);
+
+private:
+	void Point(double p[3], int i) const
+	{
+		size_t k = size_t(i) * m_stream.stride;
+		p[0] = m_stream.p[0][k];
+		p[1] = m_stream.p[1][k];
+		p[2] = m_stream.p[2][k];
+	}
+
+	bool Outside(int i) const
+	{
+		double p[3];
+		Point(p, i);
+		const double *c = m_center;
+		double d2 = (p[0] - c[0]) * (p[0] - c[0]) + (p[1] - c[1]) * (p[1] - c[1]) + (p[2] - c[2]) * (p[2] - c[2]);
+		return d2 > m_radius2 * BOUNDINGSPHERE_TOLERANCE;
+	}
+
+	bool Push(int i);
+	void Pop() { m_size--; }
+	void MoveToFront(int position);
+	void Solve(int end);
+
+	BallStream m_stream;
+	int m_support[4];
+	double m_center[3];					// the last sphere pushed
+	double m_radius2;
+	int m_size;
+	std::vector<int> m_list;
+	int m_supportEnd;
+};
+
+// The sphere through the support points and i, centred in their affine hull.
+// False if they are (nearly) collinear or coplanar.
+bool MinimalSphere::Push(int i)
+{
+	double p0[3], v[3][3];
+	m_support[m_size] = i;
+	Point(p0, m_support[0]);
+	for (int k = 1; k <= m_size; k++)
+	{
+		Point(v[k - 1], m_support[k]);
+		for (int c = 0; c < 3; c++)
+			v[k - 1][c] -= p0[c];
+	}
+
+	double offset[3] = {0.0, 0.0, 0.0};
+	if (m_size == 1)
+	{
+		for (int c = 0; c < 3; c++)
+			offset[c] = 0.5 * v[0][c];
+	}
+	else if (m_size == 2)
+	{
+		// ((|a|^2 b - |b|^2 a) x (a x b)) / (2 |a x b|^2)
+		const double *a = v[0], *b = v[1];
+		double aa = m3dDotProduct(a, a), bb = m3dDotProduct(b, b);
+		double n[3], w[3];
+		m3dCrossProduct(n, a, b);
+		double nn = m3dDotProduct(n, n);
+		if (nn <= BOUNDINGSPHERE_DEGENERATE * aa * bb)
+			return false;
+		for (int c = 0; c < 3; c++)
+			w[c] = aa * b[c] - bb * a[c];
+		m3dCrossProduct(offset, w, n);
+		for (int c = 0; c < 3; c++)
+			offset[c] /= 2.0 * nn;
+	}
+	else if (m_size == 3)
+	{
+		// (|a|^2 (b x c) + |b|^2 (c x a) + |c|^2 (a x b)) / (2 a . (b x c))
+		const double *a = v[0], *b = v[1], *c = v[2];
+		double bc[3], ca[3], ab[3];
+		m3dCrossProduct(bc, b, c);
+		m3dCrossProduct(ca, c, a);
+		m3dCrossProduct(ab, a, b);
+		double det = m3dDotProduct(a, bc);
+		double aa = m3dDotProduct(a, a), bb = m3dDotProduct(b, b), cc = m3dDotProduct(c, c);
+		if (det * det <= BOUNDINGSPHERE_DEGENERATE * aa * bb * cc)
+			return false;
+		for (int k = 0; k < 3; k++)
+			offset[k] = (aa * bc[k] + bb * ca[k] + cc * ab[k]) / (2.0 * det);
+	}
+
+	m_size++;
+	for (int c = 0; c < 3; c++)
+		m_center[c] = p0[c] + offset[c];
+	m_radius2 = m3dDotProduct(offset, offset);
+	return true;
+}
+
+// The list entry at position to the front. The end of the support prefix
+// stays on the same entry, or the next one if that is the one moved.
+void MinimalSphere::MoveToFront(int position)
+{
+	std::rotate(m_list.begin(), m_list.begin() + position, m_list.begin() + position + 1);
+	if (m_supportEnd <= position)
+		m_supportEnd++;
+}
+
+// Smallest sphere of the first end list points with the support set on its
+// boundary
+void MinimalSphere::Solve(int end)
+{
+	m_supportEnd = 0;
+	if (m_size == 4)
+		return;
+
+	for (int j = 0; j < end; j++)
+	{
+		if (Outside(m_list[j]) && Push(m_list[j]))
+		{
+			Solve(j);
+			Pop();
+			MoveToFront(j);
+		}
+	}
+}
+
+// Each pivot step takes the point farthest outside, builds the smallest
+// sphere with it on the boundary from the list, and puts it at the front.
+// That stops once every point is inside or the sphere no longer grows.
+BoundingSphere MinimalSphere::Build(int count)
+{
+	if (count <= 0)
+		return BoundingSphere();
+
+	m_list.assign(1, 0);
+	Solve(1);
+
+	int parts = PartCount(count);
+	std::vector<float> distances2(parts);
+	std::vector<int> farthest(parts);
+	double previous = -1.0;
+	float distance2 = 0.0f, center[3];
+	for (int step = 0; step < BOUNDINGSPHERE_MAX_PIVOTS; step++)
+	{
+		for (int c = 0; c < 3; c++)
+			center[c] = float(m_center[c]);
+
+#ifdef _OPENMP
+		#pragma omp parallel for if(parts > 1)
+#endif
+		for (int p = 0; p < parts; p++)
+			farthest[p] = PartFarthest(distances2[p], m_stream, center, p * BOUNDINGSPHERE_PART_SIZE, PartEnd(p, count));
+
+		int pivot = farthest[0];
+		distance2 = distances2[0];
+		for (int p = 1; p < parts; p++)
+			if (distances2[p] > distance2)
+			{
+				distance2 = distances2[p];
+				pivot = farthest[p];
+			}
+
+		if (!(distance2 > m_radius2 * BOUNDINGSPHERE_TOLERANCE) || m_radius2 <= previous)
+			break;
+		previous = m_radius2;
+
+		if (!Push(pivot))
+			break;
+		Solve(m_supportEnd);
+		Pop();
+
+		int position = int(std::find(m_list.begin(), m_list.end(), pivot) - m_list.begin());
+		if (position == int(m_list.size()))
+			m_list.push_back(pivot);
+		MoveToFront(position);
+	}
+
+	// The farthest point of the last search bounds the radius, so rounding
+	// in the support spheres cannot leave a point out
+	float radius2 = float(m_radius2);
+	return BoundingSphere(CVector(center[0], center[1], center[2]), sqrtf(distance2 > radius2 ? distance2 : radius2));
+}
+
+BoundingSphere::BoundingSphere() : radius(-1.0f)
+{
+
+}
+
+void BoundingSphere::Reset()
+{
+	center = CVector(0.0f, 0.0f, 0.0f);
+	radius = -1.0f;
+}
+
+void BoundingSphere::Expand(const CVector &point)
+{
+	Expand(BoundingSphere(point, 0.0f));
+}
+
+void BoundingSphere::Expand(const BoundingSphere &sphere)
+{
+	if (sphere.IsEmpty())
+		return;
+	if (IsEmpty())
+	{
+		*this = sphere;
+		return;
+	}
+
+	CVector offset = sphere.center - center;
+	float distance = offset.Length();
+	if (distance + sphere.radius <= radius)
+		return;
+	if (distance + radius <= sphere.radius)
+	{
+		*this = sphere;
+		return;
+	}
+
+	// Spans from the far side of this sphere to the far side of the other.
+	// Far from the origin the centre rounds by more than the radius does,
+	// so the radius is made to reach both again.
+	CVector previous = center;
+	float newRadius = (distance + radius + sphere.radius) * 0.5f;
+	center += offset * ((newRadius - radius) / distance);
+	float reach = (previous - center).Length() + radius, otherReach = (sphere.center - center).Length() + sphere.radius;
+	reach = reach > otherReach ? reach : otherReach;
+	radius = newRadius > reach ? newRadius : reach;
+}
+
+bool BoundingSphere::Contains(const CVector &point) const
+{
+	CVector offset = point - center;
+	return (offset % offset) <= radius * radius && radius >= 0.0f;
+}
+
+bool BoundingSphere::Contains(const BoundingSphere &sphere) const
+{
+	return (sphere.center - center).Length() + sphere.radius <= radius;
+}
+
+bool BoundingSphere::Overlaps(const BoundingSphere &sphere) const
+{
+	CVector offset = sphere.center - center;
+	float reach = radius + sphere.radius;
+	return (offset % offset) <= reach * reach && radius >= 0.0f && sphere.radius >= 0.0f;
+}
+
+BoundingSphere BoundingSphere::FromPoints(const CVector *points, int count)
+{
+	if (count <= 0)
+		return BoundingSphere();
+	return Ritter(PointStream(&points[0].x, &points[0].y, &points[0].z, sizeof(CVector) / sizeof(float)), count);
+}
+
+BoundingSphere BoundingSphere::FromPoints(const float *x, const float *y, const float *z, int count)
+{
+	return Ritter(PointStream(x, y, z, 1), count);
+}
+
+BoundingSphere BoundingSphere::Minimal(const CVector *points, int count)
+{
+	if (count <= 0)
+		return BoundingSphere();
+	return MinimalSphere(PointStream(&points[0].x, &points[0].y, &points[0].z, sizeof(CVector) / sizeof(float))).Build(count);
+}
+
+BoundingSphere BoundingSphere::Minimal(const float *x, const float *y, const float *z, int count)
+{
+	return MinimalSphere(PointStream(x, y, z, 1)).Build(count);
+}
+
+BoundingSphere BoundingSphere::FromSpheres(const BoundingSphere *spheres, int count)
+{
+	if (count <= 0)
+		return BoundingSphere();
+	return Ritter(SphereStream(&spheres[0].center.x, &spheres[0].center.y, &spheres[0].center.z, &spheres[0].radius,
+							   sizeof(BoundingSphere) / sizeof(float)), count);
+}
+
+BoundingSphere BoundingSphere::FromSpheres(const M3DSphereSoA &spheres, int count)
+{
+	return Ritter(SphereStream(spheres.center[0], spheres.center[1], spheres.center[2], spheres.radius, 1), count);
+}
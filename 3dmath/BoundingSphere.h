@@ -0,0 +1,64 @@
+#ifndef BOUNDINGSPHERE_H
+#define BOUNDINGSPHERE_H
+#include "math3d.h"
+#include "Vector.h"
+struct M3DSphereSoA;
+
+//---------------------------------------------------------------------------
+// class BoundingSphere
+//
+// A centre and a radius, negative for an empty sphere. Spheres of point
+// sets come two ways:
+//
+// FromPoints is Ritter's pass: a sphere through the two most distant axis
+// extremes, grown to take in every point that sticks out of it. It gives a
+// sphere that is typically 2 to 20% larger than the smallest one. The passes
+// test four or eight points per instruction, and large sets are cut into
+// fixed parts that are scanned in parallel when the library is built with
+// OpenMP; the parts report the points that grew the sphere, which are then
+// applied in order, so the result does not depend on the thread count.
+//
+// Minimal is Welzl's algorithm with move-to-front and pivoting (Gaertner):
+// the smallest enclosing sphere, up to float rounding, in expected linear
+// time. The support spheres are solved in double precision; the pivot search
+// over all points uses the same parallel scans as FromPoints.
+//
+// FromSpheres is the Ritter pass over spheres, for the nodes of a bounding
+// volume hierarchy; Expand(sphere) merges two of them exactly.
+
+class BoundingSphere
+{
+public:
+	CVector center;
+	float radius;
+
+	// An empty sphere, radius -1, so that expanding it by a point gives
+	// that point
+	BoundingSphere();
+	BoundingSphere(const CVector &c, float r) : center(c), radius(r) {}
+
+	void Reset();
+	bool IsEmpty() const { return radius < 0.0f; }
+
+	// Smallest sphere holding this one and the point or sphere
+	void Expand(const CVector &point);
+	void Expand(const BoundingSphere &sphere);
+
+	bool Contains(const CVector &point) const;
+	bool Contains(const BoundingSphere &sphere) const;
+	bool Overlaps(const BoundingSphere &sphere) const;
+
+	// Ritter's approximate sphere; empty for no points
+	static BoundingSphere FromPoints(const CVector *points, int count);
+	static BoundingSphere FromPoints(const float *x, const float *y, const float *z, int count);
+
+	// The smallest sphere; empty for no points
+	static BoundingSphere Minimal(const CVector *points, int count);
+	static BoundingSphere Minimal(const float *x, const float *y, const float *z, int count);
+
+	// Approximate sphere around spheres, which must not be empty
+	static BoundingSphere FromSpheres(const BoundingSphere *spheres, int count);
+	static BoundingSphere FromSpheres(const M3DSphereSoA &spheres, int count);
+};
+
+#endif // BOUNDINGSPHERE_H
@@ -0,0 +1,689 @@
+#include <float.h>
+#include <math.h>
+#include "Convex.h"
+#include "Matrix.h"
+
+#define GJK_MAX_ITERATIONS		64
+// GJK stops once a new support point gets v no closer than this fraction
+#define GJK_TOLERANCE			1e-6f
+#define EPA_MAX_ITERATIONS		64
+#define EPA_MAX_VERTICES		(EPA_MAX_ITERATIONS + 8)
+#define EPA_MAX_FACES			(2 * EPA_MAX_VERTICES)
+// EPA stops once the support point is this close (relative) to the face
+#define EPA_TOLERANCE			1e-4f
+#define EPA_COPLANAR			1e-5f
+
+static inline float LengthSqr(const CVector &v)
+{
+	return v % v;
+}
+
+ConvexShape::ConvexShape()
+	: type(CONVEX_POINT), radius(0.0f), points(NULL), count(0)
+{
+
+}
+
+ConvexShape ConvexShape::Sphere(float radius)
+{
+	ConvexShape shape;
+	shape.radius = radius;
+	return shape;
+}
+
+ConvexShape ConvexShape::Capsule(float radius, float halfHeight)
+{
+	ConvexShape shape;
+	shape.type = CONVEX_SEGMENT;
+	shape.extents = CVector(0.0f, halfHeight, 0.0f);
+	shape.radius = radius;
+	return shape;
+}
+
+ConvexShape ConvexShape::Box(const CVector &extents, float radius)
+{
+	ConvexShape shape;
+	shape.type = CONVEX_BOX;
+	shape.extents = extents;
+	shape.radius = radius;
+	return shape;
+}
+
+ConvexShape ConvexShape::Hull(const CVector *points, int count, float radius)
+{
+	ConvexShape shape;
+	shape.type = CONVEX_HULL;
+	shape.points = points;
+	shape.count = count;
+	shape.radius = radius;
+	return shape;
+}
+
+void ConvexShape::SetTransform(const CVector &position, const Quaternion &rotation)
+{
+	this->position = position;
+	this->rotation = rotation;
+}
+
+void ConvexShape::SetTransform(const Matrix &mat)
+{
+	// mat rotates by the conjugate of the quaternion m3dMatToQuat returns,
+	// see DualQuaternion::FromMatrix
+	position = CVector(mat.m_data[12], mat.m_data[13], mat.m_data[14]);
+	rotation.FromMatrix(mat);
+	rotation.Conjugate();
+}
+
+CVector ConvexShape::LocalSupport(const CVector &direction) const
+{
+	switch (type)
+	{
+	case CONVEX_SEGMENT:
+		return CVector(0.0f, direction.y >= 0.0f ? extents.y : -extents.y, 0.0f);
+	case CONVEX_BOX:
+		return CVector(direction.x >= 0.0f ? extents.x : -extents.x,
+					   direction.y >= 0.0f ? extents.y : -extents.y,
+					   direction.z >= 0.0f ? extents.z : -extents.z);
+	case CONVEX_HULL:
+		{
+			int best = 0;
+			float bestDot = -FLT_MAX;
+			for (int i = 0; i < count; i++)
+			{
+				float d = points[i] % direction;
+				if (d > bestDot)
+				{
+					bestDot = d;
+					best = i;
+				}
+			}
+			return count > 0 ? points[best] : CVector(0.0f, 0.0f, 0.0f);
+		}
+	default:
+		return CVector(0.0f, 0.0f, 0.0f);
+	}
+}
+
+//---------------------------------------------------------------------------
+// Support points of the Minkowski difference A - B
+
+struct ConvexVertex
+{
+	CVector w;					// a - b
+	CVector a, b;				// in world space
+	CVector localA, localB;		// core points in the local frames, for the cache
+};
+
+// Core support point of the pair along direction, world space
+static inline void CoreSupport(ConvexVertex &v, const ConvexShape &a, const ConvexShape &b, const CVector &direction)
+{
+	v.localA = a.LocalSupport(a.rotation.GetConjugate().RotateVector(direction));
+	v.localB = b.LocalSupport(b.rotation.GetConjugate().RotateVector(-direction));
+	v.a = a.position + a.rotation.RotateVector(v.localA);
+	v.b = b.position + b.rotation.RotateVector(v.localB);
+	v.w = v.a - v.b;
+}
+
+// Support point of the full, rounded shapes
+static inline void FullSupport(ConvexVertex &v, const ConvexShape &a, const ConvexShape &b, const CVector &direction)
+{
+	CoreSupport(v, a, b, direction);
+	float length = direction.Length();
+	if (length > 0.0f)
+	{
+		CVector unit = direction / length;
+		v.a += unit * a.radius;
+		v.b -= unit * b.radius;
+		v.w = v.a - v.b;
+	}
+}
+
+//---------------------------------------------------------------------------
+// GJK
+//
+// The simplex is reduced after every step to the smallest feature holding
+// its point closest to the origin, with the barycentric weights of that
+// point.
+
+struct ConvexSimplex
+{
+	ConvexVertex v[4];
+	float lambda[4];
+	int count;
+};
+
+struct SimplexFeature
+{
+	int count;
+	int index[4];
+	float lambda[4];
+};
+
+static inline void SetFeature(SimplexFeature &f, int i, float li, int j = -1, float lj = 0.0f, int k = -1, float lk = 0.0f)
+{
+	f.count = 1;
+	f.index[0] = i;
+	f.lambda[0] = li;
+	if (j >= 0)
+	{
+		f.index[f.count] = j;
+		f.lambda[f.count++] = lj;
+	}
+	if (k >= 0)
+	{
+		f.index[f.count] = k;
+		f.lambda[f.count++] = lk;
+	}
+}
+
+static inline CVector FeaturePoint(const SimplexFeature &f, const ConvexVertex *v)
+{
+	CVector p(0.0f, 0.0f, 0.0f);
+	for (int i = 0; i < f.count; i++)
+		p += v[f.index[i]].w * f.lambda[i];
+	return p;
+}
+
+static void ClosestOnSegment(SimplexFeature &f, const ConvexVertex *v, int i, int j)
+{
+	CVector a = v[i].w, ab = v[j].w - a;
+	float t = -(a % ab), denom = ab % ab;
+	if (t <= 0.0f || denom <= 0.0f)
+		SetFeature(f, i, 1.0f);
+	else if (t >= denom)
+		SetFeature(f, j, 1.0f);
+	else
+		SetFeature(f, i, 1.0f - t / denom, j, t / denom);
+}
+
+// The Voronoi region tests of Ericson, Real-Time Collision Detection 5.1.5
+static void ClosestOnTriangle(SimplexFeature &f, const ConvexVertex *v, int i, int j, int k)
+{
+	CVector a = v[i].w, b = v[j].w, c = v[k].w;
+	CVector ab = b - a, ac = c - a;
+
+	float d1 = -(ab % a), d2 = -(ac % a);
+	if (d1 <= 0.0f && d2 <= 0.0f)
+		return SetFeature(f, i, 1.0f);
+
+	float d3 = -(ab % b), d4 = -(ac % b);
+	if (d3 >= 0.0f && d4 <= d3)
+		return SetFeature(f, j, 1.0f);
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+	{
+		float t = d1 / (d1 - d3);
+		return SetFeature(f, i, 1.0f - t, j, t);
+	}
+
+	float d5 = -(ab % c), d6 = -(ac % c);
+	if (d6 >= 0.0f && d5 <= d6)
+		return SetFeature(f, k, 1.0f);
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+	{
+		float t = d2 / (d2 - d6);
+		return SetFeature(f, i, 1.0f - t, k, t);
+	}
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+	{
+		float t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		return SetFeature(f, j, 1.0f - t, k, t);
+	}
+
+	float sum = va + vb + vc;
+	if (sum > 0.0f)
+	{
+		float s = vb / sum, t = vc / sum;
+		return SetFeature(f, i, 1.0f - s - t, j, s, k, t);
+	}
+
+	// Degenerate: the best of the edges
+	SimplexFeature e;
+	ClosestOnSegment(f, v, i, j);
+	float best = LengthSqr(FeaturePoint(f, v));
+	ClosestOnSegment(e, v, j, k);
+	float d = LengthSqr(FeaturePoint(e, v));
+	if (d < best)
+	{
+		f = e;
+		best = d;
+	}
+	ClosestOnSegment(e, v, i, k);
+	if (LengthSqr(FeaturePoint(e, v)) < best)
+		f = e;
+}
+
+// Count 4 with the weights of the origin when it is inside
+static void ClosestOnTetrahedron(SimplexFeature &f, const ConvexVertex *v)
+{
+	static const int faces[4][4] = {{0, 1, 2, 3}, {0, 3, 1, 2}, {0, 2, 3, 1}, {1, 3, 2, 0}};
+	CVector p0 = v[0].w;
+	float volume = (v[1].w - p0) % ((v[2].w - p0) ^ (v[3].w - p0));
+	float scale = 0.0f;
+	for (int i = 1; i < 4; i++)
+		scale = LengthSqr(v[i].w - p0) > scale ? LengthSqr(v[i].w - p0) : scale;
+	bool flat = fabs(volume) <= 1e-6f * scale * sqrtf(scale);
+
+	float best = FLT_MAX;
+	bool inside = true;
+	for (int n = 0; n < 4; n++)
+	{
+		const int *face = faces[n];
+		CVector a = v[face[0]].w;
+		CVector normal = (v[face[1]].w - a) ^ (v[face[2]].w - a);
+		float origin = -(normal % a), opposite = normal % (v[face[3]].w - a);
+
+		// The origin is on the other side of the face than the fourth vertex
+		if (flat || origin * opposite < 0.0f)
+		{
+			inside = false;
+			SimplexFeature e;
+			ClosestOnTriangle(e, v, face[0], face[1], face[2]);
+			float d = LengthSqr(FeaturePoint(e, v));
+			if (d < best)
+			{
+				best = d;
+				f = e;
+			}
+		}
+	}
+
+	if (inside)
+	{
+		// Weights are the volumes opposite each vertex over the whole
+		f.count = 4;
+		for (int n = 0; n < 4; n++)
+			f.index[n] = n;
+		f.lambda[1] = (-p0) % ((v[2].w - p0) ^ (v[3].w - p0)) / volume;
+		f.lambda[2] = (v[1].w - p0) % ((-p0) ^ (v[3].w - p0)) / volume;
+		f.lambda[3] = (v[1].w - p0) % ((v[2].w - p0) ^ (-p0)) / volume;
+		f.lambda[0] = 1.0f - f.lambda[1] - f.lambda[2] - f.lambda[3];
+	}
+}
+
+// Reduces the simplex to its feature closest to the origin, returns the point
+static CVector ReduceSimplex(ConvexSimplex &s)
+{
+	SimplexFeature f;
+	switch (s.count)
+	{
+	case 1:
+		SetFeature(f, 0, 1.0f);
+		break;
+	case 2:
+		ClosestOnSegment(f, s.v, 0, 1);
+		break;
+	case 3:
+		ClosestOnTriangle(f, s.v, 0, 1, 2);
+		break;
+	default:
+		ClosestOnTetrahedron(f, s.v);
+		break;
+	}
+
+	CVector point = FeaturePoint(f, s.v);
+	ConvexVertex v[4];
+	for (int i = 0; i < f.count; i++)
+	{
+		v[i] = s.v[f.index[i]];
+		s.lambda[i] = f.lambda[i];
+	}
+	for (int i = 0; i < f.count; i++)
+		s.v[i] = v[i];
+	s.count = f.count;
+	return point;
+}
+
+// Closest point v of the core difference to the origin. Returns true when
+// the cores intersect (v is then about zero).
+static bool GJK(ConvexSimplex &s, CVector &v, const ConvexShape &a, const ConvexShape &b, const ConvexCache *cache)
+{
+	if (cache != NULL && cache->count > 0)
+	{
+		s.count = cache->count;
+		for (int i = 0; i < s.count; i++)
+		{
+			ConvexVertex &p = s.v[i];
+			p.localA = cache->a[i];
+			p.localB = cache->b[i];
+			p.a = a.position + a.rotation.RotateVector(p.localA);
+			p.b = b.position + b.rotation.RotateVector(p.localB);
+			p.w = p.a - p.b;
+		}
+		v = ReduceSimplex(s);
+	}
+	else
+	{
+		CVector direction = b.position - a.position;
+		if (LengthSqr(direction) == 0.0f)
+			direction = CVector(1.0f, 0.0f, 0.0f);
+		CoreSupport(s.v[0], a, b, direction);
+		s.lambda[0] = 1.0f;
+		s.count = 1;
+		v = s.v[0].w;
+	}
+
+	float scale = 0.0f;
+	for (int i = 0; i < s.count; i++)
+		scale = LengthSqr(s.v[i].w) > scale ? LengthSqr(s.v[i].w) : scale;
+
+	for (int iteration = 0; iteration < GJK_MAX_ITERATIONS; iteration++)
+	{
+		float vv = v % v;
+		if (s.count == 4 || vv <= FLT_EPSILON * FLT_EPSILON * scale)
+			return true;
+
+		ConvexVertex &w = s.v[s.count];
+		CoreSupport(w, a, b, -v);
+		scale = LengthSqr(w.w) > scale ? LengthSqr(w.w) : scale;
+
+		// No closer than v by more than the tolerance: v is the answer
+		if (vv - (v % w.w) <= GJK_TOLERANCE * vv)
+			return false;
+		bool known = false;
+		for (int i = 0; i < s.count; i++)
+			known = known || s.v[i].w == w.w;
+		if (known)
+			return false;
+
+		s.count++;
+		v = ReduceSimplex(s);
+		if (v % v >= vv)
+			return false;
+	}
+	return false;
+}
+
+static inline void SimplexPoints(CVector &pointA, CVector &pointB, const ConvexSimplex &s)
+{
+	pointA = pointB = CVector(0.0f, 0.0f, 0.0f);
+	for (int i = 0; i < s.count; i++)
+	{
+		pointA += s.v[i].a * s.lambda[i];
+		pointB += s.v[i].b * s.lambda[i];
+	}
+}
+
+//---------------------------------------------------------------------------
+// EPA
+//
+// Starts from the final GJK simplex, grown to a tetrahedron around the
+// origin, and pushes out the face closest to the origin
+// by the support point along its normal until it is on the boundary.
+
+struct EPAFace
+{
+	int v[3];
+	CVector normal;
+	float distance;
+	bool live;
+};
+
+struct EPAPolytope
+{
+	ConvexVertex vertices[EPA_MAX_VERTICES];
+	EPAFace faces[EPA_MAX_FACES];
+	int vertexCount, faceCount;
+};
+
+// Turned away from inner, a point inside the polytope, if given; else wound
+// as passed. False if there is no room or the face is degenerate.
+static bool AddFace(EPAPolytope &p, int a, int b, int c, const CVector *inner)
+{
+	if (p.faceCount == EPA_MAX_FACES)
+		return false;
+
+	EPAFace &f = p.faces[p.faceCount];
+	CVector pa = p.vertices[a].w;
+	f.normal = (p.vertices[b].w - pa) ^ (p.vertices[c].w - pa);
+	if (inner != NULL && f.normal % (pa - *inner) < 0.0f)
+	{
+		int t = b;
+		b = c;
+		c = t;
+		f.normal = -f.normal;
+	}
+	float length = f.normal.Length();
+	if (!(length > 0.0f))
+		return false;
+
+	f.normal /= length;
+	f.distance = f.normal % pa;
+	f.v[0] = a;
+	f.v[1] = b;
+	f.v[2] = c;
+	f.live = true;
+	p.faceCount++;
+	return true;
+}
+
+// Grows the GJK simplex to a solid around the origin. False if the
+// difference is flat there.
+static bool EPAStart(EPAPolytope &p, const ConvexSimplex &s, const ConvexShape &a, const ConvexShape &b)
+{
+	p.vertexCount = s.count;
+	p.faceCount = 0;
+	for (int i = 0; i < s.count; i++)
+		p.vertices[i] = s.v[i];
+
+	if (p.vertexCount == 1)
+	{
+		static const float axes[6][3] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+		for (int k = 0; k < 6 && p.vertexCount == 1; k++)
+		{
+			FullSupport(p.vertices[1], a, b, CVector(axes[k][0], axes[k][1], axes[k][2]));
+			if (LengthSqr(p.vertices[1].w - p.vertices[0].w) > FLT_EPSILON)
+				p.vertexCount = 2;
+		}
+	}
+
+	if (p.vertexCount == 2)
+	{
+		// Around the segment in steps of 60 degrees
+		CVector d = p.vertices[1].w - p.vertices[0].w;
+		d /= d.Length();
+		CVector axis = fabs(d.x) < fabs(d.y) ? (fabs(d.x) < fabs(d.z) ? CVector(1, 0, 0) : CVector(0, 0, 1))
+											 : (fabs(d.y) < fabs(d.z) ? CVector(0, 1, 0) : CVector(0, 0, 1));
+		CVector n = d ^ axis;
+		n /= n.Length();
+		CVector m = d ^ n;
+		for (int k = 0; k < 6 && p.vertexCount == 2; k++)
+		{
+			float angle = float(k) * float(M3D_PI / 3.0);
+			FullSupport(p.vertices[2], a, b, n * cosf(angle) + m * sinf(angle));
+			CVector off = p.vertices[2].w - p.vertices[0].w;
+			if (LengthSqr(off - d * (off % d)) > FLT_EPSILON)
+				p.vertexCount = 3;
+		}
+	}
+
+	if (p.vertexCount == 3)
+	{
+		// The origin is about on the triangle: close it with an apex on the
+		// side of the origin
+		CVector n = (p.vertices[1].w - p.vertices[0].w) ^ (p.vertices[2].w - p.vertices[0].w);
+		if (n % p.vertices[0].w > 0.0f)
+			n = -n;
+		FullSupport(p.vertices[3], a, b, n);
+		if (!(n % (p.vertices[3].w - p.vertices[0].w) > FLT_EPSILON * n.Length()))
+			return false;
+		p.vertexCount = 4;
+	}
+
+	if (p.vertexCount != 4)
+		return false;
+
+	CVector inner = (p.vertices[0].w + p.vertices[1].w + p.vertices[2].w + p.vertices[3].w) * 0.25f;
+	return AddFace(p, 0, 1, 2, &inner) && AddFace(p, 0, 3, 1, &inner) &&
+		   AddFace(p, 0, 2, 3, &inner) && AddFace(p, 1, 3, 2, &inner);
+}
+
+// Barycentric weights of the projection of point onto the face
+static void FaceWeights(float lambda[3], const EPAPolytope &p, const EPAFace &f, const CVector &point)
+{
+	CVector a = p.vertices[f.v[0]].w;
+	CVector v0 = p.vertices[f.v[1]].w - a, v1 = p.vertices[f.v[2]].w - a, v2 = point - a;
+	float d00 = v0 % v0, d01 = v0 % v1, d11 = v1 % v1, d20 = v2 % v0, d21 = v2 % v1;
+	float denom = d00 * d11 - d01 * d01;
+	if (!(denom > 0.0f))
+	{
+		lambda[0] = 1.0f;
+		lambda[1] = lambda[2] = 0.0f;
+		return;
+	}
+	lambda[1] = (d11 * d20 - d01 * d21) / denom;
+	lambda[2] = (d00 * d21 - d01 * d20) / denom;
+	lambda[0] = 1.0f - lambda[1] - lambda[2];
+}
+
+// Live face nearest to the origin
+static int ClosestFace(const EPAPolytope &p)
+{
+	int closest = -1;
+	for (int i = 0; i < p.faceCount; i++)
+		if (p.faces[i].live && (closest < 0 || p.faces[i].distance < p.faces[closest].distance))
+			closest = i;
+	return closest;
+}
+
+static void EPA(ConvexResult &result, const ConvexSimplex &s, const ConvexShape &a, const ConvexShape &b)
+{
+	EPAPolytope p;
+	if (!EPAStart(p, s, a, b))
+	{
+		// Touching, or flat where they touch: no depth to speak of
+		CVector pointA, pointB;
+		SimplexPoints(pointA, pointB, s);
+		result.distance = 0.0f;
+		result.normal = b.position - a.position;
+		float length = result.normal.Length();
+		result.normal = length > 0.0f ? result.normal / length : CVector(1.0f, 0.0f, 0.0f);
+		result.pointA = pointA;
+		result.pointB = pointB;
+		return;
+	}
+
+	for (int iteration = 0; iteration < EPA_MAX_ITERATIONS; iteration++)
+	{
+		const EPAFace &face = p.faces[ClosestFace(p)];
+		if (p.vertexCount == EPA_MAX_VERTICES)
+			break;
+		ConvexVertex &w = p.vertices[p.vertexCount];
+		FullSupport(w, a, b, face.normal);
+		float reach = w.w % face.normal;
+		if (reach - face.distance <= EPA_TOLERANCE * (reach > 1.0f ? reach : 1.0f))
+			break;
+
+		// Remove the faces that see the new vertex, keeping the edges of the
+		// hole: an edge seen twice (once in each direction) is inside it.
+		// Faces about in the plane of the vertex go too, or coplanar
+		// neighbours could be split and leave a face turned inside out.
+		float coplanar = EPA_COPLANAR * (reach > 1.0f ? reach : 1.0f);
+		int edges[EPA_MAX_FACES * 3][2];
+		int edgeCount = 0;
+		for (int i = 0; i < p.faceCount; i++)
+		{
+			EPAFace &f = p.faces[i];
+			if (!f.live || f.normal % (w.w - p.vertices[f.v[0]].w) <= -coplanar)
+				continue;
+			f.live = false;
+			for (int k = 0; k < 3; k++)
+			{
+				int e0 = f.v[k], e1 = f.v[(k + 1) % 3];
+				int twin = -1;
+				for (int j = 0; j < edgeCount && twin < 0; j++)
+					if (edges[j][0] == e1 && edges[j][1] == e0)
+						twin = j;
+				if (twin >= 0)
+				{
+					edges[twin][0] = edges[edgeCount - 1][0];
+					edges[twin][1] = edges[edgeCount - 1][1];
+					edgeCount--;
+				}
+				else
+				{
+					edges[edgeCount][0] = e0;
+					edges[edgeCount][1] = e1;
+					edgeCount++;
+				}
+			}
+		}
+
+		// Compact the faces, then close the hole with a fan to the new vertex
+		int live = 0;
+		for (int i = 0; i < p.faceCount; i++)
+			if (p.faces[i].live)
+				p.faces[live++] = p.faces[i];
+		p.faceCount = live;
+
+		int vertex = p.vertexCount++;
+		bool ok = true;
+		for (int e = 0; e < edgeCount && ok; e++)
+			ok = AddFace(p, edges[e][0], edges[e][1], vertex, NULL);
+		// Out of room or degenerate: the faces kept so far still bound it
+		if (!ok)
+			break;
+	}
+
+	// Found again: after the last iteration the faces have been compacted
+	// and fanned, so an index from before would point at another face
+	const EPAFace &face = p.faces[ClosestFace(p)];
+	float lambda[3];
+	FaceWeights(lambda, p, face, face.normal * face.distance);
+	result.pointA = result.pointB = CVector(0.0f, 0.0f, 0.0f);
+	for (int k = 0; k < 3; k++)
+	{
+		result.pointA += p.vertices[face.v[k]].a * lambda[k];
+		result.pointB += p.vertices[face.v[k]].b * lambda[k];
+	}
+	result.distance = -face.distance;
+	result.normal = face.normal;
+}
+
+//---------------------------------------------------------------------------
+
+float ConvexDistance(ConvexResult &result, const ConvexShape &a, const ConvexShape &b, ConvexCache *cache)
+{
+	ConvexSimplex s;
+	CVector v;
+	bool intersect = GJK(s, v, a, b, cache);
+
+	if (cache != NULL)
+	{
+		cache->count = s.count;
+		for (int i = 0; i < s.count; i++)
+		{
+			cache->a[i] = s.v[i].localA;
+			cache->b[i] = s.v[i].localB;
+		}
+	}
+
+	float length = v.Length();
+	if (!intersect && length > 0.0f)
+	{
+		// Apart, or only the rounding overlaps
+		CVector pointA, pointB;
+		SimplexPoints(pointA, pointB, s);
+		result.normal = v / -length;
+		result.distance = length - a.radius - b.radius;
+		result.pointA = pointA + result.normal * a.radius;
+		result.pointB = pointB - result.normal * b.radius;
+	}
+	else
+		EPA(result, s, a, b);
+	return result.distance;
+}
+
+void ConvexDistances(ConvexResult *results, const ConvexShape *a, const ConvexShape *b, ConvexCache *caches, int count)
+{
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic, 64) if(count > 256)
+#endif
+	for (int i = 0; i < count; i++)
+		ConvexDistance(results[i], a[i], b[i], caches != NULL ? &caches[i] : NULL);
+}
@@ -0,0 +1,84 @@
+#ifndef CONVEX_H
+#define CONVEX_H
+#include "math3d.h"
+#include "Vector.h"
+#include "Quaternion.h"
+class Matrix;
+
+//---------------------------------------------------------------------------
+// Convex narrowphase
+//
+// Distance and penetration between convex shapes given by support mappings.
+// Every shape is a core (a point, a segment, a box or the hull of a point
+// set) rounded by a radius: a sphere is a rounded point, a capsule a
+// rounded segment. GJK runs on the cores, so curved surfaces cost nothing
+// while the shapes are apart or only the rounding overlaps; only when the
+// cores themselves intersect does EPA expand a polytope over the full
+// shapes to find the penetration.
+//
+// A cache per pair keeps the final GJK simplex, as points in the local
+// frames of the two shapes. Passed back in the next frame it starts GJK
+// from there, which for slowly moving bodies usually ends it in one or two
+// iterations.
+
+enum ConvexShapeType
+{
+	CONVEX_POINT,				// a sphere with a radius
+	CONVEX_SEGMENT,				// a capsule with a radius, along the local y axis
+	CONVEX_BOX,
+	CONVEX_HULL
+};
+
+class ConvexShape
+{
+public:
+	ConvexShape();
+
+	static ConvexShape Sphere(float radius);
+	// Cylinder part from -halfHeight to halfHeight along the local y axis
+	static ConvexShape Capsule(float radius, float halfHeight);
+	static ConvexShape Box(const CVector &extents, float radius = 0.0f);
+	// The points are referenced, not copied, and must stay alive
+	static ConvexShape Hull(const CVector *points, int count, float radius = 0.0f);
+
+	// Local to world; a matrix must be a rotation and a translation
+	void SetTransform(const CVector &position, const Quaternion &rotation);
+	void SetTransform(const Matrix &mat);
+
+	// Point of the core farthest along a direction, in local space
+	CVector LocalSupport(const CVector &direction) const;
+
+public:
+	ConvexShapeType type;
+	CVector extents;			// box half extents; a segment has its half length in y
+	float radius;
+	const CVector *points;
+	int count;
+	CVector position;
+	Quaternion rotation;
+};
+
+// Warm start data of one pair, count 0 for none
+struct ConvexCache
+{
+	CVector a[4], b[4];
+	int count;
+
+	ConvexCache() : count(0) {}
+};
+
+struct ConvexResult
+{
+	float distance;				// negative for the penetration depth
+	CVector normal;				// unit, from A towards B; B moves along it to separate
+	CVector pointA, pointB;		// closest points, or the deepest point of each in the other
+};
+
+// Returns result.distance. cache may be NULL.
+float ConvexDistance(ConvexResult &result, const ConvexShape &a, const ConvexShape &b, ConvexCache *cache = NULL);
+
+// One query per pair a[i], b[i], in parallel when built with OpenMP. caches
+// may be NULL.
+void ConvexDistances(ConvexResult *results, const ConvexShape *a, const ConvexShape *b, ConvexCache *caches, int count);
+
+#endif // CONVEX_H
@@ -0,0 +1,434 @@
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+#include "ConvexHull.h"
+
+// Points assigned in one go are split over threads above this many
+#define CONVEXHULL_PARALLEL_SIZE	8192
+// Horizon searches per point before it is given up on
+#define CONVEXHULL_MAX_ATTEMPTS		8
+// How far below a face, in epsilons, the eye may be for the face to be
+// removed along with the visible ones
+#define CONVEXHULL_FLAT				4.0f
+
+static inline float LengthSqr(const CVector &v)
+{
+	return v % v;
+}
+
+static inline int NextEdge(int e)
+{
+	return e % 3 == 2 ? e - 2 : e + 1;
+}
+
+ConvexHull::ConvexHull() : m_points(NULL), m_epsilon(0.0f), m_search(0)
+{
+
+}
+
+int ConvexHull::NewFace(int a, int b, int c)
+{
+	int f;
+	if (!m_freeFaces.empty())
+	{
+		f = m_freeFaces.back();
+		m_freeFaces.pop_back();
+	}
+	else
+	{
+		f = int(m_faces.size());
+		m_faces.push_back(Face());
+		m_edges.resize(m_edges.size() + 3);
+	}
+
+	m_edges[3 * f].vertex = a;
+	m_edges[3 * f + 1].vertex = b;
+	m_edges[3 * f + 2].vertex = c;
+	m_edges[3 * f].twin = m_edges[3 * f + 1].twin = m_edges[3 * f + 2].twin = -1;
+
+	// The plane in double, through the centroid
+	const CVector &pa = m_points[a], &pb = m_points[b], &pc = m_points[c];
+	double u[3] = {double(pb.x) - pa.x, double(pb.y) - pa.y, double(pb.z) - pa.z};
+	double v[3] = {double(pc.x) - pa.x, double(pc.y) - pa.y, double(pc.z) - pa.z};
+	double n[3] = {u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0]};
+	double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+	double scale = length > 0.0 ? 1.0 / length : 0.0;
+	double centroid[3] = {(double(pa.x) + pb.x + pc.x) / 3.0, (double(pa.y) + pb.y + pc.y) / 3.0, (double(pa.z) + pb.z + pc.z) / 3.0};
+
+	Face &face = m_faces[f];
+	face.normal = CVector(float(n[0] * scale), float(n[1] * scale), float(n[2] * scale));
+	face.offset = float(-(n[0] * centroid[0] + n[1] * centroid[1] + n[2] * centroid[2]) * scale);
+	face.outside = -1;
+	face.furthest = -1;
+	face.furthestDistance = 0.0f;
+	face.visited = -1;
+	face.forced = -1;
+	face.live = true;
+	return f;
+}
+
+float ConvexHull::Distance(const Face &face, int point) const
+{
+	return (face.normal % m_points[point]) + face.offset;
+}
+
+void ConvexHull::AddOutside(int face, int point, float distance)
+{
+	Face &f = m_faces[face];
+	m_next[point] = f.outside;
+	f.outside = point;
+	if (f.furthest < 0 || distance > f.furthestDistance)
+	{
+		f.furthest = point;
+		f.furthestDistance = distance;
+	}
+}
+
+// Each point goes to the face it is farthest above, if more than epsilon.
+// The faces are chosen in parallel, the lists built in order.
+void ConvexHull::Assign(const int *points, int count, const int *faces, int faceCount)
+{
+	if (count <= 0)
+		return;
+
+	m_assigned.resize(count);
+	m_distance.resize(count);
+
+#ifdef _OPENMP
+	#pragma omp parallel for if(count > CONVEXHULL_PARALLEL_SIZE)
+#endif
+	for (int i = 0; i < count; i++)
+	{
+		int best = -1;
+		float bestDistance = m_epsilon;
+		for (int j = 0; j < faceCount; j++)
+		{
+			float d = Distance(m_faces[faces[j]], points[i]);
+			if (d > bestDistance)
+			{
+				best = faces[j];
+				bestDistance = d;
+			}
+		}
+		m_assigned[i] = best;
+		m_distance[i] = bestDistance;
+	}
+
+	for (int i = 0; i < count; i++)
+		if (m_assigned[i] >= 0)
+			AddOutside(m_assigned[i], points[i], m_distance[i]);
+}
+
+// Depth first search over the faces the eye sees, from the face it was
+// assigned to. Edges to faces it does not see make the horizon, which the
+// search meets in order around the hole. Faces forced in an earlier attempt
+// for the same eye count as seen.
+void ConvexHull::Search(int eye, int face, int first)
+{
+	m_search++;
+	m_visible.clear();
+	m_horizon.clear();
+	m_stack.clear();
+
+	m_faces[face].visited = m_search;
+	m_visible.push_back(face);
+	// Pairs of the edge a face was entered through and the edges done
+	m_stack.push_back(3 * face);
+	m_stack.push_back(0);
+	while (!m_stack.empty())
+	{
+		int done = m_stack.back();
+		if (done == 3)
+		{
+			m_stack.resize(m_stack.size() - 2);
+			continue;
+		}
+		m_stack.back()++;
+
+		int edge = m_stack[m_stack.size() - 2];
+		for (int k = 0; k < done; k++)
+			edge = NextEdge(edge);
+
+		int twin = m_edges[edge].twin;
+		Face &neighbour = m_faces[twin / 3];
+		if (neighbour.visited == m_search)
+			continue;
+		if (neighbour.forced >= first || Distance(neighbour, eye) > m_epsilon)
+		{
+			neighbour.visited = m_search;
+			m_visible.push_back(twin / 3);
+			m_stack.push_back(twin);
+			m_stack.push_back(0);
+		}
+		else
+		{
+			m_horizon.push_back(m_edges[edge].vertex);
+			m_horizon.push_back(m_edges[NextEdge(edge)].vertex);
+			m_horizon.push_back(twin);
+		}
+	}
+}
+
+// The horizon must be one loop through distinct vertices, and every new
+// face must make a convex edge with the face behind the horizon. Near
+// coplanar points break that: the visible faces leave a hole or pinch, or a
+// new face folds back over a face the eye is only epsilon above, or is too
+// thin to have a plane. Those faces are then taken as visible too and the
+// search repeated. False if that does not settle; the eye is then left out
+// of the hull.
+bool ConvexHull::FindHorizon(int eye, int face)
+{
+	int first = m_search + 1;
+	for (int attempt = 0; attempt < CONVEXHULL_MAX_ATTEMPTS; attempt++)
+	{
+		Search(eye, face, first);
+
+		int count = int(m_horizon.size() / 3);
+		bool loop = count >= 3;
+		for (int i = 0; i < count && loop; i++)
+		{
+			int a = m_horizon[3 * i];
+			loop = m_mark[a] != m_search && m_horizon[3 * i + 1] == m_horizon[3 * ((i + 1) % count)];
+			m_mark[a] = m_search;
+		}
+
+		bool convex = true;
+		for (int i = 0; i < count; i++)
+		{
+			int a = m_horizon[3 * i], b = m_horizon[3 * i + 1], twin = m_horizon[3 * i + 2];
+			const Face &behind = m_faces[twin / 3];
+			CVector ab = m_points[b] - m_points[a];
+			CVector n = ab ^ (m_points[eye] - m_points[a]);
+			float length2 = LengthSqr(n);
+			bool valid = length2 > m_epsilon * m_epsilon * LengthSqr(ab);
+			float d = 0.0f;
+			if (valid)
+			{
+				n = n / sqrtf(length2);
+				d = n % (m_points[m_edges[NextEdge(NextEdge(twin))].vertex] - m_points[a]);
+			}
+			// A new face must face away from the inside, and must not be
+			// concave or fold back over the face behind it, which it does
+			// when the eye is nearly in the plane of that face on its side
+			// of the edge. Only a face the eye is that close to can go, or
+			// the hull could shrink.
+			bool inverted = !valid || (n % (m_interior - m_points[a])) > -m_epsilon;
+			bool flat = Distance(behind, eye) > -CONVEXHULL_FLAT * m_epsilon;
+			if (flat && (inverted || !loop || d > m_epsilon || (n % behind.normal) < 0.0f))
+			{
+				m_faces[twin / 3].forced = first;
+				convex = false;
+			}
+			else if (inverted)
+				return false;
+		}
+		if (loop && convex)
+			return true;
+	}
+	return false;
+}
+
+bool ConvexHull::AddVertex(int eye, int face)
+{
+	if (!FindHorizon(eye, face))
+		return false;
+
+	// The points of the visible faces are assigned again; their slots are
+	// reused by the new faces
+	m_orphans.clear();
+	for (size_t i = 0; i < m_visible.size(); i++)
+	{
+		Face &f = m_faces[m_visible[i]];
+		for (int p = f.outside; p >= 0; p = m_next[p])
+			if (p != eye)
+				m_orphans.push_back(p);
+		f.live = false;
+		m_freeFaces.push_back(m_visible[i]);
+	}
+
+	// A fan from the eye over the horizon, edge i of the horizon becoming
+	// the first edge of new face i
+	int count = int(m_horizon.size() / 3);
+	m_newFaces.clear();
+	for (int i = 0; i < count; i++)
+	{
+		int f = NewFace(m_horizon[3 * i], m_horizon[3 * i + 1], eye);
+		int twin = m_horizon[3 * i + 2];
+		m_edges[3 * f].twin = twin;
+		m_edges[twin].twin = 3 * f;
+		m_newFaces.push_back(f);
+	}
+	for (int i = 0; i < count; i++)
+	{
+		int e = 3 * m_newFaces[i] + 1, next = 3 * m_newFaces[(i + 1) % count] + 2;
+		m_edges[e].twin = next;
+		m_edges[next].twin = e;
+	}
+
+	Assign(m_orphans.empty() ? NULL : &m_orphans[0], int(m_orphans.size()), &m_newFaces[0], count);
+	for (int i = 0; i < count; i++)
+		if (m_faces[m_newFaces[i]].outside >= 0)
+			m_pending.push_back(m_newFaces[i]);
+	return true;
+}
+
+void ConvexHull::DropPoint(int face, int point)
+{
+	Face &f = m_faces[face];
+	int first = f.outside;
+	f.outside = -1;
+	f.furthest = -1;
+	f.furthestDistance = 0.0f;
+	for (int p = first, next; p >= 0; p = next)
+	{
+		next = m_next[p];
+		if (p != point)
+			AddOutside(face, p, Distance(f, p));
+	}
+}
+
+bool ConvexHull::Build(const CVector *points, int count, int maxVertices, float epsilon)
+{
+	m_points = points;
+	m_faces.clear();
+	m_edges.clear();
+	m_freeFaces.clear();
+	m_vertices.clear();
+	m_triangles.clear();
+	m_search = 0;
+	if (count < 4)
+		return false;
+
+	// Extreme points along the axes, and the tolerance from the magnitude of
+	// the coordinates
+	int extreme[6] = {0, 0, 0, 0, 0, 0};
+	float magnitude[3] = {0.0f, 0.0f, 0.0f};
+	for (int i = 0; i < count; i++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			float c = (&points[i].x)[k];
+			if (c < (&points[extreme[2 * k]].x)[k])
+				extreme[2 * k] = i;
+			if (c > (&points[extreme[2 * k + 1]].x)[k])
+				extreme[2 * k + 1] = i;
+			magnitude[k] = fabs(c) > magnitude[k] ? fabs(c) : magnitude[k];
+		}
+	}
+	m_epsilon = epsilon > 0.0f ? epsilon : 3.0f * FLT_EPSILON * (magnitude[0] + magnitude[1] + magnitude[2]);
+
+	// The initial tetrahedron: the farthest pair of extremes, the point
+	// farthest from their line and the point farthest from that plane
+	int a = extreme[0], b = extreme[1];
+	for (int k = 1; k < 3; k++)
+		if (LengthSqr(points[extreme[2 * k + 1]] - points[extreme[2 * k]]) > LengthSqr(points[b] - points[a]))
+		{
+			a = extreme[2 * k];
+			b = extreme[2 * k + 1];
+		}
+	CVector ab = points[b] - points[a];
+	if (LengthSqr(ab) <= m_epsilon * m_epsilon)
+		return false;
+
+	int c = -1;
+	float best = 0.0f;
+	for (int i = 0; i < count; i++)
+	{
+		float d = LengthSqr(ab ^ (points[i] - points[a]));
+		if (d > best)
+		{
+			best = d;
+			c = i;
+		}
+	}
+	if (c < 0 || best <= m_epsilon * m_epsilon * LengthSqr(ab))
+		return false;
+
+	CVector n = (ab ^ (points[c] - points[a])).UnitVector();
+	int d = -1;
+	best = 0.0f;
+	for (int i = 0; i < count; i++)
+	{
+		float h = fabs(n % (points[i] - points[a]));
+		if (h > best)
+		{
+			best = h;
+			d = i;
+		}
+	}
+	if (d < 0 || best <= m_epsilon)
+		return false;
+
+	// Base abc facing away from d
+	if ((n % (points[d] - points[a])) > 0.0f)
+		std::swap(b, c);
+
+	m_next.assign(count, -1);
+	m_mark.assign(count, -1);
+	int faces[4] = {NewFace(a, b, c), NewFace(b, a, d), NewFace(c, b, d), NewFace(a, c, d)};
+	m_interior = (points[a] + points[b] + points[c] + points[d]) * 0.25f;
+	for (int e = 0; e < 12; e++)
+		for (int g = 0; g < 12; g++)
+			if (m_edges[e].vertex == m_edges[NextEdge(g)].vertex && m_edges[NextEdge(e)].vertex == m_edges[g].vertex)
+				m_edges[e].twin = g;
+
+	m_orphans.clear();
+	for (int i = 0; i < count; i++)
+		if (i != a && i != b && i != c && i != d)
+			m_orphans.push_back(i);
+	Assign(&m_orphans[0], int(m_orphans.size()), faces, 4);
+
+	m_pending.clear();
+	for (int k = 3; k >= 0; k--)
+		if (m_faces[faces[k]].outside >= 0)
+			m_pending.push_back(faces[k]);
+
+	// Faces are taken from m_pending, the newest first, which keeps the
+	// working set small; with a vertex limit the farthest point goes first
+	int vertexCount = 4;
+	while (maxVertices < 4 || vertexCount < maxVertices)
+	{
+		int face = -1;
+		if (maxVertices >= 4)
+		{
+			for (int f = 0; f < int(m_faces.size()); f++)
+				if (m_faces[f].live && m_faces[f].outside >= 0 &&
+					(face < 0 || m_faces[f].furthestDistance > m_faces[face].furthestDistance))
+					face = f;
+		}
+		else
+		{
+			while (!m_pending.empty() && face < 0)
+			{
+				int f = m_pending.back();
+				m_pending.pop_back();
+				if (m_faces[f].live && m_faces[f].outside >= 0)
+					face = f;
+			}
+		}
+		if (face < 0)
+			break;
+
+		int eye = m_faces[face].furthest;
+		if (AddVertex(eye, face))
+			vertexCount++;
+		else
+		{
+			DropPoint(face, eye);
+			if (m_faces[face].outside >= 0)
+				m_pending.push_back(face);
+		}
+	}
+
+	for (int f = 0; f < int(m_faces.size()); f++)
+	{
+		if (!m_faces[f].live)
+			continue;
+		for (int k = 0; k < 3; k++)
+			m_triangles.push_back(m_edges[3 * f + k].vertex);
+	}
+	m_vertices = m_triangles;
+	std::sort(m_vertices.begin(), m_vertices.end());
+	m_vertices.erase(std::unique(m_vertices.begin(), m_vertices.end()), m_vertices.end());
+	return true;
+}
@@ -0,0 +1,103 @@
+#ifndef CONVEXHULL_H
+#define CONVEXHULL_H
+#include <vector>
+#include "math3d.h"
+#include "Vector.h"
+
+//---------------------------------------------------------------------------
+// class ConvexHull
+//
+// 3D convex hull of a point set by Quickhull. The hull starts as the
+// tetrahedron of four extreme points; every point outside it is assigned to
+// the face it lies farthest above. Then, face by face, the farthest point
+// of a face becomes a vertex: the faces it sees are removed, the hole is
+// closed by a fan of triangles from the point to the horizon, and the points
+// of the removed faces are assigned to the new ones.
+//
+// Assigning points is the bulk of the work on large inputs. The first
+// partition, over every input point, and any later one over many points run
+// in parallel when the library is built with OpenMP; each point is decided
+// on its own and the results linked in index order, so the hull does not
+// depend on the thread count.
+//
+// A point less than epsilon above a face counts as on it, so nearly coplanar
+// points do not break the topology. Faces are triangles, so a flat side of
+// the hull is split into several; coplanar faces are not merged. Where many
+// points lie on such a side, as on a scanned box, some of its triangles are
+// long and thin and their planes can tilt, leaving points outside the hull
+// by more than epsilon, though by far less than its size.
+//
+// Faces and half edges live in arrays that are kept from one Build to the
+// next, so hulling many assets in a row allocates little.
+
+class ConvexHull
+{
+public:
+	ConvexHull();
+
+	// False, and an empty hull, if all the points lie within epsilon of a
+	// plane. epsilon <= 0 picks one from the magnitude of the coordinates.
+	// With maxVertices >= 4 the hull stops growing at that many vertices,
+	// always adding the point farthest outside; the result is then the hull
+	// of a subset that the points may stick out of.
+	bool Build(const CVector *points, int count, int maxVertices = 0, float epsilon = 0.0f);
+
+	// Indices of the input points that are hull vertices, in ascending order
+	const int *GetVertices() const { return m_vertices.empty() ? NULL : &m_vertices[0]; }
+	int GetVertexCount() const { return int(m_vertices.size()); }
+
+	// Three indices into the input points per triangle, counterclockwise
+	// seen from outside
+	const int *GetTriangles() const { return m_triangles.empty() ? NULL : &m_triangles[0]; }
+	int GetTriangleCount() const { return int(m_triangles.size() / 3); }
+
+	float GetEpsilon() const { return m_epsilon; }
+
+private:
+	// Edges 3f to 3f + 2 belong to face f; each runs from its vertex to the
+	// vertex of the next
+	struct Edge
+	{
+		int vertex;
+		int twin;
+	};
+
+	struct Face
+	{
+		CVector normal;
+		float offset;			// normal . x + offset is the signed distance
+		int outside;			// first point of the outside set, -1 for none
+		int furthest;
+		float furthestDistance;
+		int visited;			// last horizon search that found it visible
+		int forced;				// first search of the eye that must see it
+		bool live;
+	};
+
+	int NewFace(int a, int b, int c);
+	float Distance(const Face &face, int point) const;
+	void Assign(const int *points, int count, const int *faces, int faceCount);
+	void AddOutside(int face, int point, float distance);
+	void Search(int eye, int face, int first);
+	bool FindHorizon(int eye, int face);
+	bool AddVertex(int eye, int face);
+	void DropPoint(int face, int point);
+
+	const CVector *m_points;
+	float m_epsilon;
+	CVector m_interior;					// centroid of the first tetrahedron
+	int m_search;
+	std::vector<Face> m_faces;
+	std::vector<Edge> m_edges;
+	std::vector<int> m_freeFaces;
+	std::vector<int> m_next;			// next point of the same outside set
+	std::vector<int> m_mark;			// last horizon search that met the point
+	std::vector<int> m_assigned;		// face of each point being assigned
+	std::vector<float> m_distance;
+	std::vector<int> m_pending;			// faces that may have outside points
+	std::vector<int> m_visible, m_horizon, m_orphans, m_newFaces, m_stack;
+	std::vector<int> m_vertices;
+	std::vector<int> m_triangles;
+};
+
+#endif // CONVEXHULL_H
@@ -0,0 +1,188 @@
+#include "DualQuaternion.h"
+#include "Matrix.h"
+
+// Standard (Hamilton) quaternion product a * b. Quaternion::operator* has the
+// operands the other way around, see Quaternion.h.
+static inline Quaternion Hamilton(const Quaternion &a, const Quaternion &b)
+{
+	return b * a;
+}
+
+DualQuaternion::DualQuaternion(const Quaternion &rotation, const CVector &translation)
+{
+	SetRotationTranslation(rotation, translation);
+}
+
+void DualQuaternion::Identity()
+{
+	real.Identity();
+	dual = Quaternion(0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+void DualQuaternion::SetRotationTranslation(const Quaternion &rotation, const CVector &translation)
+{
+	real = rotation;
+	dual = Hamilton(Quaternion(translation.x, translation.y, translation.z, 0.0f), rotation);
+	dual.x *= 0.5f;
+	dual.y *= 0.5f;
+	dual.z *= 0.5f;
+	dual.w *= 0.5f;
+}
+
+CVector DualQuaternion::GetTranslation() const
+{
+	// t = 2 * dual * conjugate(real)
+	Quaternion t = Hamilton(dual, real.GetConjugate());
+	return CVector(2.0f * t.x, 2.0f * t.y, 2.0f * t.z);
+}
+
+void DualQuaternion::FromMatrix(const Matrix &mat)
+{
+	// Matrix::RotationMatrix(q) holds the transpose of the rotation q
+	// applies to vectors, so the matrix rotates by the conjugate of the
+	// quaternion m3dMatToQuat returns.
+	Quaternion rot;
+	rot.FromMatrix(mat);
+	SetRotationTranslation(rot.GetConjugate(), CVector(mat.m_data[12], mat.m_data[13], mat.m_data[14]));
+}
+
+Matrix DualQuaternion::ToMatrix() const
+{
+	Matrix mat = Matrix::RotationMatrix(real.GetConjugate());
+	CVector t = GetTranslation();
+	mat.m_data[12] = t.x;
+	mat.m_data[13] = t.y;
+	mat.m_data[14] = t.z;
+	return mat;
+}
+
+DualQuaternion DualQuaternion::operator*(const DualQuaternion &dq) const
+{
+	// this first, then dq: dq * this in standard notation
+	DualQuaternion result;
+	result.real = Hamilton(dq.real, real);
+	Quaternion a = Hamilton(dq.real, dual);
+	Quaternion b = Hamilton(dq.dual, real);
+	result.dual = Quaternion(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w);
+	return result;
+}
+
+const DualQuaternion &DualQuaternion::operator*=(const DualQuaternion &dq)
+{
+	return *this = *this * dq;
+}
+
+DualQuaternion DualQuaternion::GetConjugate() const
+{
+	return DualQuaternion(real.GetConjugate(), dual.GetConjugate());
+}
+
+void DualQuaternion::Normalize()
+{
+	float mag = (float)sqrt(real.DotProduct(real));
+	if(mag <= 0.0f)
+	{
+		Identity();
+		return;
+	}
+
+	float oneOverMag = 1.0f / mag;
+	real.x *= oneOverMag; real.y *= oneOverMag; real.z *= oneOverMag; real.w *= oneOverMag;
+	dual.x *= oneOverMag; dual.y *= oneOverMag; dual.z *= oneOverMag; dual.w *= oneOverMag;
+
+	// A unit dual quaternion has real . dual == 0
+	float d = real.DotProduct(dual);
+	dual.x -= real.x * d;
+	dual.y -= real.y * d;
+	dual.z -= real.z * d;
+	dual.w -= real.w * d;
+}
+
+CVector DualQuaternion::TransformPoint(const CVector &point) const
+{
+	return real.RotateVector(point) + GetTranslation();
+}
+
+DualQuaternion DualQuaternion::ScLerp(const DualQuaternion &a, const DualQuaternion &b, float t)
+{
+	if (t <= 0.0f) return a;
+	if (t >= 1.0f) return b;
+
+	// Take the shorter path, as Quaternion::Slerp does
+	DualQuaternion to = b;
+	if (a.real.DotProduct(b.real) < 0.0f)
+	{
+		to.real = Quaternion(-b.real.x, -b.real.y, -b.real.z, -b.real.w);
+		to.dual = Quaternion(-b.dual.x, -b.dual.y, -b.dual.z, -b.dual.w);
+	}
+
+	// Relative motion a -> b in standard notation, conj(a) * b
+	DualQuaternion aInv = a.GetConjugate();
+	Quaternion r = Hamilton(aInv.real, to.real);
+	Quaternion d1 = Hamilton(aInv.real, to.dual);
+	Quaternion d2 = Hamilton(aInv.dual, to.real);
+	Quaternion e(d1.x + d2.x, d1.y + d2.y, d1.z + d2.z, d1.w + d2.w);
+
+	// Raise it to the power t through its screw parameters: rotation
+	// angle and axis, translation along the axis and moment of the axis
+	DualQuaternion step;
+	float cosHalf = r.w > 1.0f ? 1.0f : (r.w < -1.0f ? -1.0f : r.w);
+	float halfAngle = acos(cosHalf);
+	float sinHalf = sin(halfAngle);
+
+	if (fabs(sinHalf) < 1e-6f)
+	{
+		// No rotation, just scale the translation
+		step.dual = Quaternion(e.x * t, e.y * t, e.z * t, e.w * t);
+	}
+	else
+	{
+		float oneOverSin = 1.0f / sinHalf;
+		CVector axis(r.x * oneOverSin, r.y * oneOverSin, r.z * oneOverSin);
+		float pitch = -2.0f * e.w * oneOverSin;
+		CVector moment = (CVector(e.x, e.y, e.z) - axis * (pitch * 0.5f * cosHalf)) * oneOverSin;
+
+		halfAngle *= t;
+		pitch *= t;
+		float s = sin(halfAngle);
+		float c = cos(halfAngle);
+
+		step.real = Quaternion(axis.x * s, axis.y * s, axis.z * s, c);
+		CVector dv = moment * s + axis * (pitch * 0.5f * c);
+		step.dual = Quaternion(dv.x, dv.y, dv.z, -pitch * 0.5f * s);
+	}
+
+	// a followed by the partial motion: a * step in standard notation
+	DualQuaternion result;
+	result.real = Hamilton(a.real, step.real);
+	Quaternion p1 = Hamilton(a.real, step.dual);
+	Quaternion p2 = Hamilton(a.dual, step.real);
+	result.dual = Quaternion(p1.x + p2.x, p1.y + p2.y, p1.z + p2.z, p1.w + p2.w);
+	return result;
+}
+
+DualQuaternion DualQuaternion::Blend(const DualQuaternion *dqs, const float *weights, int count)
+{
+	DualQuaternion result(Quaternion(0.0f, 0.0f, 0.0f, 0.0f), Quaternion(0.0f, 0.0f, 0.0f, 0.0f));
+	if (count <= 0)
+	{
+		result.Identity();
+		return result;
+	}
+
+	const Quaternion &pivot = dqs[0].real;
+	for (int i = 0; i < count; i++)
+	{
+		float w = weights[i];
+		if (pivot.DotProduct(dqs[i].real) < 0.0f)
+			w = -w;
+
+		result.real.x += dqs[i].real.x * w; result.real.y += dqs[i].real.y * w;
+		result.real.z += dqs[i].real.z * w; result.real.w += dqs[i].real.w * w;
+		result.dual.x += dqs[i].dual.x * w; result.dual.y += dqs[i].dual.y * w;
+		result.dual.z += dqs[i].dual.z * w; result.dual.w += dqs[i].dual.w * w;
+	}
+
+	result.Normalize();
+	return result;
+}
@@ -0,0 +1,58 @@
+#ifndef DUALQUATERNION_H
+#define DUALQUATERNION_H
+#include "Quaternion.h"
+#include "Vector.h"
+class Matrix;
+
+//---------------------------------------------------------------------------
+// class DualQuaternion
+//
+// A rigid transform (rotation followed by translation) as a unit dual
+// quaternion real + e * dual. The rotation is the one Quaternion::RotateVector
+// applies and dual = 0.5 * t * real (standard quaternion product).
+//
+// Concatenation follows Quaternion: a * b applies a first, then b.
+
+class DualQuaternion
+{
+public:
+	Quaternion real;
+	Quaternion dual;
+
+	DualQuaternion() : real(0.0f, 0.0f, 0.0f, 1.0f), dual(0.0f, 0.0f, 0.0f, 0.0f) {}
+	DualQuaternion(const Quaternion &r, const Quaternion &d) : real(r), dual(d) {}
+	DualQuaternion(const Quaternion &rotation, const CVector &translation);
+
+	void Identity();
+	void SetRotationTranslation(const Quaternion &rotation, const CVector &translation);
+
+	const Quaternion &GetRotation() const { return real; }
+	CVector GetTranslation() const;
+
+	// Conversion from and to rigid Matrix transforms. Scale is not
+	// representable and must not be present in the matrix.
+	void FromMatrix(const Matrix &mat);
+	Matrix ToMatrix() const;
+
+	DualQuaternion operator*(const DualQuaternion &dq) const;
+	const DualQuaternion &operator*=(const DualQuaternion &dq);
+
+	// Inverse of a unit dual quaternion
+	DualQuaternion GetConjugate() const;
+
+	// Bring back to unit length after blending or drift
+	void Normalize();
+
+	CVector TransformPoint(const CVector &point) const;
+	CVector TransformVector(const CVector &vec) const { return real.RotateVector(vec); }
+
+	// Screw linear interpolation, constant speed along the screw motion
+	// from a to b
+	static DualQuaternion ScLerp(const DualQuaternion &a, const DualQuaternion &b, float t);
+
+	// Dual quaternion linear blending: weighted sum with every term moved
+	// to the hemisphere of the first, then normalized
+	static DualQuaternion Blend(const DualQuaternion *dqs, const float *weights, int count);
+};
+
+#endif // DUALQUATERNION_H
@@ -0,0 +1,228 @@
+#include <float.h>
+#include "Fitting.h"
+#include "Matrix.h"
+
+// Points per block of CovarianceAccumulator::Add. Each block is summed in two
+// passes (mean, then moments) while it is in the cache and merged into the
+// total; blocks are shared out over threads when built with OpenMP.
+#define FITTING_BLOCK_SIZE		4096
+#define FITTING_MAX_PARTS		64
+
+CovarianceAccumulator::CovarianceAccumulator()
+{
+	Reset();
+}
+
+void CovarianceAccumulator::Reset()
+{
+	m_count = 0.0;
+	for (int k = 0; k < 3; k++)
+		m_mean[k] = 0.0;
+	for (int k = 0; k < 6; k++)
+		m_moments[k] = 0.0;
+}
+
+void CovarianceAccumulator::Add(const CVector &point)
+{
+	m_count += 1.0;
+	double d[3] = {point.x - m_mean[0], point.y - m_mean[1], point.z - m_mean[2]};
+	for (int k = 0; k < 3; k++)
+		m_mean[k] += d[k] / m_count;
+
+	// Welford: deviation from the old mean times deviation from the new one
+	double e[3] = {point.x - m_mean[0], point.y - m_mean[1], point.z - m_mean[2]};
+	m_moments[0] += d[0] * e[0];
+	m_moments[1] += d[0] * e[1];
+	m_moments[2] += d[0] * e[2];
+	m_moments[3] += d[1] * e[1];
+	m_moments[4] += d[1] * e[2];
+	m_moments[5] += d[2] * e[2];
+}
+
+// Accumulator of one block of points
+static CovarianceAccumulator AccumulateBlock(const CVector *points, int count)
+{
+	CovarianceAccumulator block;
+	double sx = 0.0, sy = 0.0, sz = 0.0;
+	for (int i = 0; i < count; i++)
+	{
+		sx += points[i].x;
+		sy += points[i].y;
+		sz += points[i].z;
+	}
+	double mx = sx / count, my = sy / count, mz = sz / count;
+
+	double xx = 0.0, xy = 0.0, xz = 0.0, yy = 0.0, yz = 0.0, zz = 0.0;
+	for (int i = 0; i < count; i++)
+	{
+		double x = points[i].x - mx, y = points[i].y - my, z = points[i].z - mz;
+		xx += x * x;
+		xy += x * y;
+		xz += x * z;
+		yy += y * y;
+		yz += y * z;
+		zz += z * z;
+	}
+
+	block.m_count = count;
+	block.m_mean[0] = mx;
+	block.m_mean[1] = my;
+	block.m_mean[2] = mz;
+	block.m_moments[0] = xx;
+	block.m_moments[1] = xy;
+	block.m_moments[2] = xz;
+	block.m_moments[3] = yy;
+	block.m_moments[4] = yz;
+	block.m_moments[5] = zz;
+	return block;
+}
+
+void CovarianceAccumulator::Add(const CVector *points, int count)
+{
+	if (count <= 0)
+		return;
+
+	// Split into at most FITTING_MAX_PARTS contiguous parts merged in a fixed
+	// order, so the result does not depend on the number of threads
+	int blocks = (count + FITTING_BLOCK_SIZE - 1) / FITTING_BLOCK_SIZE;
+	int parts = blocks < FITTING_MAX_PARTS ? blocks : FITTING_MAX_PARTS;
+	CovarianceAccumulator partial[FITTING_MAX_PARTS];
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if(parts > 1)
+#endif
+	for (int p = 0; p < parts; p++)
+	{
+		for (int b = blocks * p / parts; b < blocks * (p + 1) / parts; b++)
+		{
+			int begin = b * FITTING_BLOCK_SIZE;
+			int end = begin + FITTING_BLOCK_SIZE < count ? begin + FITTING_BLOCK_SIZE : count;
+			partial[p].Add(AccumulateBlock(points + begin, end - begin));
+		}
+	}
+
+	for (int p = 0; p < parts; p++)
+		Add(partial[p]);
+}
+
+// Chan et al.: the moments of the union are the moments of the parts plus
+// the spread of the two means
+void CovarianceAccumulator::Add(const CovarianceAccumulator &other)
+{
+	if (other.m_count == 0.0)
+		return;
+	if (m_count == 0.0)
+	{
+		*this = other;
+		return;
+	}
+
+	double count = m_count + other.m_count;
+	double d[3] = {other.m_mean[0] - m_mean[0], other.m_mean[1] - m_mean[1], other.m_mean[2] - m_mean[2]};
+	double f = m_count * other.m_count / count;
+
+	m_moments[0] += other.m_moments[0] + d[0] * d[0] * f;
+	m_moments[1] += other.m_moments[1] + d[0] * d[1] * f;
+	m_moments[2] += other.m_moments[2] + d[0] * d[2] * f;
+	m_moments[3] += other.m_moments[3] + d[1] * d[1] * f;
+	m_moments[4] += other.m_moments[4] + d[1] * d[2] * f;
+	m_moments[5] += other.m_moments[5] + d[2] * d[2] * f;
+	for (int k = 0; k < 3; k++)
+		m_mean[k] += d[k] * other.m_count / count;
+	m_count = count;
+}
+
+int CovarianceAccumulator::GetCount() const
+{
+	return int(m_count);
+}
+
+CVector CovarianceAccumulator::GetMean() const
+{
+	return CVector(float(m_mean[0]), float(m_mean[1]), float(m_mean[2]));
+}
+
+void CovarianceAccumulator::GetCovariance(M3DMatrix33d covariance) const
+{
+	double inv = m_count > 0.0 ? 1.0 / m_count : 0.0;
+	covariance[0] = m_moments[0] * inv;
+	covariance[1] = covariance[3] = m_moments[1] * inv;
+	covariance[2] = covariance[6] = m_moments[2] * inv;
+	covariance[4] = m_moments[3] * inv;
+	covariance[5] = covariance[7] = m_moments[4] * inv;
+	covariance[8] = m_moments[5] * inv;
+}
+
+bool FitPlane(M3DVector4f plane, const CovarianceAccumulator &points)
+{
+	if (points.m_count < 3.0)
+		return false;
+
+	M3DMatrix33d covariance, axes;
+	M3DVector3d variance;
+	points.GetCovariance(covariance);
+	m3dEigenSymmetric33(axes, variance, covariance);
+
+	// A line (or a point) has no unique plane
+	if (variance[1] <= variance[0] * 1e-12)
+		return false;
+
+	plane[0] = float(axes[6]);
+	plane[1] = float(axes[7]);
+	plane[2] = float(axes[8]);
+	plane[3] = float(-(axes[6] * points.m_mean[0] + axes[7] * points.m_mean[1] + axes[8] * points.m_mean[2]));
+	return true;
+}
+
+bool FitPlane(M3DVector4f plane, const CVector *points, int count)
+{
+	CovarianceAccumulator accumulator;
+	accumulator.Add(points, count);
+	return FitPlane(plane, accumulator);
+}
+
+bool FitOBB(Matrix &box, const CVector *points, int count)
+{
+	if (count <= 0)
+		return false;
+
+	CovarianceAccumulator accumulator;
+	accumulator.Add(points, count);
+	M3DMatrix33d covariance, axesd;
+	M3DVector3d variance;
+	accumulator.GetCovariance(covariance);
+	m3dEigenSymmetric33(axesd, variance, covariance);
+
+	// Extents along the axes, relative to the mean to keep the precision
+	CVector axes[3];
+	for (int k = 0; k < 3; k++)
+		axes[k] = CVector(float(axesd[k*3]), float(axesd[k*3+1]), float(axesd[k*3+2]));
+	CVector mean = accumulator.GetMean();
+
+	float lo[3] = {FLT_MAX, FLT_MAX, FLT_MAX}, hi[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+	for (int i = 0; i < count; i++)
+	{
+		CVector p = points[i] - mean;
+		for (int k = 0; k < 3; k++)
+		{
+			float d = p % axes[k];
+			lo[k] = d < lo[k] ? d : lo[k];
+			hi[k] = d > hi[k] ? d : hi[k];
+		}
+	}
+
+	box.LoadIdentity();
+	CVector centre = mean;
+	for (int k = 0; k < 3; k++)
+	{
+		CVector axis = axes[k] * (0.5f * (hi[k] - lo[k]));
+		box.m_data[k*4] = axis.x;
+		box.m_data[k*4+1] = axis.y;
+		box.m_data[k*4+2] = axis.z;
+		centre += axes[k] * (0.5f * (hi[k] + lo[k]));
+	}
+	box.m_data[12] = centre.x;
+	box.m_data[13] = centre.y;
+	box.m_data[14] = centre.z;
+	return true;
+}
@@ -0,0 +1,47 @@
+#ifndef FITTING_H
+#define FITTING_H
+#include "math3d.h"
+#include "Vector.h"
+class Matrix;
+
+//---------------------------------------------------------------------------
+// Least squares fitting to point sets
+//
+// The covariance of a point set is accumulated in double precision around
+// the running mean, so it stays accurate far from the origin. Accumulators
+// for separate parts of a set (chunks streamed in, other threads) can be
+// merged into one.
+
+class CovarianceAccumulator
+{
+public:
+	CovarianceAccumulator();
+
+	void Reset();
+	void Add(const CVector &point);
+	void Add(const CVector *points, int count);
+	void Add(const CovarianceAccumulator &other);
+
+	int GetCount() const;
+	CVector GetMean() const;
+	// Population covariance, sum of (p - mean)(p - mean)^T over count
+	void GetCovariance(M3DMatrix33d covariance) const;
+public:
+	double m_count;
+	double m_mean[3];
+	double m_moments[6];		// xx, xy, xz, yy, yz, zz sums around the mean
+};
+
+// Best fit plane in the form of m3dGetPlaneEquation: unit normal along the
+// direction of least variance, through the mean. The sign of the normal is
+// arbitrary. Returns false for fewer than three points or points on a line.
+bool FitPlane(M3DVector4f plane, const CovarianceAccumulator &points);
+bool FitPlane(M3DVector4f plane, const CVector *points, int count);
+
+// Oriented bounding box along the principal axes of the points. box maps
+// the cube [-1, 1]^3 onto the box: its columns are the axes, in order of
+// decreasing variance, scaled by the half extents, and its translation is
+// the centre. A flat set gives a zero column. Returns false for no points.
+bool FitOBB(Matrix &box, const CVector *points, int count);
+
+#endif // FITTING_H
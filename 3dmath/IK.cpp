@@ -0,0 +1,300 @@
+#include <assert.h>
+#include <math.h>
+#include "IK.h"
+
+static inline float Clamp(float x, float lo, float hi)
+{
+	return x < lo ? lo : (x > hi ? hi : x);
+}
+
+static inline Quaternion AxisAngle(const CVector &unitAxis, float angle)
+{
+	float s = sin(angle * 0.5f);
+	return Quaternion(unitAxis.x * s, unitAxis.y * s, unitAxis.z * s, cos(angle * 0.5f));
+}
+
+// Any unit vector perpendicular to v
+static CVector Perpendicular(const CVector &v)
+{
+	CVector axis = fabs(v.x) < fabs(v.y) ? (fabs(v.x) < fabs(v.z) ? CVector(1, 0, 0) : CVector(0, 0, 1))
+										 : (fabs(v.y) < fabs(v.z) ? CVector(0, 1, 0) : CVector(0, 0, 1));
+	return (v ^ axis).UnitVector();
+}
+
+// Shortest rotation taking the direction of from to the direction of to
+static Quaternion FromTo(const CVector &from, const CVector &to)
+{
+	float len = sqrt((from % from) * (to % to));
+	if (len == 0.0f)
+		return Quaternion();
+
+	float w = len + (from % to);
+	if (w < 1e-6f * len)
+	{
+		// Opposite: half a turn about any perpendicular axis
+		CVector axis = Perpendicular(from);
+		return Quaternion(axis.x, axis.y, axis.z, 0.0f);
+	}
+
+	CVector axis = from ^ to;
+	Quaternion q(axis.x, axis.y, axis.z, w);
+	q.Normalize();
+	return q;
+}
+
+// Limit the unit direction dir to a cone of half angle maxAngle around the
+// unit axis
+static CVector ConstrainCone(const CVector &dir, const CVector &axis, float maxAngle)
+{
+	float cosAngle = dir % axis;
+	if (cosAngle >= cos(maxAngle))
+		return dir;
+
+	CVector perp = dir - axis * cosAngle;
+	float perpLength = perp.Length();
+	perp = perpLength > 1e-6f ? perp / perpLength : Perpendicular(axis);
+	return axis * cos(maxAngle) + perp * sin(maxAngle);
+}
+
+static inline bool HasLimit(const IKChainSettings &settings, int joint, int count)
+{
+	return settings.maxBend != NULL && joint > 0 && joint < count - 1;
+}
+
+bool SolveTwoBoneIK(Quaternion &rootDelta, Quaternion &midDelta, const CVector &root, const CVector &mid, const CVector &end,
+					const CVector &target, const CVector &pole)
+{
+	CVector ab = mid - root, bc = end - mid, at = target - root;
+	float lab = ab.Length(), lbc = bc.Length(), lat = at.Length();
+	float eps = 1e-5f * (lab + lbc);
+
+	rootDelta.Identity();
+	midDelta.Identity();
+	if (lab <= eps || lbc <= eps)
+		return false;
+
+	bool reached = lat <= lab + lbc && lat >= fabs(lab - lbc);
+	float reach = Clamp(lat, fabs(lab - lbc) + eps, lab + lbc - eps);
+
+	// Bend the middle joint until end is reach away from root. The interior
+	// angle between b->a and b->c that gives reach follows from the law of
+	// cosines; the current one is taken with atan2, which unlike acos stays
+	// accurate for a nearly straight limb.
+	CVector toPole = pole - root;
+	CVector normal = (-ab) ^ bc;
+	float sine = normal.Length();
+	float angle0 = atan2(sine, -(ab % bc));
+	float cos1 = Clamp((lab * lab + lbc * lbc - reach * reach) / (2.0f * lab * lbc), -1.0f, 1.0f);
+
+	// The bend axis is the normal of the limb plane, of the plane through the
+	// pole for a straight limb, else any. A straight limb leaves rounding
+	// noise in the cross product, so it is measured against the bone lengths.
+	if (sine > 1e-4f * lab * lbc)
+		normal /= sine;
+	else
+	{
+		normal = (-ab) ^ toPole;
+		sine = normal.Length();
+		normal = sine > 1e-4f * lab * toPole.Length() ? normal / sine : Perpendicular(ab);
+	}
+	Quaternion bend = AxisAngle(normal, acos(cos1) - angle0);
+
+	if (lat <= eps)
+	{
+		midDelta = bend;
+		return false;
+	}
+
+	// Swing the whole limb onto the target
+	Quaternion swing = FromTo(bend.RotateVector(bc) + ab, at);
+
+	// Twist about root->target so the middle joint faces the pole
+	CVector axis = at / lat;
+	CVector knee = swing.RotateVector(ab);
+	knee -= axis * (axis % knee);
+	toPole -= axis * (axis % toPole);
+	Quaternion twist;
+	if (knee.Length() > eps && toPole.Length() > eps)
+		twist = AxisAngle(axis, atan2(axis % (knee ^ toPole), knee % toPole));
+
+	rootDelta = swing * twist;
+	midDelta = bend * rootDelta;
+	return reached;
+}
+
+bool SolveFABRIK(CVector *joints, int count, const CVector &target, const IKChainSettings &settings)
+{
+	assert(count >= 2 && count <= IK_MAX_JOINTS);
+
+	float lengths[IK_MAX_JOINTS];
+	float total = 0.0f;
+	for (int i = 0; i < count - 1; i++)
+	{
+		lengths[i] = (joints[i + 1] - joints[i]).Length();
+		total += lengths[i];
+	}
+
+	CVector root = joints[0];
+	float tolerance2 = settings.tolerance * settings.tolerance;
+
+	// Out of reach: stretch towards the target
+	CVector toTarget = target - root;
+	if (toTarget % toTarget >= total * total)
+	{
+		CVector dir = toTarget.Length() > 0.0f ? toTarget.UnitVector() : CVector(0, 1, 0);
+		for (int i = 0; i < count - 1; i++)
+			joints[i + 1] = joints[i] + dir * lengths[i];
+		CVector miss = joints[count - 1] - target;
+		return miss % miss <= tolerance2;
+	}
+
+	for (int iter = 0; iter < settings.maxIterations; iter++)
+	{
+		CVector miss = joints[count - 1] - target;
+		if (miss % miss <= tolerance2)
+			return true;
+
+		// Backward: pin the end to the target
+		joints[count - 1] = target;
+		for (int i = count - 2; i >= 0; i--)
+		{
+			CVector dir = joints[i] - joints[i + 1];
+			float len = dir.Length();
+			joints[i] = joints[i + 1] + (len > 0.0f ? dir * (lengths[i] / len) : CVector());
+		}
+
+		// Forward: pin the root back, applying the joint limits
+		joints[0] = root;
+		for (int i = 0; i < count - 1; i++)
+		{
+			CVector dir = joints[i + 1] - joints[i];
+			float len = dir.Length();
+			dir = len > 0.0f ? dir / len : (i > 0 ? (joints[i] - joints[i - 1]).UnitVector() : CVector(0, 1, 0));
+			if (HasLimit(settings, i, count))
+				dir = ConstrainCone(dir, (joints[i] - joints[i - 1]) / lengths[i - 1], settings.maxBend[i]);
+			joints[i + 1] = joints[i] + dir * lengths[i];
+		}
+	}
+
+	CVector miss = joints[count - 1] - target;
+	return miss % miss <= tolerance2;
+}
+
+bool SolveCCD(CVector *joints, int count, const CVector &target, const IKChainSettings &settings)
+{
+	assert(count >= 2 && count <= IK_MAX_JOINTS);
+	float tolerance2 = settings.tolerance * settings.tolerance;
+
+	for (int iter = 0; iter < settings.maxIterations; iter++)
+	{
+		CVector miss = joints[count - 1] - target;
+		if (miss % miss <= tolerance2)
+			return true;
+
+		// From the joint next to the end back to the root, turn the rest of
+		// the chain so the end points at the target
+		for (int i = count - 2; i >= 0; i--)
+		{
+			const CVector pivot = joints[i];
+			Quaternion q = FromTo(joints[count - 1] - pivot, target - pivot);
+
+			if (HasLimit(settings, i, count))
+			{
+				CVector parent = (pivot - joints[i - 1]).UnitVector();
+				CVector bone = q.RotateVector(joints[i + 1] - pivot);
+				float len = bone.Length();
+				if (len > 0.0f)
+				{
+					bone /= len;
+					q = q * FromTo(bone, ConstrainCone(bone, parent, settings.maxBend[i]));
+				}
+			}
+
+			for (int k = i + 1; k < count; k++)
+				joints[k] = pivot + q.RotateVector(joints[k] - pivot);
+		}
+	}
+
+	CVector miss = joints[count - 1] - target;
+	return miss % miss <= tolerance2;
+}
+
+void IKChainDeltas(Quaternion *deltas, const CVector *before, const CVector *after, int count)
+{
+	for (int i = 0; i < count - 1; i++)
+		deltas[i] = FromTo(before[i + 1] - before[i], after[i + 1] - after[i]);
+}
+
+//---------------------------------------------------------------------------
+// Batches
+
+int SolveTwoBoneIK(const IKTwoBoneSoA &chains, int count)
+{
+	int reached = 0;
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) reduction(+:reached) if(count > 256)
+#endif
+	for (int i = 0; i < count; i++)
+	{
+		Quaternion rootDelta, midDelta;
+		if (SolveTwoBoneIK(rootDelta, midDelta,
+						   CVector(chains.root[0][i], chains.root[1][i], chains.root[2][i]),
+						   CVector(chains.mid[0][i], chains.mid[1][i], chains.mid[2][i]),
+						   CVector(chains.end[0][i], chains.end[1][i], chains.end[2][i]),
+						   CVector(chains.target[0][i], chains.target[1][i], chains.target[2][i]),
+						   CVector(chains.pole[0][i], chains.pole[1][i], chains.pole[2][i])))
+			reached++;
+
+		for (int k = 0; k < 4; k++)
+		{
+			chains.rootDelta[k][i] = (&rootDelta.x)[k];
+			chains.midDelta[k][i] = (&midDelta.x)[k];
+		}
+	}
+	return reached;
+}
+
+typedef bool (*IKChainSolver)(CVector *joints, int count, const CVector &target, const IKChainSettings &settings);
+
+// Gather each chain into a local array, solve it and scatter it back
+static int SolveChains(IKChainSolver solver, const IKChainSoA &chains, const IKChainSettings &settings)
+{
+	assert(chains.joints >= 2 && chains.joints <= IK_MAX_JOINTS);
+	int reached = 0;
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) reduction(+:reached) if(chains.chains > 64)
+#endif
+	for (int c = 0; c < chains.chains; c++)
+	{
+		CVector joints[IK_MAX_JOINTS];
+		for (int j = 0; j < chains.joints; j++)
+		{
+			int index = j * chains.chains + c;
+			joints[j] = CVector(chains.joint[0][index], chains.joint[1][index], chains.joint[2][index]);
+		}
+
+		if (solver(joints, chains.joints, CVector(chains.target[0][c], chains.target[1][c], chains.target[2][c]), settings))
+			reached++;
+
+		for (int j = 0; j < chains.joints; j++)
+		{
+			int index = j * chains.chains + c;
+			chains.joint[0][index] = joints[j].x;
+			chains.joint[1][index] = joints[j].y;
+			chains.joint[2][index] = joints[j].z;
+		}
+	}
+	return reached;
+}
+
+int SolveFABRIK(const IKChainSoA &chains, const IKChainSettings &settings)
+{
+	return SolveChains(SolveFABRIK, chains, settings);
+}
+
+int SolveCCD(const IKChainSoA &chains, const IKChainSettings &settings)
+{
+	return SolveChains(SolveCCD, chains, settings);
+}
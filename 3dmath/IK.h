@@ -0,0 +1,75 @@
+#ifndef IK_H
+#define IK_H
+#include "Quaternion.h"
+#include "Vector.h"
+
+//---------------------------------------------------------------------------
+// Inverse kinematics
+//
+// All solvers work on joint positions in one (world or model) space and
+// never allocate; chains are limited to IK_MAX_JOINTS joints. Rotations are
+// deltas in the same space, in the sense of Quaternion::RotateVector: apply
+// one to a bone by concatenating it after the bone's current global
+// rotation, global * delta in Quaternion order.
+
+#define IK_MAX_JOINTS	64
+
+// Analytic two bone solver (arm, leg). root, mid and end are the current
+// joint positions, pole a point the middle joint should bend towards. The
+// middle joint only bends about the axis normal to the limb plane, so a
+// hinge stays a hinge. A target out of reach is approached as far as the
+// limb goes. Returns true if the target was reached.
+bool SolveTwoBoneIK(Quaternion &rootDelta, Quaternion &midDelta, const CVector &root, const CVector &mid, const CVector &end,
+					const CVector &target, const CVector &pole);
+
+struct IKChainSettings
+{
+	int maxIterations;
+	float tolerance;			// distance from end to target that counts as reached
+	const float *maxBend;		// per joint maximum angle (radians) between the bones
+								// in and out of the joint; NULL for no limits.
+								// Entries for the first and last joint are not used.
+};
+
+// Iterative solvers for chains of count joints, updated in place. Bone
+// lengths are those of the current pose and are kept. Return true if the end
+// came within tolerance of the target. FABRIK converges in fewer, cheaper
+// iterations; CCD favours bending the joints near the end.
+bool SolveFABRIK(CVector *joints, int count, const CVector &target, const IKChainSettings &settings);
+bool SolveCCD(CVector *joints, int count, const CVector &target, const IKChainSettings &settings);
+
+// Rotation deltas (see above) that take the bones of a chain from the pose
+// before to the pose after a solve, one per bone (count - 1 of them).
+void IKChainDeltas(Quaternion *deltas, const CVector *before, const CVector *after, int count);
+
+//---------------------------------------------------------------------------
+// Batches of independent chains in SoA form, one float array per
+// component. Chains are distributed over threads when built with OpenMP.
+
+struct IKTwoBoneSoA
+{
+	const float *root[3];
+	const float *mid[3];
+	const float *end[3];
+	const float *target[3];
+	const float *pole[3];
+	float *rootDelta[4];		// x, y, z, w
+	float *midDelta[4];
+};
+
+// Joint j of chain c is at joint[k][j * chains + c], so the same joint of
+// neighbouring chains is contiguous.
+struct IKChainSoA
+{
+	float *joint[3];
+	const float *target[3];
+	int joints;
+	int chains;
+};
+
+// Solve count two bone chains, returns the number that reached their target
+int SolveTwoBoneIK(const IKTwoBoneSoA &chains, int count);
+int SolveFABRIK(const IKChainSoA &chains, const IKChainSettings &settings);
+int SolveCCD(const IKChainSoA &chains, const IKChainSettings &settings);
+
+#endif // IK_H
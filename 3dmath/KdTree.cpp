@@ -0,0 +1,325 @@
+#include <algorithm>
+#include "KdTree.h"
+
+// Subtrees are built in parallel below this depth, and only if large
+#define KDTREE_PARALLEL_DEPTH	6
+#define KDTREE_PARALLEL_SIZE	16384
+// Queries per part of a batch, parts are shared out over threads
+#define KDTREE_BATCH_SIZE		256
+
+struct KdPoint
+{
+	float p[3];
+	int index;
+};
+
+struct KdAxisLess
+{
+	int axis;
+	bool operator()(const KdPoint &a, const KdPoint &b) const { return a.p[axis] < b.p[axis]; }
+};
+
+struct KdBuildJob
+{
+	int node, begin, end, depth;
+};
+
+struct KdBuilder
+{
+	KdPoint *points;
+	KdNode *nodes;
+	int leafSize;
+	std::vector<KdBuildJob> jobs;
+};
+
+// A subtree to visit, with a lower bound of the squared distance from the
+// query to its region
+struct KdStackEntry
+{
+	int node, begin, end;
+	float bound;
+};
+
+static void BuildRange(KdBuilder &b, int node, int begin, int end, int depth, bool parallel)
+{
+	while (end - begin > b.leafSize)
+	{
+		if (parallel && depth >= KDTREE_PARALLEL_DEPTH)
+		{
+			KdBuildJob job = {node, begin, end, depth};
+			b.jobs.push_back(job);
+			return;
+		}
+
+		float lo[3] = {FLT_MAX, FLT_MAX, FLT_MAX}, hi[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+		for (int i = begin; i < end; i++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				lo[k] = b.points[i].p[k] < lo[k] ? b.points[i].p[k] : lo[k];
+				hi[k] = b.points[i].p[k] > hi[k] ? b.points[i].p[k] : hi[k];
+			}
+		}
+
+		KdAxisLess less;
+		less.axis = 0;
+		for (int k = 1; k < 3; k++)
+			if (hi[k] - lo[k] > hi[less.axis] - lo[less.axis])
+				less.axis = k;
+
+		int mid = begin + (end - begin) / 2;
+		std::nth_element(b.points + begin, b.points + mid, b.points + end, less);
+		b.nodes[node].axis = less.axis;
+		b.nodes[node].split = b.points[mid].p[less.axis];
+
+		BuildRange(b, 2 * node + 1, begin, mid, depth + 1, parallel);
+		node = 2 * node + 2;
+		begin = mid;
+		depth++;
+	}
+}
+
+KdTree::KdTree() : m_leafSize(8)
+{
+
+}
+
+void KdTree::Build(const CVector *points, int count, int leafSize)
+{
+	if (count > 0)
+		BuildStrided(&points[0].x, &points[0].y, &points[0].z, sizeof(CVector) / sizeof(float), count, leafSize);
+	else
+		BuildStrided(NULL, NULL, NULL, 0, 0, leafSize);
+}
+
+void KdTree::Build(const float *x, const float *y, const float *z, int count, int leafSize)
+{
+	BuildStrided(x, y, z, 1, count, leafSize);
+}
+
+void KdTree::BuildStrided(const float *x, const float *y, const float *z, int stride, int count, int leafSize)
+{
+	count = count > 0 ? count : 0;
+	m_leafSize = leafSize < 1 ? 1 : leafSize;
+
+	// Levels until every range fits in a leaf; the inner nodes of a complete
+	// tree that deep
+	int levels = 0;
+	for (int c = count; c > m_leafSize; c = (c + 1) / 2)
+		levels++;
+	m_nodes.assign(levels > 0 ? (size_t(1) << levels) - 1 : 0, KdNode());
+
+	std::vector<KdPoint> points(count);
+	for (int i = 0; i < count; i++)
+	{
+		points[i].p[0] = x[i * stride];
+		points[i].p[1] = y[i * stride];
+		points[i].p[2] = z[i * stride];
+		points[i].index = i;
+	}
+
+	if (count > 0)
+	{
+		KdBuilder b;
+		b.points = &points[0];
+		b.nodes = m_nodes.empty() ? NULL : &m_nodes[0];
+		b.leafSize = m_leafSize;
+		BuildRange(b, 0, 0, count, 0, count > KDTREE_PARALLEL_SIZE);
+
+		int jobs = int(b.jobs.size());
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(dynamic, 1)
+#endif
+		for (int j = 0; j < jobs; j++)
+			BuildRange(b, b.jobs[j].node, b.jobs[j].begin, b.jobs[j].end, b.jobs[j].depth, false);
+	}
+
+	m_points.resize(count);
+	m_order.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		m_points[i] = CVector(points[i].p[0], points[i].p[1], points[i].p[2]);
+		m_order[i] = points[i].index;
+	}
+}
+
+// k best so far in indices/distances2, sorted by distance. A subtree is
+// skipped when even its closest possible point, shrunk by (1 + epsilon),
+// cannot beat the current k-th.
+int KdTree::Nearest(int *indices, float *distances2, int k, const CVector &point, float maxDistance2, float epsilon) const
+{
+	int count = int(m_points.size());
+	if (count == 0 || k <= 0)
+		return 0;
+
+	const float q[3] = {point.x, point.y, point.z};
+	float scale = (1.0f + epsilon) * (1.0f + epsilon);
+	int found = 0;
+	float limit = maxDistance2;
+
+	KdStackEntry stack[KDTREE_MAX_DEPTH];
+	int top = 0;
+	KdStackEntry root = {0, 0, count, 0.0f};
+	stack[top++] = root;
+	while (top > 0)
+	{
+		KdStackEntry e = stack[--top];
+		if (e.bound * scale > limit)
+			continue;
+
+		// Down to a leaf along the near side, leaving the far sides
+		while (e.end - e.begin > m_leafSize)
+		{
+			const KdNode &node = m_nodes[e.node];
+			int mid = e.begin + (e.end - e.begin) / 2;
+			float diff = q[node.axis] - node.split;
+			KdStackEntry left = {2 * e.node + 1, e.begin, mid, e.bound};
+			KdStackEntry right = {2 * e.node + 2, mid, e.end, e.bound};
+			KdStackEntry &far = diff < 0.0f ? right : left;
+			far.bound = diff * diff > e.bound ? diff * diff : e.bound;
+			if (far.bound * scale <= limit)
+				stack[top++] = far;
+			e = diff < 0.0f ? left : right;
+		}
+
+		for (int i = e.begin; i < e.end; i++)
+		{
+			const CVector &p = m_points[i];
+			float dx = p.x - q[0], dy = p.y - q[1], dz = p.z - q[2];
+			float d2 = dx * dx + dy * dy + dz * dz;
+			if (d2 > limit || (found == k && d2 == limit))
+				continue;
+
+			// Insert into the sorted list, dropping the k-th if full
+			int j = found < k ? found++ : k - 1;
+			for (; j > 0 && distances2[j - 1] > d2; j--)
+			{
+				distances2[j] = distances2[j - 1];
+				indices[j] = indices[j - 1];
+			}
+			distances2[j] = d2;
+			indices[j] = m_order[i];
+			if (found == k)
+				limit = distances2[k - 1];
+		}
+	}
+	return found;
+}
+
+int KdTree::QueryNearest(int *indices, float *distances2, int k, const CVector &point, float maxDistance, float epsilon) const
+{
+	std::vector<float> scratch(distances2 == NULL && k > 0 ? k : 0);
+	float maxDistance2 = maxDistance < 1.8e19f ? maxDistance * maxDistance : FLT_MAX;
+	return Nearest(indices, distances2 != NULL ? distances2 : (scratch.empty() ? NULL : &scratch[0]), k, point, maxDistance2, epsilon);
+}
+
+void KdTree::QueryNearest(int *indices, float *distances2, int k, const CVector *points, int count, float maxDistance, float epsilon) const
+{
+	if (k <= 0)
+		return;
+
+	float maxDistance2 = maxDistance < 1.8e19f ? maxDistance * maxDistance : FLT_MAX;
+	int parts = (count + KDTREE_BATCH_SIZE - 1) / KDTREE_BATCH_SIZE;
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic) if(parts > 1)
+#endif
+	for (int p = 0; p < parts; p++)
+	{
+		std::vector<float> scratch(distances2 == NULL ? k : 0);
+		int begin = p * KDTREE_BATCH_SIZE;
+		int end = begin + KDTREE_BATCH_SIZE < count ? begin + KDTREE_BATCH_SIZE : count;
+		for (int i = begin; i < end; i++)
+		{
+			int *result = indices + (size_t)i * k;
+			float *result2 = distances2 != NULL ? distances2 + (size_t)i * k : &scratch[0];
+			int n = Nearest(result, result2, k, points[i], maxDistance2, epsilon);
+			for (int j = n; j < k; j++)
+			{
+				result[j] = -1;
+				result2[j] = -1.0f;
+			}
+		}
+	}
+}
+
+// Appends the points within radius
+void KdTree::Radius(std::vector<int> &indices, const CVector &center, float radius) const
+{
+	int count = int(m_points.size());
+	if (count == 0 || !(radius >= 0.0f))
+		return;
+
+	const float q[3] = {center.x, center.y, center.z};
+	float radius2 = radius * radius;
+
+	KdStackEntry stack[KDTREE_MAX_DEPTH];
+	int top = 0;
+	KdStackEntry root = {0, 0, count, 0.0f};
+	stack[top++] = root;
+	while (top > 0)
+	{
+		KdStackEntry e = stack[--top];
+		while (e.end - e.begin > m_leafSize)
+		{
+			const KdNode &node = m_nodes[e.node];
+			int mid = e.begin + (e.end - e.begin) / 2;
+			float diff = q[node.axis] - node.split;
+			KdStackEntry left = {2 * e.node + 1, e.begin, mid, 0.0f};
+			KdStackEntry right = {2 * e.node + 2, mid, e.end, 0.0f};
+			if (diff * diff <= radius2)
+				stack[top++] = diff < 0.0f ? right : left;
+			e = diff < 0.0f ? left : right;
+		}
+
+		for (int i = e.begin; i < e.end; i++)
+		{
+			const CVector &p = m_points[i];
+			float dx = p.x - q[0], dy = p.y - q[1], dz = p.z - q[2];
+			if (dx * dx + dy * dy + dz * dz <= radius2)
+				indices.push_back(m_order[i]);
+		}
+	}
+}
+
+int KdTree::QueryRadius(int *indices, int maxIndices, const CVector &center, float radius) const
+{
+	std::vector<int> found;
+	Radius(found, center, radius);
+
+	int count = int(found.size());
+	for (int i = 0; i < count && i < maxIndices; i++)
+		indices[i] = found[i];
+	return count;
+}
+
+void KdTree::QueryRadius(std::vector<int> &offsets, std::vector<int> &indices, const CVector *centers, int count, float radius) const
+{
+	offsets.assign(count + 1, 0);
+	int parts = (count + KDTREE_BATCH_SIZE - 1) / KDTREE_BATCH_SIZE;
+	std::vector<std::vector<int> > results(parts);
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic) if(parts > 1)
+#endif
+	for (int p = 0; p < parts; p++)
+	{
+		int begin = p * KDTREE_BATCH_SIZE;
+		int end = begin + KDTREE_BATCH_SIZE < count ? begin + KDTREE_BATCH_SIZE : count;
+		for (int i = begin; i < end; i++)
+		{
+			size_t before = results[p].size();
+			Radius(results[p], centers[i], radius);
+			offsets[i + 1] = int(results[p].size() - before);
+		}
+	}
+
+	for (int i = 0; i < count; i++)
+		offsets[i + 1] += offsets[i];
+	indices.resize(offsets[count]);
+	for (int p = 0; p < parts; p++)
+	{
+		if (!results[p].empty())
+			std::copy(results[p].begin(), results[p].end(), indices.begin() + offsets[p * KDTREE_BATCH_SIZE]);
+	}
+}
@@ -0,0 +1,75 @@
+#ifndef KDTREE_H
+#define KDTREE_H
+#include <float.h>
+#include <vector>
+#include "math3d.h"
+#include "Vector.h"
+
+//---------------------------------------------------------------------------
+// class KdTree
+//
+// k-d tree over a static point cloud for nearest neighbour and radius
+// queries. The points are copied into one array, permuted so that every
+// subtree is a contiguous range of it; each range is split at its median
+// along its widest axis. The tree is implicit in that layout: an inner node
+// is just the split axis and value, stored in heap order, and a leaf is a
+// range of at most leafSize points. Nothing is allocated per node.
+//
+// The top levels are split serially and the subtrees below them built in
+// parallel when the library is built with OpenMP. Queries are thread safe;
+// the batched ones run in parallel and reuse one traversal stack and result
+// buffer per part of the batch. Results are original point indices.
+
+#define KDTREE_MAX_DEPTH	64
+
+struct KdNode
+{
+	float split;
+	int axis;
+};
+
+class KdTree
+{
+public:
+	KdTree();
+
+	void Build(const CVector *points, int count, int leafSize = 8);
+	void Build(const float *x, const float *y, const float *z, int count, int leafSize = 8);
+
+	// Up to k points closest to point within maxDistance, nearest first, with
+	// their squared distances (which may be NULL). Returns how many were
+	// found. With epsilon > 0 the search is approximate: the i-th result is
+	// at most (1 + epsilon) times farther than the true i-th nearest, and
+	// far fewer nodes are visited.
+	int QueryNearest(int *indices, float *distances2, int k, const CVector &point,
+					 float maxDistance = FLT_MAX, float epsilon = 0.0f) const;
+
+	// One nearest query per point, k results each; missing ones are -1
+	void QueryNearest(int *indices, float *distances2, int k, const CVector *points, int count,
+					  float maxDistance = FLT_MAX, float epsilon = 0.0f) const;
+
+	// Points within radius of center. Writes up to maxIndices of them and
+	// returns how many there are in total, in no particular order.
+	int QueryRadius(int *indices, int maxIndices, const CVector &center, float radius) const;
+
+	// One radius query per center, results of query i at
+	// indices[offsets[i]] to indices[offsets[i + 1] - 1]
+	void QueryRadius(std::vector<int> &offsets, std::vector<int> &indices, const CVector *centers, int count, float radius) const;
+
+	int GetCount() const { return int(m_order.size()); }
+	// The points in tree order and the original index of each
+	const CVector *GetPoints() const { return m_points.empty() ? NULL : &m_points[0]; }
+	const int *GetOrder() const { return m_order.empty() ? NULL : &m_order[0]; }
+
+private:
+	void BuildStrided(const float *x, const float *y, const float *z, int stride, int count, int leafSize);
+	int Nearest(int *indices, float *distances2, int k, const CVector &point, float maxDistance2, float epsilon) const;
+	void Radius(std::vector<int> &indices, const CVector &center, float radius) const;
+
+	std::vector<KdNode> m_nodes;
+	std::vector<CVector> m_points;
+	std::vector<int> m_order;
+	int m_leafSize;
+};
+
+#endif // KDTREE_H
@@ -0,0 +1,490 @@
+#include <algorithm>
+#include <math.h>
+#include "LooseOctree.h"
+#include "math3dBatch.h"
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#define LOOSEOCTREE_YIELD()			SwitchToThread()
+#else
+#include <sched.h>
+#define LOOSEOCTREE_YIELD()			sched_yield()
+#endif
+
+// Queries per part of a batch, parts are shared out over threads
+#define LOOSEOCTREE_BATCH_SIZE		64
+// Reader retries that pause before it starts to yield the thread
+#define LOOSEOCTREE_SPIN_LIMIT		10
+// Nodes a query can have pending: up to seven siblings per level plus the
+// eight children of the node being expanded
+#define LOOSEOCTREE_STACK_SIZE		(8 * LOOSEOCTREE_MAX_DEPTH + 8)
+
+LooseOctree::LooseOctree(const CVector &center, float halfSize) : m_count(0), m_updating(0), m_sequence(0)
+{
+	m_root = NewNode(-1, 0);
+	LooseOctreeNode &root = m_nodes[m_root];
+	root.center[0] = center.x;
+	root.center[1] = center.y;
+	root.center[2] = center.z;
+	root.halfSize = halfSize;
+}
+
+int LooseOctree::NewNode(int parent, int octant)
+{
+	int i = m_nodes.Allocate();
+	if (i < 0)
+		return -1;
+
+	// A reader may still be on a node freed before, so the fields it reads
+	// are stored as atomics
+	LooseOctreeNode &node = m_nodes[i];
+	for (int k = 0; k < 8; k++)
+		LooseOctreeStore(node.child[k], -1);
+	node.parent = parent;
+	LooseOctreeStore(node.first, -1);
+	LooseOctreeStore(node.count, 0);
+	LooseOctreeStore(node.depth, 0);
+	if (parent >= 0)
+	{
+		const LooseOctreeNode &p = m_nodes[parent];
+		float half = 0.5f * p.halfSize;
+		LooseOctreeStore(node.halfSize, half);
+		for (int k = 0; k < 3; k++)
+			LooseOctreeStore(node.center[k], p.center[k] + ((octant >> k) & 1 ? half : -half));
+		LooseOctreeStore(node.depth, p.depth + 1);
+
+		// Complete before readers can reach it
+		LOOSEOCTREE_RELEASE();
+		LooseOctreeStore(m_nodes[parent].child[octant], i);
+	}
+	return i;
+}
+
+// The node for a sphere: as deep as the radius allows (at most the cell half
+// size, so the sphere stays inside the loose bounds), in the cell holding
+// the centre. Without create, or when the node pool runs out, stops at the
+// deepest existing node on the way, which holds the sphere as well.
+int LooseOctree::FindNode(const float center[3], float radius, bool create)
+{
+	int node = m_root;
+	for (;;)
+	{
+		const LooseOctreeNode &n = m_nodes[node];
+		float half = 0.5f * n.halfSize;
+		if (n.depth == LOOSEOCTREE_MAX_DEPTH || !(radius <= half))
+			return node;
+
+		int octant = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			float d = center[k] - n.center[k];
+			if (!(d >= -n.halfSize && d <= n.halfSize))
+				return node;
+			octant |= d >= 0.0f ? 1 << k : 0;
+		}
+
+		int child = n.child[octant];
+		if (child < 0)
+		{
+			if (!create || (child = NewNode(node, octant)) < 0)
+				return node;
+		}
+		node = child;
+	}
+}
+
+void LooseOctree::Link(int id, int node)
+{
+	LooseOctreeObject &o = m_objects[id];
+	LooseOctreeNode &n = m_nodes[node];
+	o.node = node;
+	o.prev = -1;
+	LooseOctreeStore(o.next, n.first);
+	if (n.first >= 0)
+		m_objects[n.first].prev = id;
+	LooseOctreeStore(n.first, id);
+
+	for (int i = node; i >= 0; i = m_nodes[i].parent)
+		LooseOctreeStore(m_nodes[i].count, m_nodes[i].count + 1);
+}
+
+// Unlink from the node list and free the nodes left empty
+void LooseOctree::Unlink(int id)
+{
+	LooseOctreeObject &o = m_objects[id];
+	int node = o.node;
+	if (o.prev >= 0)
+		LooseOctreeStore(m_objects[o.prev].next, o.next);
+	else
+		LooseOctreeStore(m_nodes[node].first, o.next);
+	if (o.next >= 0)
+		m_objects[o.next].prev = o.prev;
+
+	for (int i = node; i >= 0; i = m_nodes[i].parent)
+		LooseOctreeStore(m_nodes[i].count, m_nodes[i].count - 1);
+
+	while (node != m_root && m_nodes[node].count == 0)
+	{
+		int parent = m_nodes[node].parent;
+		for (int k = 0; k < 8; k++)
+			if (m_nodes[parent].child[k] == node)
+				LooseOctreeStore(m_nodes[parent].child[k], -1);
+		m_nodes.Free(node);
+		node = parent;
+	}
+}
+
+void LooseOctree::BeginUpdate()
+{
+	// Odd before any change is stored
+	if (m_updating++ == 0)
+	{
+		LooseOctreeStore(m_sequence, m_sequence + 1);
+		LOOSEOCTREE_RELEASE();
+	}
+}
+
+void LooseOctree::EndUpdate()
+{
+	// Even after every change is stored
+	if (--m_updating == 0)
+	{
+		LOOSEOCTREE_RELEASE();
+		LooseOctreeStore(m_sequence, m_sequence + 1);
+	}
+}
+
+static inline void SetSphere(LooseOctreeObject &o, const CVector &center, float radius)
+{
+	LooseOctreeStore(o.center[0], center.x);
+	LooseOctreeStore(o.center[1], center.y);
+	LooseOctreeStore(o.center[2], center.z);
+	LooseOctreeStore(o.radius, radius);
+}
+
+int LooseOctree::Insert(const CVector &center, float radius)
+{
+	BeginUpdate();
+	int id = m_objects.Allocate();
+	if (id >= 0)
+	{
+		SetSphere(m_objects[id], center, radius);
+		Link(id, FindNode(m_objects[id].center, radius, true));
+		m_count++;
+	}
+	EndUpdate();
+	return id;
+}
+
+void LooseOctree::Move(int id, const CVector &center, float radius)
+{
+	BeginUpdate();
+	LooseOctreeObject &o = m_objects[id];
+	SetSphere(o, center, radius);
+
+	// Still in the cell of its node, at the depth its radius asks for: done
+	const LooseOctreeNode &n = m_nodes[o.node];
+	bool stays = o.node != m_root && radius <= n.halfSize &&
+				 (n.depth == LOOSEOCTREE_MAX_DEPTH || !(radius <= 0.5f * n.halfSize));
+	for (int k = 0; k < 3 && stays; k++)
+		stays = o.center[k] - n.center[k] >= -n.halfSize && o.center[k] - n.center[k] <= n.halfSize;
+
+	if (!stays)
+	{
+		Unlink(id);
+		Link(id, FindNode(o.center, radius, true));
+	}
+	EndUpdate();
+}
+
+void LooseOctree::Move(const int *ids, const CVector *centers, const float *radii, int count)
+{
+	// A part at a time, so readers get in between. Inside BeginUpdate and
+	// EndUpdate the whole batch is still published at once.
+	for (int begin = 0; begin < count; begin += LOOSEOCTREE_PUBLISH_SIZE)
+	{
+		int end = begin + LOOSEOCTREE_PUBLISH_SIZE < count ? begin + LOOSEOCTREE_PUBLISH_SIZE : count;
+		BeginUpdate();
+		for (int i = begin; i < end; i++)
+			Move(ids[i], centers[i], radii[i]);
+		EndUpdate();
+	}
+}
+
+void LooseOctree::Remove(int id)
+{
+	BeginUpdate();
+	Unlink(id);
+	m_objects[id].node = -1;
+	m_objects.Free(id);
+	m_count--;
+	EndUpdate();
+}
+
+void LooseOctree::Clear()
+{
+	BeginUpdate();
+	LooseOctreeNode root = m_nodes[m_root];
+	m_nodes.Reset();
+	m_objects.Reset();
+	int node = NewNode(-1, 0);
+	for (int k = 0; k < 3; k++)
+		LooseOctreeStore(m_nodes[node].center[k], root.center[k]);
+	LooseOctreeStore(m_nodes[node].halfSize, root.halfSize);
+	LooseOctreeStore(m_root, node);
+	m_count = 0;
+	EndUpdate();
+}
+
+CVector LooseOctree::GetCenter(int id) const
+{
+	const LooseOctreeObject &o = m_objects[id];
+	return CVector(o.center[0], o.center[1], o.center[2]);
+}
+
+float LooseOctree::GetRadius(int id) const
+{
+	return m_objects[id].radius;
+}
+
+//---------------------------------------------------------------------------
+// Queries
+//
+// One pass over the tree as it is. Everything read may be changing under it,
+// so every field is read with LooseOctreeLoad and every walk is bounded;
+// false if a bound was hit, and the caller checks the sequence counter
+// anyway.
+
+// -1 if the box centre +- extent is entirely behind one of the planes, 1 if
+// entirely in front of all of them, else 0
+static inline int ClassifyBox(const float center[3], float extent, const M3DVector4f *planes)
+{
+	int inside = 1;
+	for (int p = 0; p < 6; p++)
+	{
+		const float *plane = planes[p];
+		float s = center[0] * plane[0] + center[1] * plane[1] + center[2] * plane[2] + plane[3];
+		float r = extent * (fabs(plane[0]) + fabs(plane[1]) + fabs(plane[2]));
+		if (s < -r)
+			return -1;
+		if (s < r)
+			inside = 0;
+	}
+	return inside;
+}
+
+static inline bool SphereInFrustum(const float center[3], float radius, const M3DVector4f *planes)
+{
+	for (int p = 0; p < 6; p++)
+	{
+		const float *plane = planes[p];
+		if (center[0] * plane[0] + center[1] * plane[1] + center[2] * plane[2] + plane[3] < -radius)
+			return false;
+	}
+	return true;
+}
+
+// sphere is (x, y, z, radius), or planes are six frustum planes
+bool LooseOctree::QueryAttempt(std::vector<int> &ids, const float *sphere, const M3DVector4f *planes) const
+{
+	int maxNodes = m_nodes.GetCapacity();
+	int maxSteps = m_objects.GetCapacity();
+	int root = LooseOctreeLoad(m_root);
+	int stack[LOOSEOCTREE_STACK_SIZE][2];	// node, 1 to take the whole subtree
+	int top = 0;
+	stack[top][0] = root;
+	stack[top][1] = 0;
+	top++;
+
+	while (top > 0)
+	{
+		top--;
+		int node = stack[top][0];
+		bool all = stack[top][1] != 0;
+		const LooseOctreeNode &n = m_nodes[node];
+		if (LooseOctreeLoad(n.count) <= 0 || LooseOctreeLoad(n.depth) > LOOSEOCTREE_MAX_DEPTH)
+			continue;
+
+		// The root also holds what lies outside of it and is never culled
+		if (node != root && !all)
+		{
+			float center[3] = {LooseOctreeLoad(n.center[0]), LooseOctreeLoad(n.center[1]), LooseOctreeLoad(n.center[2])};
+			float extent = 2.0f * LooseOctreeLoad(n.halfSize);
+			if (sphere != NULL)
+			{
+				float d2 = 0.0f;
+				for (int k = 0; k < 3; k++)
+				{
+					float d = fabs(sphere[k] - center[k]) - extent;
+					d2 += d > 0.0f ? d * d : 0.0f;
+				}
+				if (d2 > sphere[3] * sphere[3])
+					continue;
+			}
+			else
+			{
+				int side = ClassifyBox(center, extent, planes);
+				if (side < 0)
+					continue;
+				all = side > 0;
+			}
+		}
+
+		int steps = 0;
+		for (int id = LooseOctreeLoad(n.first); id >= 0; id = LooseOctreeLoad(m_objects[id].next))
+		{
+			if (id >= maxSteps || ++steps > maxSteps)
+				return false;
+
+			const LooseOctreeObject &o = m_objects[id];
+			bool hit = all;
+			if (!hit)
+			{
+				float center[3] = {LooseOctreeLoad(o.center[0]), LooseOctreeLoad(o.center[1]), LooseOctreeLoad(o.center[2])};
+				float radius = LooseOctreeLoad(o.radius);
+				if (sphere != NULL)
+				{
+					float dx = center[0] - sphere[0], dy = center[1] - sphere[1], dz = center[2] - sphere[2];
+					float r = radius + sphere[3];
+					hit = dx * dx + dy * dy + dz * dz <= r * r;
+				}
+				else
+					hit = SphereInFrustum(center, radius, planes);
+			}
+			if (hit)
+				ids.push_back(id);
+		}
+
+		if (top + 8 > LOOSEOCTREE_STACK_SIZE)
+			return false;
+		for (int k = 0; k < 8; k++)
+		{
+			int child = LooseOctreeLoad(n.child[k]);
+			if (child >= maxNodes)
+				return false;
+			if (child >= 0)
+			{
+				stack[top][0] = child;
+				stack[top][1] = all;
+				top++;
+			}
+		}
+	}
+	return true;
+}
+
+// Wait before a reader tries again: pause instructions, twice as many each
+// time, then give up the time slice to let the writer finish
+static void Backoff(int &spins)
+{
+	if (spins < LOOSEOCTREE_SPIN_LIMIT)
+	{
+#ifdef M3D_SSE2
+		for (int i = 0; i < 1 << spins; i++)
+			_mm_pause();
+#endif
+		spins++;
+	}
+	else
+		LOOSEOCTREE_YIELD();
+}
+
+// Seqlock read: retry until a pass ran with no update in between
+void LooseOctree::Query(std::vector<int> &ids, const float *sphere, const M3DVector4f *planes) const
+{
+	size_t base = ids.size();
+	int spins = 0;
+	for (;;)
+	{
+		unsigned int sequence = LooseOctreeLoad(m_sequence);
+		LOOSEOCTREE_ACQUIRE();
+		if (sequence & 1)
+		{
+			Backoff(spins);
+			continue;
+		}
+
+		ids.resize(base);
+		bool complete = QueryAttempt(ids, sphere, planes);
+		LOOSEOCTREE_ACQUIRE();
+		if (complete && sequence == LooseOctreeLoad(m_sequence))
+			return;
+		Backoff(spins);
+	}
+}
+
+void LooseOctree::QuerySphere(std::vector<int> &ids, const CVector &center, float radius) const
+{
+	float sphere[4] = {center.x, center.y, center.z, radius};
+	ids.clear();
+	Query(ids, sphere, NULL);
+}
+
+void LooseOctree::QueryFrustum(std::vector<int> &ids, const M3DVector4f planes[6]) const
+{
+	ids.clear();
+	Query(ids, NULL, planes);
+}
+
+void LooseOctree::QuerySpheres(std::vector<int> &offsets, std::vector<int> &ids, const CVector *centers, const float *radii, int count) const
+{
+	offsets.assign(count + 1, 0);
+	int parts = (count + LOOSEOCTREE_BATCH_SIZE - 1) / LOOSEOCTREE_BATCH_SIZE;
+	std::vector<std::vector<int> > results(parts);
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic) if(parts > 1)
+#endif
+	for (int p = 0; p < parts; p++)
+	{
+		int begin = p * LOOSEOCTREE_BATCH_SIZE;
+		int end = begin + LOOSEOCTREE_BATCH_SIZE < count ? begin + LOOSEOCTREE_BATCH_SIZE : count;
+		for (int i = begin; i < end; i++)
+		{
+			float sphere[4] = {centers[i].x, centers[i].y, centers[i].z, radii[i]};
+			size_t before = results[p].size();
+			Query(results[p], sphere, NULL);
+			offsets[i + 1] = int(results[p].size() - before);
+		}
+	}
+
+	for (int i = 0; i < count; i++)
+		offsets[i + 1] += offsets[i];
+	ids.resize(offsets[count]);
+	for (int p = 0; p < parts; p++)
+	{
+		if (!results[p].empty())
+			std::copy(results[p].begin(), results[p].end(), ids.begin() + offsets[p * LOOSEOCTREE_BATCH_SIZE]);
+	}
+}
+
+void LooseOctree::QueryFrustums(std::vector<int> &offsets, std::vector<int> &ids, const M3DVector4f (*planes)[6], int count) const
+{
+	offsets.assign(count + 1, 0);
+	int parts = (count + LOOSEOCTREE_BATCH_SIZE - 1) / LOOSEOCTREE_BATCH_SIZE;
+	std::vector<std::vector<int> > results(parts);
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic) if(parts > 1)
+#endif
+	for (int p = 0; p < parts; p++)
+	{
+		int begin = p * LOOSEOCTREE_BATCH_SIZE;
+		int end = begin + LOOSEOCTREE_BATCH_SIZE < count ? begin + LOOSEOCTREE_BATCH_SIZE : count;
+		for (int i = begin; i < end; i++)
+		{
+			size_t before = results[p].size();
+			Query(results[p], NULL, planes[i]);
+			offsets[i + 1] = int(results[p].size() - before);
+		}
+	}
+
+	for (int i = 0; i < count; i++)
+		offsets[i + 1] += offsets[i];
+	ids.resize(offsets[count]);
+	for (int p = 0; p < parts; p++)
+	{
+		if (!results[p].empty())
+			std::copy(results[p].begin(), results[p].end(), ids.begin() + offsets[p * LOOSEOCTREE_BATCH_SIZE]);
+	}
+}
@@ -0,0 +1,193 @@
+#ifndef LOOSEOCTREE_H
+#define LOOSEOCTREE_H
+#include <stddef.h>
+#include <vector>
+#include "math3d.h"
+#include "Vector.h"
+
+//---------------------------------------------------------------------------
+// class LooseOctree
+//
+// Octree over moving spheres (centre and radius), for objects that are
+// updated every frame. Nodes are loose: each one bounds twice its cell, so
+// an object is stored at the depth its radius allows, in the cell holding
+// its centre, and never straddles a boundary. Moving within the cell is a
+// field update; leaving it unlinks the object from one node list and links
+// it into another, creating and freeing nodes along the way. Both take a
+// bounded number of steps.
+//
+// Nodes and objects live in pools of fixed size chunks that are only
+// released by the destructor, so indices stay valid memory. That gives the
+// queries a lock-free read path: one thread may update the tree while any
+// number of others query it. Every update bumps a sequence counter, odd
+// while it is in progress; a query that overlaps an update sees the counter
+// change and runs again, spinning with a growing pause and then yielding
+// while the counter stays odd. Readers never block the writer, but a writer
+// that updates without pause can hold readers back. Group updates with
+// BeginUpdate/EndUpdate to publish them at once; the batched Move publishes
+// every LOOSEOCTREE_PUBLISH_SIZE moves, so a long batch lets readers in.
+//
+// Objects outside the root cube are kept in the root and always tested.
+
+#define LOOSEOCTREE_MAX_DEPTH		10
+#define LOOSEOCTREE_CHUNK_SHIFT		12
+#define LOOSEOCTREE_MAX_CHUNKS		4096
+#define LOOSEOCTREE_PUBLISH_SIZE	64
+
+// Fields that queries read while the writer may change them are loaded and
+// stored whole but unordered (relaxed atomics); the fences order them
+// against the sequence counter, release on the writer side and acquire on
+// the reader side. GCC and Clang have the __atomic builtins. With MSVC
+// volatile accesses are acquire and release (/volatile:ms, the default on
+// x86 and x64) and _ReadWriteBarrier stops the compiler from moving
+// accesses across the fences, which is all x86 needs.
+#if defined(_MSC_VER)
+#include <intrin.h>
+template<typename T> inline T LooseOctreeLoad(const T &x) { return *static_cast<const volatile T *>(&x); }
+template<typename T> inline void LooseOctreeStore(T &x, T value) { *static_cast<volatile T *>(&x) = value; }
+#define LOOSEOCTREE_ACQUIRE()		_ReadWriteBarrier()
+#define LOOSEOCTREE_RELEASE()		_ReadWriteBarrier()
+#else
+template<typename T> inline T LooseOctreeLoad(const T &x) { T value; __atomic_load(&x, &value, __ATOMIC_RELAXED); return value; }
+template<typename T> inline void LooseOctreeStore(T &x, T value) { __atomic_store(&x, &value, __ATOMIC_RELAXED); }
+#define LOOSEOCTREE_ACQUIRE()		__atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define LOOSEOCTREE_RELEASE()		__atomic_thread_fence(__ATOMIC_RELEASE)
+#endif
+
+// Chunked pool, entries addressed by index. Only the writer allocates.
+template<typename T>
+class LooseOctreePool
+{
+public:
+	LooseOctreePool() : m_capacity(0) {}
+	~LooseOctreePool()
+	{
+		for (int c = 0; c < (m_capacity >> LOOSEOCTREE_CHUNK_SHIFT); c++)
+			delete[] m_chunks[c];
+	}
+
+	T &operator[](int i) { return m_chunks[i >> LOOSEOCTREE_CHUNK_SHIFT][i & ((1 << LOOSEOCTREE_CHUNK_SHIFT) - 1)]; }
+	const T &operator[](int i) const
+	{
+		return LooseOctreeLoad(m_chunks[i >> LOOSEOCTREE_CHUNK_SHIFT])[i & ((1 << LOOSEOCTREE_CHUNK_SHIFT) - 1)];
+	}
+
+	// -1 when the pool is exhausted
+	int Allocate()
+	{
+		if (m_free.empty())
+		{
+			int c = m_capacity >> LOOSEOCTREE_CHUNK_SHIFT;
+			if (c == LOOSEOCTREE_MAX_CHUNKS)
+				return -1;
+			LooseOctreeStore(m_chunks[c], new T[1 << LOOSEOCTREE_CHUNK_SHIFT]);
+			for (int i = (1 << LOOSEOCTREE_CHUNK_SHIFT) - 1; i >= 0; i--)
+				m_free.push_back(m_capacity + i);
+			// Readers that see the capacity see the chunk
+			LOOSEOCTREE_RELEASE();
+			LooseOctreeStore(m_capacity, m_capacity + (1 << LOOSEOCTREE_CHUNK_SHIFT));
+		}
+		int i = m_free.back();
+		m_free.pop_back();
+		return i;
+	}
+	void Free(int i) { m_free.push_back(i); }
+
+	// Everything back on the free list, the chunks are kept
+	void Reset()
+	{
+		m_free.clear();
+		for (int i = m_capacity - 1; i >= 0; i--)
+			m_free.push_back(i);
+	}
+
+	// Safe from readers: everything below it is allocated
+	int GetCapacity() const
+	{
+		int capacity = LooseOctreeLoad(m_capacity);
+		LOOSEOCTREE_ACQUIRE();
+		return capacity;
+	}
+
+private:
+	LooseOctreePool(const LooseOctreePool &);
+	const LooseOctreePool &operator=(const LooseOctreePool &);
+
+	T *m_chunks[LOOSEOCTREE_MAX_CHUNKS];
+	int m_capacity;
+	std::vector<int> m_free;
+};
+
+struct LooseOctreeNode
+{
+	float center[3];
+	float halfSize;				// of the cell; the loose bounds are twice that
+	int child[8];				// -1 for none
+	int parent;
+	int first;					// first object stored in this node, -1 for none
+	int count;					// objects in the subtree
+	int depth;
+};
+
+struct LooseOctreeObject
+{
+	float center[3];
+	float radius;
+	int node;					// -1 for a free entry
+	int prev, next;				// in the list of the node
+};
+
+class LooseOctree
+{
+public:
+	// The root cell is the cube of half size halfSize around center
+	LooseOctree(const CVector &center, float halfSize);
+
+	// Writer side. Insert returns the id of the object, -1 if the pools are
+	// exhausted. Ids are reused after Remove.
+	int Insert(const CVector &center, float radius);
+	void Move(int id, const CVector &center, float radius);
+	void Move(const int *ids, const CVector *centers, const float *radii, int count);
+	void Remove(int id);
+	void Clear();
+
+	// Bracket several updates so readers see them all or none
+	void BeginUpdate();
+	void EndUpdate();
+
+	// Reader side, callable from any thread. ids gets the objects whose
+	// sphere touches the query sphere, or is not entirely outside any of the
+	// planes (m3dGetPlaneEquation form, normals pointing into the volume).
+	void QuerySphere(std::vector<int> &ids, const CVector &center, float radius) const;
+	void QueryFrustum(std::vector<int> &ids, const M3DVector4f planes[6]) const;
+
+	// Many queries, in parallel when built with OpenMP; results of query i
+	// at ids[offsets[i]] to ids[offsets[i + 1] - 1]
+	void QuerySpheres(std::vector<int> &offsets, std::vector<int> &ids, const CVector *centers, const float *radii, int count) const;
+	void QueryFrustums(std::vector<int> &offsets, std::vector<int> &ids, const M3DVector4f (*planes)[6], int count) const;
+
+	// Writer side only
+	CVector GetCenter(int id) const;
+	float GetRadius(int id) const;
+	int GetCount() const { return m_count; }
+
+private:
+	LooseOctree(const LooseOctree &);
+	const LooseOctree &operator=(const LooseOctree &);
+
+	int NewNode(int parent, int octant);
+	int FindNode(const float center[3], float radius, bool create);
+	void Link(int id, int node);
+	void Unlink(int id);
+	bool QueryAttempt(std::vector<int> &ids, const float *sphere, const M3DVector4f *planes) const;
+	void Query(std::vector<int> &ids, const float *sphere, const M3DVector4f *planes) const;
+
+	LooseOctreePool<LooseOctreeNode> m_nodes;
+	LooseOctreePool<LooseOctreeObject> m_objects;
+	int m_root;
+	int m_count;
+	int m_updating;
+	unsigned int m_sequence;
+};
+
+#endif // LOOSEOCTREE_H
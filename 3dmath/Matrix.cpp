@@ -1,6 +1,7 @@
 #include "Matrix.h"
 #include "Vector.h"
 #include "Quaternion.h"
+#include "math3dBatch.h"
 
 Matrix::Matrix()
 {
@@ -147,6 +148,7 @@ Matrix Matrix::GetTranspose() const
 const Matrix Matrix::RotationMatrix(const Quaternion &rot)
 {
 	Matrix result;
+	result.LoadIdentity();
 	float quat[4] = {rot.x, rot.y, rot.z, rot.w};
 	m3dQuaternionMatrix(quat, result.m_data);
 	return result;
@@ -178,10 +180,74 @@ const Matrix Matrix::TranslationMatrix(const CVector &vec)
 const Matrix Matrix::ScaleMatrix(const CVector &scalar)
 {
 	Matrix result;
+	result.LoadIdentity();
 	m3dScaleMatrix44(result.m_data, scalar.x, scalar.y, scalar.z);
 	return result;
 }
 
+// palette[i] = TranslationMatrix(t) * RotationMatrix(q) * ScaleMatrix(s),
+// built in one pass without the intermediate matrices
+void Matrix::ComposePalette(Matrix *palette, const M3DTransformSoA &trs, int count)
+{
+	m3dComposeMatrices44(reinterpret_cast<M3DMatrix44f *>(palette), trs, count);
+}
+
+// TranslationMatrix(translation) * RotationMatrix(rotation) * ScaleMatrix(scale)
+const Matrix Matrix::Compose(const CVector &translation, const Quaternion &rotation, const CVector &scale)
+{
+	Matrix result = RotationMatrix(rotation);
+	for (int i = 0; i < 3; i++)
+	{
+		result.m_data[i] *= scale.x;
+		result.m_data[4 + i] *= scale.y;
+		result.m_data[8 + i] *= scale.z;
+	}
+	result.m_data[12] = translation.x;
+	result.m_data[13] = translation.y;
+	result.m_data[14] = translation.z;
+	return result;
+}
+
+// Blend two affine transforms through their decomposition: translation and
+// scale are lerped, rotation slerped
+const Matrix Matrix::Interpolate(const Matrix &a, const Matrix &b, float t)
+{
+	CVector ta, tb, sa, sb;
+	Quaternion qa, qb;
+	a.Decompose(ta, qa, sa);
+	b.Decompose(tb, qb, sb);
+	return Compose(ta + (tb - ta) * t, Quaternion::Slerp(qa, qb, t), sa + (sb - sa) * t);
+}
+
+// Inverse of Compose, see m3dDecomposeMatrix44
+bool Matrix::Decompose(CVector &translation, Quaternion &rotation, CVector &scale) const
+{
+	float q[4];
+	bool result = m3dDecomposeMatrix44(&translation.x, q, &scale.x, m_data);
+	rotation = Quaternion(q[0], q[1], q[2], q[3]);
+	return result;
+}
+
+// this = TranslationMatrix(translation) * RotationMatrix(rotation) * stretch,
+// where stretch is symmetric and holds scale and shear
+bool Matrix::DecomposePolar(CVector &translation, Quaternion &rotation, Matrix &stretch) const
+{
+	M3DMatrix33f a, r, s;
+	m3dExtractRotation(a, m_data);
+	bool result = m3dPolarDecompose33(r, s, a);
+
+	M3DMatrix44f rot;
+	m3dInjectRotation(rot, r);
+	float q[4];
+	m3dMatToQuat(q, rot);
+	rotation = Quaternion(q[0], q[1], q[2], q[3]);
+
+	stretch.LoadIdentity();
+	m3dInjectRotation(stretch.m_data, s);
+	translation = CVector(m_data[12], m_data[13], m_data[14]);
+	return result;
+}
+
 CVector Matrix::ProjectPoint( const CVector &point, const Matrix &modelView, const Matrix &projection, const int viewport[4] )
 {
 	M3DVector3f pointIn = {point.x, point.y, point.z};
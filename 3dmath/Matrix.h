@@ -4,6 +4,7 @@
 class CVector;
 class Quaternion;
 struct Vector4f;
+struct M3DTransformSoA;
 class Matrix
 {
 public:
@@ -40,6 +41,12 @@ public:
 	static const Matrix RotationMatrix(const CVector &eula);
 	static const Matrix TranslationMatrix(const CVector &vec);
 	static const Matrix ScaleMatrix(const CVector &scalar);
+	static void ComposePalette(Matrix *palette, const M3DTransformSoA &trs, int count);
+	static const Matrix Compose(const CVector &translation, const Quaternion &rotation, const CVector &scale);
+	static const Matrix Interpolate(const Matrix &a, const Matrix &b, float t);
+
+	bool Decompose(CVector &translation, Quaternion &rotation, CVector &scale) const;
+	bool DecomposePolar(CVector &translation, Quaternion &rotation, Matrix &stretch) const;
 	static CVector ProjectPoint(const CVector &point, const Matrix &modelView, const Matrix &projection, const int viewport[4]);
 	static CVector UnprojectPoint(const CVector &point, const Matrix &modelView, const Matrix &projection, const int viewport[4]);
 public:
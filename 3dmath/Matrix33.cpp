@@ -0,0 +1,112 @@
+#include "Matrix33.h"
+#include "Matrix.h"
+#include "Vector.h"
+#include "math3dBatch.h"
+
+Matrix33::Matrix33()
+{
+
+}
+
+Matrix33::Matrix33(const Matrix33 &mat)
+{
+	*this = mat;
+}
+
+const Matrix33 &Matrix33::operator=(const Matrix33 &mat)
+{
+	m3dCopyMatrix33(m_data, mat.m_data);
+	return *this;
+}
+
+void Matrix33::LoadIdentity()
+{
+	m3dLoadIdentity33(m_data);
+}
+
+const Matrix33 Matrix33::operator*(const Matrix33 &mat) const
+{
+	Matrix33 result;
+	m3dMatrixMultiply33(result.m_data, this->m_data, mat.m_data);
+	return result;
+}
+
+const Matrix33& Matrix33::operator *= (const Matrix33 &mat)
+{
+	return *this = *this * mat;
+}
+
+const CVector Matrix33::operator*(const CVector &vec) const
+{
+	M3DVector3f in = {vec.x, vec.y, vec.z};
+	M3DVector3f out;
+	m3dRotateVector(out, in, m_data);
+	return CVector(out[0], out[1], out[2]);
+}
+
+float Matrix33::Determinant() const
+{
+	return m3dDeterminant33(m_data);
+}
+
+bool Matrix33::Invert()
+{
+	return m3dInvertMatrix33(m_data, m_data);
+}
+
+void Matrix33::Transpose()
+{
+	*this = GetTranspose();
+}
+
+Matrix33 Matrix33::GetInvert() const
+{
+	Matrix33 result = *this;
+	result.Invert();
+	return result;
+}
+
+Matrix33 Matrix33::GetTranspose() const
+{
+	Matrix33 result;
+	m3dTransposeMatrix33(result.m_data, m_data);
+	return result;
+}
+
+void Matrix33::DecomposeSVD(Matrix33 &u, CVector &sigma, Matrix33 &v) const
+{
+	M3DVector3f s;
+	m3dSVD33(u.m_data, s, v.m_data, m_data);
+	sigma = CVector(s[0], s[1], s[2]);
+}
+
+void Matrix33::DecomposePolar(Matrix33 &rotation, Matrix33 &stretch) const
+{
+	m3dPolarDecompose33(rotation.m_data, stretch.m_data, m_data);
+}
+
+const Matrix33 Matrix33::FromMatrix(const Matrix &mat)
+{
+	Matrix33 result;
+	m3dExtractRotation(result.m_data, mat.m_data);
+	return result;
+}
+
+const Matrix33 Matrix33::NormalMatrix(const Matrix &mat)
+{
+	Matrix33 result;
+	m3dNormalMatrices(&result.m_data, &mat.m_data, 1);
+	return result;
+}
+
+void Matrix33::NormalMatrix(Matrix33 *dst, const Matrix *src, int count)
+{
+	m3dNormalMatrices(reinterpret_cast<M3DMatrix33f *>(dst), reinterpret_cast<const M3DMatrix44f *>(src), count);
+}
+
+// stretch may be NULL
+void Matrix33::DecomposePolar(Matrix33 *rotation, Matrix33 *stretch, const Matrix33 *src, int count)
+{
+	m3dPolarDecomposeMatrices33(reinterpret_cast<M3DMatrix33f *>(rotation), reinterpret_cast<M3DMatrix33f *>(stretch),
+								reinterpret_cast<const M3DMatrix33f *>(src), count);
+}
@@ -0,0 +1,42 @@
+#ifndef MATRIX33_H
+#define MATRIX33_H
+#include "math3d.h"
+class CVector;
+class Matrix;
+class Matrix33
+{
+public:
+	Matrix33();
+	Matrix33(const Matrix33 &mat);
+	const Matrix33 &operator=(const Matrix33 &mat);
+
+	void LoadIdentity();
+
+	const Matrix33 operator*(const Matrix33 &mat) const;
+	const Matrix33& operator*=(const Matrix33 &mat);
+	const CVector operator*(const CVector &vec) const;
+
+	float Determinant() const;
+	bool Invert();
+	void Transpose();
+
+	Matrix33 GetInvert() const;
+	Matrix33 GetTranspose() const;
+
+	// this = u * diag(sigma) * v^T and this = rotation * stretch, see m3dSVD33
+	void DecomposeSVD(Matrix33 &u, CVector &sigma, Matrix33 &v) const;
+	void DecomposePolar(Matrix33 &rotation, Matrix33 &stretch) const;
+
+	// Upper 3x3 block of a 4x4
+	static const Matrix33 FromMatrix(const Matrix &mat);
+
+	// Inverse transpose of the upper 3x3 block, the matrix that takes normals
+	// through mat. A singular block gives non-finite entries.
+	static const Matrix33 NormalMatrix(const Matrix &mat);
+	static void NormalMatrix(Matrix33 *dst, const Matrix *src, int count);
+	static void DecomposePolar(Matrix33 *rotation, Matrix33 *stretch, const Matrix33 *src, int count);
+public:
+	M3DMatrix33f m_data;
+};
+
+#endif // MATRIX33_H
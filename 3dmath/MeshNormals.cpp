@@ -0,0 +1,197 @@
+#include <stddef.h>
+#include "MeshNormals.h"
+#include "math3dBatch.h"
+
+// Triangles or vertices per work item; the SoA scratch of a block fits in
+// the L1 cache
+#define MESHNORMALS_BLOCK_SIZE	256
+
+// Positions and normals through strided pointers, to serve both layouts
+struct MeshPositions
+{
+	const float *p[3];
+	int stride;
+};
+
+struct MeshNormals
+{
+	float *p[3];
+	int stride;
+};
+
+static inline int BlockEnd(int block, int count)
+{
+	int end = (block + 1) * MESHNORMALS_BLOCK_SIZE;
+	return end < count ? end : count;
+}
+
+// Normals of the triangles [begin, end) into faces, three floats each. With
+// angles set they are unit length and the angle at each corner goes to
+// angles, otherwise they are twice the area long.
+static void FaceNormals(float *faces, float *angles, const MeshPositions &positions, const unsigned int *indices, int begin, int end)
+{
+	float corner[9][MESHNORMALS_BLOCK_SIZE];
+	float normal[3][MESHNORMALS_BLOCK_SIZE];
+	float angle[3][MESHNORMALS_BLOCK_SIZE];
+	int count = end - begin;
+
+	for (int t = 0; t < count; t++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			size_t v = size_t(indices[3 * (begin + t) + c]) * positions.stride;
+			corner[3 * c][t] = positions.p[0][v];
+			corner[3 * c + 1][t] = positions.p[1][v];
+			corner[3 * c + 2][t] = positions.p[2][v];
+		}
+	}
+
+	M3DTriangleSoA triangles = {{corner[0], corner[1], corner[2]}, {corner[3], corner[4], corner[5]}, {corner[6], corner[7], corner[8]}};
+	m3dFindNormals(normal[0], normal[1], normal[2], triangles, count);
+	if (angles != NULL)
+	{
+		m3dNormalizeVectors(normal[0], normal[1], normal[2], count);
+		m3dTriangleAngles(angle[0], angle[1], angle[2], triangles, count);
+	}
+
+	for (int t = 0; t < count; t++)
+	{
+		float *face = faces + 3 * size_t(begin + t);
+		face[0] = normal[0][t];
+		face[1] = normal[1][t];
+		face[2] = normal[2][t];
+		if (angles != NULL)
+		{
+			float *a = angles + 3 * size_t(begin + t);
+			a[0] = angle[0][t];
+			a[1] = angle[1][t];
+			a[2] = angle[2][t];
+		}
+	}
+}
+
+// Sums of the face normals around the vertices [begin, end), in the order
+// of the adjacency, then normalized together
+static void VertexNormals(const MeshNormals &normals, const float *faces, const float *angles, const MeshAdjacency &adjacency, int begin, int end)
+{
+	float sum[3][MESHNORMALS_BLOCK_SIZE];
+	int count = end - begin;
+	const unsigned int *offsets = &adjacency.offsets[0];
+	const unsigned int *corners = adjacency.corners.empty() ? NULL : &adjacency.corners[0];
+
+	for (int j = 0; j < count; j++)
+	{
+		float x = 0.0f, y = 0.0f, z = 0.0f;
+		unsigned int first = offsets[begin + j], last = offsets[begin + j + 1];
+		if (angles != NULL)
+		{
+			for (unsigned int c = first; c < last; c++)
+			{
+				const float *face = faces + 3 * size_t(corners[c] / 3);
+				float w = angles[corners[c]];
+				x += face[0] * w;
+				y += face[1] * w;
+				z += face[2] * w;
+			}
+		}
+		else
+		{
+			for (unsigned int c = first; c < last; c++)
+			{
+				const float *face = faces + 3 * size_t(corners[c] / 3);
+				x += face[0];
+				y += face[1];
+				z += face[2];
+			}
+		}
+		sum[0][j] = x;
+		sum[1][j] = y;
+		sum[2][j] = z;
+	}
+
+	m3dNormalizeVectors(sum[0], sum[1], sum[2], count);
+	for (int j = 0; j < count; j++)
+	{
+		size_t v = size_t(begin + j) * normals.stride;
+		normals.p[0][v] = sum[0][j];
+		normals.p[1][v] = sum[1][j];
+		normals.p[2][v] = sum[2][j];
+	}
+}
+
+static void ComputeNormals(const MeshNormals &normals, const MeshPositions &positions, int vertexCount,
+						   const unsigned int *indices, int triangleCount, MeshNormalWeighting weighting,
+						   const MeshAdjacency *adjacency)
+{
+	if (vertexCount <= 0)
+		return;
+	triangleCount = triangleCount > 0 ? triangleCount : 0;
+
+	MeshAdjacency built;
+	if (adjacency == NULL)
+	{
+		BuildMeshAdjacency(built, indices, triangleCount, vertexCount);
+		adjacency = &built;
+	}
+
+	std::vector<float> faces(3 * size_t(triangleCount));
+	std::vector<float> angles(weighting == MESH_NORMALS_ANGLE ? 3 * size_t(triangleCount) : 0);
+	float *faceData = faces.empty() ? NULL : &faces[0];
+	float *angleData = angles.empty() ? NULL : &angles[0];
+
+	int blocks = (triangleCount + MESHNORMALS_BLOCK_SIZE - 1) / MESHNORMALS_BLOCK_SIZE;
+#ifdef _OPENMP
+	#pragma omp parallel for if(blocks > 1)
+#endif
+	for (int b = 0; b < blocks; b++)
+		FaceNormals(faceData, angleData, positions, indices, b * MESHNORMALS_BLOCK_SIZE, BlockEnd(b, triangleCount));
+
+	blocks = (vertexCount + MESHNORMALS_BLOCK_SIZE - 1) / MESHNORMALS_BLOCK_SIZE;
+#ifdef _OPENMP
+	#pragma omp parallel for if(blocks > 1)
+#endif
+	for (int b = 0; b < blocks; b++)
+		VertexNormals(normals, faceData, angleData, *adjacency, b * MESHNORMALS_BLOCK_SIZE, BlockEnd(b, vertexCount));
+}
+
+// Counting sort of the corners by vertex. offsets[v] first counts the
+// corners of v - 1, then serves as the write cursor of v - 1 and is shifted
+// back into place at the end.
+void BuildMeshAdjacency(MeshAdjacency &adjacency, const unsigned int *indices, int triangleCount, int vertexCount)
+{
+	int corners = triangleCount > 0 ? 3 * triangleCount : 0;
+	vertexCount = vertexCount > 0 ? vertexCount : 0;
+	adjacency.offsets.assign(vertexCount + 1, 0);
+	adjacency.corners.resize(corners);
+
+	for (int c = 0; c < corners; c++)
+		adjacency.offsets[indices[c] + 1]++;
+	for (int v = 0; v < vertexCount; v++)
+		adjacency.offsets[v + 1] += adjacency.offsets[v];
+	for (int c = 0; c < corners; c++)
+		adjacency.corners[adjacency.offsets[indices[c]]++] = c;
+	for (int v = vertexCount; v > 0; v--)
+		adjacency.offsets[v] = adjacency.offsets[v - 1];
+	adjacency.offsets[0] = 0;
+}
+
+void ComputeVertexNormals(CVector *normals, const CVector *positions, int vertexCount,
+						  const unsigned int *indices, int triangleCount, MeshNormalWeighting weighting,
+						  const MeshAdjacency *adjacency)
+{
+	if (vertexCount <= 0)
+		return;
+	int stride = sizeof(CVector) / sizeof(float);
+	MeshNormals out = {{&normals[0].x, &normals[0].y, &normals[0].z}, stride};
+	MeshPositions in = {{&positions[0].x, &positions[0].y, &positions[0].z}, stride};
+	ComputeNormals(out, in, vertexCount, indices, triangleCount, weighting, adjacency);
+}
+
+void ComputeVertexNormals(float *normals[3], const float *positions[3], int vertexCount,
+						  const unsigned int *indices, int triangleCount, MeshNormalWeighting weighting,
+						  const MeshAdjacency *adjacency)
+{
+	MeshNormals out = {{normals[0], normals[1], normals[2]}, 1};
+	MeshPositions in = {{positions[0], positions[1], positions[2]}, 1};
+	ComputeNormals(out, in, vertexCount, indices, triangleCount, weighting, adjacency);
+}
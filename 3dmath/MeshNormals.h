@@ -0,0 +1,49 @@
+#ifndef MESHNORMALS_H
+#define MESHNORMALS_H
+#include <vector>
+#include "Vector.h"
+
+//---------------------------------------------------------------------------
+// Vertex normals of indexed triangle meshes
+//
+// Triangles are three vertex indices each, counterclockwise seen from the
+// side the normals point to. A vertex normal is the normalized sum of the
+// normals of the triangles using the vertex, weighted by the area of each
+// triangle or by its angle at the vertex. Area weighting is cheaper; angle
+// weighting does not depend on how a flat region is triangulated.
+//
+// Face normals are computed a block of triangles at a time by the SIMD
+// kernels of math3dBatch.h. The sums are gathered per vertex through a
+// vertex to corner adjacency rather than scattered per triangle, so vertex
+// ranges are summed in parallel when built with OpenMP, without atomics and
+// in the same order whatever the thread count. The adjacency only depends
+// on the indices: build it once to recompute the normals of a deforming
+// mesh every frame.
+
+enum MeshNormalWeighting
+{
+	MESH_NORMALS_AREA,
+	MESH_NORMALS_ANGLE
+};
+
+// The corners (3 * triangle + k) using vertex v are corners[offsets[v]] to
+// corners[offsets[v + 1] - 1], in triangle order
+struct MeshAdjacency
+{
+	std::vector<unsigned int> offsets;
+	std::vector<unsigned int> corners;
+};
+
+void BuildMeshAdjacency(MeshAdjacency &adjacency, const unsigned int *indices, int triangleCount, int vertexCount);
+
+// Unit normals, zero for vertices that no triangle with an area uses.
+// adjacency may be NULL, it is then built on the fly. Positions and normals
+// as CVectors or as three float streams, like ApplyBlendShapes.
+void ComputeVertexNormals(CVector *normals, const CVector *positions, int vertexCount,
+						  const unsigned int *indices, int triangleCount, MeshNormalWeighting weighting,
+						  const MeshAdjacency *adjacency = NULL);
+void ComputeVertexNormals(float *normals[3], const float *positions[3], int vertexCount,
+						  const unsigned int *indices, int triangleCount, MeshNormalWeighting weighting,
+						  const MeshAdjacency *adjacency = NULL);
+
+#endif // MESHNORMALS_H
@@ -39,6 +39,7 @@
 // Setup the quaternion to rotate about the specified axis
 
 #include "Quaternion.h"
+#include "math3dBatch.h"
 void	Quaternion::SetToRotateAboutX(float theta) {
 
 	// Compute the half angle
@@ -541,3 +542,14 @@ void Quaternion::FromMatrix( const Matrix &mat )
 	z = quat[2];
 	w = quat[3];
 }
+
+void Quaternion::FromMatrices( Quaternion *quats, const Matrix *mats, int count )
+{
+	m3dMatToQuats(reinterpret_cast<float (*)[4]>(quats), reinterpret_cast<const M3DMatrix44f *>(mats), count);
+}
+
+void Quaternion::RotateVectors( CVector *out, const CVector *in, int count ) const
+{
+	float quat[4] = {x, y, z, w};
+	m3dRotateVectors(reinterpret_cast<M3DVector3f *>(out), reinterpret_cast<const M3DVector3f *>(in), quat, count);
+}
\ No newline at end of file
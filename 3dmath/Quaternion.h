@@ -96,15 +96,23 @@ public:
 	float GetRotationAngle() const;
 	CVector	GetRotationAxis() const;
 
-	//rotate a vector
-	inline CVector RotateVector(CVector &vec)
+	//rotate a vector, v + w * t + q x t with t = 2 * (q x v)
+	inline CVector RotateVector(const CVector &vec) const
 	{
-		CVector *pV = (CVector*)this;
-		return vec + 2.0 * pV->CrossProduct(pV->CrossProduct(vec) + vec * w);
+		float tx = 2.0f * (y * vec.z - z * vec.y);
+		float ty = 2.0f * (z * vec.x - x * vec.z);
+		float tz = 2.0f * (x * vec.y - y * vec.x);
+		return CVector(vec.x + w * tx + (y * tz - z * ty),
+					   vec.y + w * ty + (z * tx - x * tz),
+					   vec.z + w * tz + (x * ty - y * tx));
 	}
+	//rotate an array of vectors, in and out may be the same array
+	void RotateVectors(CVector *out, const CVector *in, int count) const;
 	//convert from a euler angle
 	void FromEuler(const CVector &euler);
 	void FromMatrix(const Matrix &mat);
+	// convert an array of matrices, see m3dMatToQuats
+	static void FromMatrices(Quaternion *quats, const Matrix *mats, int count);
 
 	inline float DotProduct(const Quaternion &quat) const
 	{
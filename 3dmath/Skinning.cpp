@@ -0,0 +1,551 @@
+#include <assert.h>
+#include <stddef.h>
+#include "Skinning.h"
+#include "math3dBatch.h"
+
+// Vertices per work item when skinning in parallel. A multiple of the SIMD
+// width so only the last block has a scalar tail.
+#define SKIN_BLOCK_SIZE	1024
+
+// Vertices skinned at a time into the local buffer before they are copied to
+// a SkinVertexBuffer. 128 vertices are 3k, which stays in L1.
+#define SKIN_STAGE_SIZE	128
+
+// Skins vertices [begin, end) of in into the same entries of out
+typedef void (*SkinRangeFunc)(const SkinOutputStreams &out, const SkinInputStreams &in, const float *palette, int begin, int end);
+
+// Input streams advanced to vertex first
+static SkinInputStreams OffsetStreams(const SkinInputStreams &in, int first)
+{
+	SkinInputStreams result = in;
+	for (int k = 0; k < 3; k++)
+	{
+		result.position[k] += first;
+		if (result.normal[k] != NULL)
+			result.normal[k] += first;
+	}
+	for (int k = 0; k < in.influences; k++)
+	{
+		result.bone[k] += first;
+		if (result.weight[k] != NULL)
+			result.weight[k] += first;
+	}
+	result.count -= first;
+	return result;
+}
+
+static void SkinToBuffer(SkinRangeFunc func, const SkinVertexBuffer &out, const SkinInputStreams &in, const float *palette, int begin, int end)
+{
+	float stage[6][SKIN_STAGE_SIZE];
+	bool normals = in.normal[0] != NULL && out.normalOffset >= 0;
+	SkinOutputStreams staged =
+	{
+		{ stage[0], stage[1], stage[2] },
+		{ normals ? stage[3] : NULL, stage[4], stage[5] }
+	};
+
+	for (int i = begin; i < end; i += SKIN_STAGE_SIZE)
+	{
+		int n = end - i < SKIN_STAGE_SIZE ? end - i : SKIN_STAGE_SIZE;
+		func(staged, OffsetStreams(in, i), palette, 0, n);
+
+		// Write whole vertices in order so write-combining can merge them
+		char *dst = (char *)out.data + (size_t)i * out.stride;
+		for (int j = 0; j < n; j++, dst += out.stride)
+		{
+			float *p = (float *)(dst + out.positionOffset);
+			p[0] = stage[0][j];
+			p[1] = stage[1][j];
+			p[2] = stage[2][j];
+			if (normals)
+			{
+				float *nrm = (float *)(dst + out.normalOffset);
+				nrm[0] = stage[3][j];
+				nrm[1] = stage[4][j];
+				nrm[2] = stage[5][j];
+			}
+		}
+	}
+}
+
+// Split the vertices into blocks and skin them, in parallel with OpenMP.
+// Exactly one of streams and buffer is set.
+static void SkinBlocks(SkinRangeFunc func, const SkinOutputStreams *streams, const SkinVertexBuffer *buffer, const SkinInputStreams &in, const float *palette)
+{
+	assert(in.influences >= 1 && in.influences <= SKIN_MAX_INFLUENCES);
+	int blocks = (in.count + SKIN_BLOCK_SIZE - 1) / SKIN_BLOCK_SIZE;
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if(blocks > 1)
+#endif
+	for (int b = 0; b < blocks; b++)
+	{
+		int begin = b * SKIN_BLOCK_SIZE;
+		int end = begin + SKIN_BLOCK_SIZE < in.count ? begin + SKIN_BLOCK_SIZE : in.count;
+		if (streams != NULL)
+			func(*streams, in, palette, begin, end);
+		else
+			SkinToBuffer(func, *buffer, in, palette, begin, end);
+	}
+}
+
+#ifdef M3D_AVX
+static inline void Transpose8x8(__m256 r[8])
+{
+	__m256 t0 = _mm256_unpacklo_ps(r[0], r[1]), t1 = _mm256_unpackhi_ps(r[0], r[1]);
+	__m256 t2 = _mm256_unpacklo_ps(r[2], r[3]), t3 = _mm256_unpackhi_ps(r[2], r[3]);
+	__m256 t4 = _mm256_unpacklo_ps(r[4], r[5]), t5 = _mm256_unpackhi_ps(r[4], r[5]);
+	__m256 t6 = _mm256_unpacklo_ps(r[6], r[7]), t7 = _mm256_unpackhi_ps(r[6], r[7]);
+	__m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)), s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+	__m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)), s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+	__m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0)), s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+	__m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0)), s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+	r[0] = _mm256_permute2f128_ps(s0, s4, 0x20);	r[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+	r[1] = _mm256_permute2f128_ps(s1, s5, 0x20);	r[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+	r[2] = _mm256_permute2f128_ps(s2, s6, 0x20);	r[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+	r[3] = _mm256_permute2f128_ps(s3, s7, 0x20);	r[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+}
+
+#endif
+
+
+//---------------------------------------------------------------------------
+// Linear blend skinning
+//
+// The palette is read as the 16 floats of each Matrix. The weighted sum of
+// the bone matrices is formed first (12 multiply-adds per influence) and
+// applied once, instead of transforming the vertex by every bone.
+
+template <int N>
+static inline void BlendMatrix(float b[16], const SkinInputStreams &in, const float *palette, int i)
+{
+	const float *m0 = palette + 16 * in.bone[0][i];
+	if (N == 1)
+	{
+		for (int j = 0; j < 16; j++)
+			b[j] = m0[j];
+		return;
+	}
+
+	float w0 = in.weight[0][i];
+	for (int j = 0; j < 16; j++)
+		b[j] = m0[j] * w0;
+	for (int k = 1; k < N; k++)
+	{
+		const float *m = palette + 16 * in.bone[k][i];
+		float w = in.weight[k][i];
+		for (int j = 0; j < 16; j++)
+			b[j] += m[j] * w;
+	}
+}
+
+template <int N>
+static inline void SkinLinearBlendVertex(const SkinOutputStreams &out, const SkinInputStreams &in, const float *palette, bool normals, int i)
+{
+	float b[16];
+	BlendMatrix<N>(b, in, palette, i);
+
+	float x = in.position[0][i], y = in.position[1][i], z = in.position[2][i];
+	out.position[0][i] = b[0] * x + b[4] * y + b[8] * z + b[12];
+	out.position[1][i] = b[1] * x + b[5] * y + b[9] * z + b[13];
+	out.position[2][i] = b[2] * x + b[6] * y + b[10] * z + b[14];
+
+	if (normals)
+	{
+		x = in.normal[0][i]; y = in.normal[1][i]; z = in.normal[2][i];
+		out.normal[0][i] = b[0] * x + b[4] * y + b[8] * z;
+		out.normal[1][i] = b[1] * x + b[5] * y + b[9] * z;
+		out.normal[2][i] = b[2] * x + b[6] * y + b[10] * z;
+	}
+}
+
+#ifdef M3D_SSE2
+// Gather the matrices of four vertices, m[j] holds entry j of each. The
+// bottom row (entries 3, 7, 11 and 15) comes along but is not used.
+static inline void LoadMatrices4(__m128 m[16], const float *palette, const unsigned short *bone)
+{
+	const float *a = palette + 16 * bone[0], *b = palette + 16 * bone[1];
+	const float *c = palette + 16 * bone[2], *d = palette + 16 * bone[3];
+	for (int j = 0; j < 16; j += 4)
+	{
+		m[j] = _mm_loadu_ps(a + j);
+		m[j + 1] = _mm_loadu_ps(b + j);
+		m[j + 2] = _mm_loadu_ps(c + j);
+		m[j + 3] = _mm_loadu_ps(d + j);
+		_MM_TRANSPOSE4_PS(m[j], m[j + 1], m[j + 2], m[j + 3]);
+	}
+}
+
+template <int N>
+static int SkinLinearBlendSSE(const SkinOutputStreams &out, const SkinInputStreams &in, const float *palette, bool normals, int begin, int end)
+{
+	int i = begin;
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 b[16];
+		LoadMatrices4(b, palette, in.bone[0] + i);
+		if (N > 1)
+		{
+			__m128 w = _mm_loadu_ps(in.weight[0] + i);
+			for (int j = 0; j < 15; j++)
+				b[j] = _mm_mul_ps(b[j], w);
+			for (int k = 1; k < N; k++)
+			{
+				__m128 m[16];
+				LoadMatrices4(m, palette, in.bone[k] + i);
+				w = _mm_loadu_ps(in.weight[k] + i);
+				for (int j = 0; j < 15; j++)
+					b[j] = _mm_add_ps(b[j], _mm_mul_ps(m[j], w));
+			}
+		}
+
+		__m128 x = _mm_loadu_ps(in.position[0] + i), y = _mm_loadu_ps(in.position[1] + i), z = _mm_loadu_ps(in.position[2] + i);
+		_mm_storeu_ps(out.position[0] + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(b[0], x), _mm_mul_ps(b[4], y)), _mm_add_ps(_mm_mul_ps(b[8], z), b[12])));
+		_mm_storeu_ps(out.position[1] + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(b[1], x), _mm_mul_ps(b[5], y)), _mm_add_ps(_mm_mul_ps(b[9], z), b[13])));
+		_mm_storeu_ps(out.position[2] + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(b[2], x), _mm_mul_ps(b[6], y)), _mm_add_ps(_mm_mul_ps(b[10], z), b[14])));
+
+		if (normals)
+		{
+			x = _mm_loadu_ps(in.normal[0] + i); y = _mm_loadu_ps(in.normal[1] + i); z = _mm_loadu_ps(in.normal[2] + i);
+			_mm_storeu_ps(out.normal[0] + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(b[0], x), _mm_mul_ps(b[4], y)), _mm_mul_ps(b[8], z)));
+			_mm_storeu_ps(out.normal[1] + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(b[1], x), _mm_mul_ps(b[5], y)), _mm_mul_ps(b[9], z)));
+			_mm_storeu_ps(out.normal[2] + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(b[2], x), _mm_mul_ps(b[6], y)), _mm_mul_ps(b[10], z)));
+		}
+	}
+	return i;
+}
+#endif
+
+#ifdef M3D_AVX
+// Gather the matrices of eight vertices, m[j] holds entry j of each. Each
+// matrix is two 256 bit loads.
+static inline void LoadMatrices8(__m256 m[16], const float *palette, const unsigned short *bone)
+{
+	for (int j = 0; j < 8; j++)
+	{
+		const float *src = palette + 16 * bone[j];
+		m[j] = _mm256_loadu_ps(src);
+		m[j + 8] = _mm256_loadu_ps(src + 8);
+	}
+	Transpose8x8(m);
+	Transpose8x8(m + 8);
+}
+
+template <int N>
+static int SkinLinearBlendAVX(const SkinOutputStreams &out, const SkinInputStreams &in, const float *palette, bool normals, int begin, int end)
+{
+	int i = begin;
+	for (; i + 8 <= end; i += 8)
+	{
+		__m256 b[16];
+		LoadMatrices8(b, palette, in.bone[0] + i);
+		if (N > 1)
+		{
+			__m256 w = _mm256_loadu_ps(in.weight[0] + i);
+			for (int j = 0; j < 15; j++)
+				b[j] = _mm256_mul_ps(b[j], w);
+			for (int k = 1; k < N; k++)
+			{
+				__m256 m[16];
+				LoadMatrices8(m, palette, in.bone[k] + i);
+				w = _mm256_loadu_ps(in.weight[k] + i);
+				for (int j = 0; j < 15; j++)
+					b[j] = _mm256_add_ps(b[j], _mm256_mul_ps(m[j], w));
+			}
+		}
+
+		__m256 x = _mm256_loadu_ps(in.position[0] + i), y = _mm256_loadu_ps(in.position[1] + i), z = _mm256_loadu_ps(in.position[2] + i);
+		_mm256_storeu_ps(out.position[0] + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(b[0], x), _mm256_mul_ps(b[4], y)), _mm256_add_ps(_mm256_mul_ps(b[8], z), b[12])));
+		_mm256_storeu_ps(out.position[1] + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(b[1], x), _mm256_mul_ps(b[5], y)), _mm256_add_ps(_mm256_mul_ps(b[9], z), b[13])));
+		_mm256_storeu_ps(out.position[2] + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(b[2], x), _mm256_mul_ps(b[6], y)), _mm256_add_ps(_mm256_mul_ps(b[10], z), b[14])));
+
+		if (normals)
+		{
+			x = _mm256_loadu_ps(in.normal[0] + i); y = _mm256_loadu_ps(in.normal[1] + i); z = _mm256_loadu_ps(in.normal[2] + i);
+			_mm256_storeu_ps(out.normal[0] + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(b[0], x), _mm256_mul_ps(b[4], y)), _mm256_mul_ps(b[8], z)));
+			_mm256_storeu_ps(out.normal[1] + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(b[1], x), _mm256_mul_ps(b[5], y)), _mm256_mul_ps(b[9], z)));
+			_mm256_storeu_ps(out.normal[2] + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(b[2], x), _mm256_mul_ps(b[6], y)), _mm256_mul_ps(b[10], z)));
+		}
+	}
+	return i;
+}
+#endif
+
+template <int N>
+static void SkinLinearBlendRange(const SkinOutputStreams &out, const SkinInputStreams &in, const float *palette, int begin, int end)
+{
+	bool normals = in.normal[0] != NULL && out.normal[0] != NULL;
+	int i = begin;
+
+#if defined(M3D_AVX)
+	i = SkinLinearBlendAVX<N>(out, in, palette, normals, i, end);
+#elif defined(M3D_SSE2)
+	i = SkinLinearBlendSSE<N>(out, in, palette, normals, i, end);
+#endif
+
+	for (; i < end; i++)
+		SkinLinearBlendVertex<N>(out, in, palette, normals, i);
+}
+
+static const SkinRangeFunc linearBlendFuncs[SKIN_MAX_INFLUENCES] =
+{
+	SkinLinearBlendRange<1>, SkinLinearBlendRange<2>, SkinLinearBlendRange<3>, SkinLinearBlendRange<4>
+};
+
+void SkinLinearBlend(const SkinOutputStreams &out, const SkinInputStreams &in, const Matrix *palette)
+{
+	SkinBlocks(linearBlendFuncs[in.influences - 1], &out, NULL, in, reinterpret_cast<const float *>(palette));
+}
+
+void SkinLinearBlend(const SkinVertexBuffer &out, const SkinInputStreams &in, const Matrix *palette)
+{
+	SkinBlocks(linearBlendFuncs[in.influences - 1], NULL, &out, in, reinterpret_cast<const float *>(palette));
+}
+
+
+//---------------------------------------------------------------------------
+// Dual quaternion skinning
+//
+// The palette is read as eight floats per bone, real (x, y, z, w) followed by
+// dual (x, y, z, w). The blend b = sum(w_k * dq_k) is not normalized; instead
+// the rotation and translation are divided by |b.real|^2:
+//
+//	p' = p + 2 * r x (r x p + r.w * p) / |r|^2 + t
+//	t  = 2 * (r.w * d - d.w * r + r x d) / |r|^2
+//
+// which is what DualQuaternion::Blend followed by TransformPoint computes.
+
+template <int N>
+static inline void BlendDualQuaternion(float b[8], const SkinInputStreams &in, const float *palette, int i)
+{
+	const float *dq0 = palette + 8 * in.bone[0][i];
+	float w0 = N > 1 ? in.weight[0][i] : 1.0f;
+	for (int j = 0; j < 8; j++)
+		b[j] = dq0[j] * w0;
+
+	for (int k = 1; k < N; k++)
+	{
+		const float *dq = palette + 8 * in.bone[k][i];
+		float w = in.weight[k][i];
+		if (dq[0] * dq0[0] + dq[1] * dq0[1] + dq[2] * dq0[2] + dq[3] * dq0[3] < 0.0f)
+			w = -w;
+		for (int j = 0; j < 8; j++)
+			b[j] += dq[j] * w;
+	}
+}
+
+static inline void RotateScaled(float *ox, float *oy, float *oz, float x, float y, float z, const float b[8], float scale)
+{
+	float cx = b[1] * z - b[2] * y + b[3] * x;
+	float cy = b[2] * x - b[0] * z + b[3] * y;
+	float cz = b[0] * y - b[1] * x + b[3] * z;
+	*ox = x + (b[1] * cz - b[2] * cy) * scale;
+	*oy = y + (b[2] * cx - b[0] * cz) * scale;
+	*oz = z + (b[0] * cy - b[1] * cx) * scale;
+}
+
+template <int N>
+static inline void SkinDualQuaternionVertex(const SkinOutputStreams &out, const SkinInputStreams &in, const float *palette, bool normals, int i)
+{
+	float b[8];
+	BlendDualQuaternion<N>(b, in, palette, i);
+
+	float scale = 2.0f / (b[0] * b[0] + b[1] * b[1] + b[2] * b[2] + b[3] * b[3]);
+	float tx = (b[3] * b[4] - b[7] * b[0] + b[1] * b[6] - b[2] * b[5]) * scale;
+	float ty = (b[3] * b[5] - b[7] * b[1] + b[2] * b[4] - b[0] * b[6]) * scale;
+	float tz = (b[3] * b[6] - b[7] * b[2] + b[0] * b[5] - b[1] * b[4]) * scale;
+
+	float x, y, z;
+	RotateScaled(&x, &y, &z, in.position[0][i], in.position[1][i], in.position[2][i], b, scale);
+	out.position[0][i] = x + tx;
+	out.position[1][i] = y + ty;
+	out.position[2][i] = z + tz;
+
+	if (normals)
+		RotateScaled(&out.normal[0][i], &out.normal[1][i], &out.normal[2][i], in.normal[0][i], in.normal[1][i], in.normal[2][i], b, scale);
+}
+
+#ifdef M3D_SSE2
+// Gather the dual quaternions of four vertices, one component per register
+static inline void LoadDualQuaternions4(__m128 q[8], const float *palette, const unsigned short *bone)
+{
+	const float *a = palette + 8 * bone[0], *b = palette + 8 * bone[1];
+	const float *c = palette + 8 * bone[2], *d = palette + 8 * bone[3];
+	q[0] = _mm_loadu_ps(a);		q[4] = _mm_loadu_ps(a + 4);
+	q[1] = _mm_loadu_ps(b);		q[5] = _mm_loadu_ps(b + 4);
+	q[2] = _mm_loadu_ps(c);		q[6] = _mm_loadu_ps(c + 4);
+	q[3] = _mm_loadu_ps(d);		q[7] = _mm_loadu_ps(d + 4);
+	_MM_TRANSPOSE4_PS(q[0], q[1], q[2], q[3]);
+	_MM_TRANSPOSE4_PS(q[4], q[5], q[6], q[7]);
+}
+
+static inline void RotateScaled4(__m128 &ox, __m128 &oy, __m128 &oz, __m128 x, __m128 y, __m128 z, const __m128 b[8], __m128 scale)
+{
+	__m128 cx = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b[1], z), _mm_mul_ps(b[2], y)), _mm_mul_ps(b[3], x));
+	__m128 cy = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b[2], x), _mm_mul_ps(b[0], z)), _mm_mul_ps(b[3], y));
+	__m128 cz = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b[0], y), _mm_mul_ps(b[1], x)), _mm_mul_ps(b[3], z));
+	ox = _mm_add_ps(x, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(b[1], cz), _mm_mul_ps(b[2], cy)), scale));
+	oy = _mm_add_ps(y, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(b[2], cx), _mm_mul_ps(b[0], cz)), scale));
+	oz = _mm_add_ps(z, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(b[0], cy), _mm_mul_ps(b[1], cx)), scale));
+}
+
+template <int N>
+static int SkinDualQuaternionSSE(const SkinOutputStreams &out, const SkinInputStreams &in, const float *palette, bool normals, int begin, int end)
+{
+	const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+	int i = begin;
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 q0[8], b[8];
+		LoadDualQuaternions4(q0, palette, in.bone[0] + i);
+		for (int j = 0; j < 8; j++)
+			b[j] = q0[j];
+		if (N > 1)
+		{
+			__m128 w = _mm_loadu_ps(in.weight[0] + i);
+			for (int j = 0; j < 8; j++)
+				b[j] = _mm_mul_ps(q0[j], w);
+		}
+
+		for (int k = 1; k < N; k++)
+		{
+			__m128 q[8];
+			LoadDualQuaternions4(q, palette, in.bone[k] + i);
+			__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(q[0], q0[0]), _mm_mul_ps(q[1], q0[1])),
+									_mm_add_ps(_mm_mul_ps(q[2], q0[2]), _mm_mul_ps(q[3], q0[3])));
+			// Flip the weight of bones in the other hemisphere
+			__m128 w = _mm_xor_ps(_mm_loadu_ps(in.weight[k] + i), _mm_and_ps(dot, signMask));
+			for (int j = 0; j < 8; j++)
+				b[j] = _mm_add_ps(b[j], _mm_mul_ps(q[j], w));
+		}
+
+		__m128 len = _mm_add_ps(_mm_add_ps(_mm_mul_ps(b[0], b[0]), _mm_mul_ps(b[1], b[1])),
+								_mm_add_ps(_mm_mul_ps(b[2], b[2]), _mm_mul_ps(b[3], b[3])));
+		__m128 scale = _mm_div_ps(_mm_set1_ps(2.0f), len);
+		__m128 tx = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b[3], b[4]), _mm_mul_ps(b[7], b[0])), _mm_sub_ps(_mm_mul_ps(b[1], b[6]), _mm_mul_ps(b[2], b[5])));
+		__m128 ty = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b[3], b[5]), _mm_mul_ps(b[7], b[1])), _mm_sub_ps(_mm_mul_ps(b[2], b[4]), _mm_mul_ps(b[0], b[6])));
+		__m128 tz = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b[3], b[6]), _mm_mul_ps(b[7], b[2])), _mm_sub_ps(_mm_mul_ps(b[0], b[5]), _mm_mul_ps(b[1], b[4])));
+
+		__m128 x, y, z;
+		RotateScaled4(x, y, z, _mm_loadu_ps(in.position[0] + i), _mm_loadu_ps(in.position[1] + i), _mm_loadu_ps(in.position[2] + i), b, scale);
+		_mm_storeu_ps(out.position[0] + i, _mm_add_ps(x, _mm_mul_ps(tx, scale)));
+		_mm_storeu_ps(out.position[1] + i, _mm_add_ps(y, _mm_mul_ps(ty, scale)));
+		_mm_storeu_ps(out.position[2] + i, _mm_add_ps(z, _mm_mul_ps(tz, scale)));
+
+		if (normals)
+		{
+			RotateScaled4(x, y, z, _mm_loadu_ps(in.normal[0] + i), _mm_loadu_ps(in.normal[1] + i), _mm_loadu_ps(in.normal[2] + i), b, scale);
+			_mm_storeu_ps(out.normal[0] + i, x);
+			_mm_storeu_ps(out.normal[1] + i, y);
+			_mm_storeu_ps(out.normal[2] + i, z);
+		}
+	}
+	return i;
+}
+#endif
+
+#ifdef M3D_AVX
+// Gather the dual quaternions of eight vertices, one component per register.
+// A whole dual quaternion is one 256 bit load.
+static inline void LoadDualQuaternions8(__m256 q[8], const float *palette, const unsigned short *bone)
+{
+	for (int j = 0; j < 8; j++)
+		q[j] = _mm256_loadu_ps(palette + 8 * bone[j]);
+	Transpose8x8(q);
+}
+
+static inline void RotateScaled8(__m256 &ox, __m256 &oy, __m256 &oz, __m256 x, __m256 y, __m256 z, const __m256 b[8], __m256 scale)
+{
+	__m256 cx = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(b[1], z), _mm256_mul_ps(b[2], y)), _mm256_mul_ps(b[3], x));
+	__m256 cy = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(b[2], x), _mm256_mul_ps(b[0], z)), _mm256_mul_ps(b[3], y));
+	__m256 cz = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(b[0], y), _mm256_mul_ps(b[1], x)), _mm256_mul_ps(b[3], z));
+	ox = _mm256_add_ps(x, _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(b[1], cz), _mm256_mul_ps(b[2], cy)), scale));
+	oy = _mm256_add_ps(y, _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(b[2], cx), _mm256_mul_ps(b[0], cz)), scale));
+	oz = _mm256_add_ps(z, _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(b[0], cy), _mm256_mul_ps(b[1], cx)), scale));
+}
+
+template <int N>
+static int SkinDualQuaternionAVX(const SkinOutputStreams &out, const SkinInputStreams &in, const float *palette, bool normals, int begin, int end)
+{
+	const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x80000000));
+	int i = begin;
+	for (; i + 8 <= end; i += 8)
+	{
+		__m256 q0[8], b[8];
+		LoadDualQuaternions8(q0, palette, in.bone[0] + i);
+		for (int j = 0; j < 8; j++)
+			b[j] = q0[j];
+		if (N > 1)
+		{
+			__m256 w = _mm256_loadu_ps(in.weight[0] + i);
+			for (int j = 0; j < 8; j++)
+				b[j] = _mm256_mul_ps(q0[j], w);
+		}
+
+		for (int k = 1; k < N; k++)
+		{
+			__m256 q[8];
+			LoadDualQuaternions8(q, palette, in.bone[k] + i);
+			__m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(q[0], q0[0]), _mm256_mul_ps(q[1], q0[1])),
+									   _mm256_add_ps(_mm256_mul_ps(q[2], q0[2]), _mm256_mul_ps(q[3], q0[3])));
+			__m256 w = _mm256_xor_ps(_mm256_loadu_ps(in.weight[k] + i), _mm256_and_ps(dot, signMask));
+			for (int j = 0; j < 8; j++)
+				b[j] = _mm256_add_ps(b[j], _mm256_mul_ps(q[j], w));
+		}
+
+		__m256 len = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(b[0], b[0]), _mm256_mul_ps(b[1], b[1])),
+								   _mm256_add_ps(_mm256_mul_ps(b[2], b[2]), _mm256_mul_ps(b[3], b[3])));
+		__m256 scale = _mm256_div_ps(_mm256_set1_ps(2.0f), len);
+		__m256 tx = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(b[3], b[4]), _mm256_mul_ps(b[7], b[0])), _mm256_sub_ps(_mm256_mul_ps(b[1], b[6]), _mm256_mul_ps(b[2], b[5])));
+		__m256 ty = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(b[3], b[5]), _mm256_mul_ps(b[7], b[1])), _mm256_sub_ps(_mm256_mul_ps(b[2], b[4]), _mm256_mul_ps(b[0], b[6])));
+		__m256 tz = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(b[3], b[6]), _mm256_mul_ps(b[7], b[2])), _mm256_sub_ps(_mm256_mul_ps(b[0], b[5]), _mm256_mul_ps(b[1], b[4])));
+
+		__m256 x, y, z;
+		RotateScaled8(x, y, z, _mm256_loadu_ps(in.position[0] + i), _mm256_loadu_ps(in.position[1] + i), _mm256_loadu_ps(in.position[2] + i), b, scale);
+		_mm256_storeu_ps(out.position[0] + i, _mm256_add_ps(x, _mm256_mul_ps(tx, scale)));
+		_mm256_storeu_ps(out.position[1] + i, _mm256_add_ps(y, _mm256_mul_ps(ty, scale)));
+		_mm256_storeu_ps(out.position[2] + i, _mm256_add_ps(z, _mm256_mul_ps(tz, scale)));
+
+		if (normals)
+		{
+			RotateScaled8(x, y, z, _mm256_loadu_ps(in.normal[0] + i), _mm256_loadu_ps(in.normal[1] + i), _mm256_loadu_ps(in.normal[2] + i), b, scale);
+			_mm256_storeu_ps(out.normal[0] + i, x);
+			_mm256_storeu_ps(out.normal[1] + i, y);
+			_mm256_storeu_ps(out.normal[2] + i, z);
+		}
+	}
+	return i;
+}
+#endif
+
+template <int N>
+static void SkinDualQuaternionRange(const SkinOutputStreams &out, const SkinInputStreams &in, const float *palette, int begin, int end)
+{
+	bool normals = in.normal[0] != NULL && out.normal[0] != NULL;
+	int i = begin;
+
+#if defined(M3D_AVX)
+	i = SkinDualQuaternionAVX<N>(out, in, palette, normals, i, end);
+#elif defined(M3D_SSE2)
+	i = SkinDualQuaternionSSE<N>(out, in, palette, normals, i, end);
+#endif
+
+	for (; i < end; i++)
+		SkinDualQuaternionVertex<N>(out, in, palette, normals, i);
+}
+
+// DualQuaternion is two Quaternions, eight floats with no padding
+static const SkinRangeFunc dualQuaternionFuncs[SKIN_MAX_INFLUENCES] =
+{
+	SkinDualQuaternionRange<1>, SkinDualQuaternionRange<2>, SkinDualQuaternionRange<3>, SkinDualQuaternionRange<4>
+};
+
+void SkinDualQuaternion(const SkinOutputStreams &out, const SkinInputStreams &in, const DualQuaternion *palette)
+{
+	SkinBlocks(dualQuaternionFuncs[in.influences - 1], &out, NULL, in, reinterpret_cast<const float *>(palette));
+}
+
+void SkinDualQuaternion(const SkinVertexBuffer &out, const SkinInputStreams &in, const DualQuaternion *palette)
+{
+	SkinBlocks(dualQuaternionFuncs[in.influences - 1], NULL, &out, in, reinterpret_cast<const float *>(palette));
+}
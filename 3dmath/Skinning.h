@@ -0,0 +1,61 @@
+#ifndef SKINNING_H
+#define SKINNING_H
+#include "DualQuaternion.h"
+#include "Matrix.h"
+
+//---------------------------------------------------------------------------
+// Vertex skinning
+//
+// Vertices come in as streams, one float array per component. Influence
+// slot k of a vertex is bone[k][i] with weight[k][i]; the weights of a
+// vertex should add up to one. With a single influence the weights are not
+// read and may be NULL. The palette holds one transform per bone in
+// model space, already multiplied by the inverse bind pose.
+//
+// Large meshes are split into blocks of vertices that are skinned in
+// parallel when the library is built with OpenMP.
+
+#define SKIN_MAX_INFLUENCES	4
+
+struct SkinInputStreams
+{
+	const float *position[3];
+	const float *normal[3];							// NULL to skip normals
+	const unsigned short *bone[SKIN_MAX_INFLUENCES];
+	const float *weight[SKIN_MAX_INFLUENCES];
+	int influences;									// 1 to SKIN_MAX_INFLUENCES
+	int count;
+};
+
+struct SkinOutputStreams
+{
+	float *position[3];
+	float *normal[3];								// NULL to skip normals
+};
+
+// Interleaved destination, typically a vertex buffer mapped from the
+// graphics API. Vertex i starts at data + i * stride bytes with the position
+// and normal (three floats each) at the given byte offsets. Such memory is
+// often write-combined and slow to read, so the kernels skin into a small
+// local buffer and only ever write to it, sequentially.
+struct SkinVertexBuffer
+{
+	void *data;
+	int stride;
+	int positionOffset;
+	int normalOffset;								// -1 to skip normals
+};
+
+// Linear blend skinning: p' = sum(w_k * M_k) * p. Normals are transformed by
+// the upper 3x3 of the blended matrix and not renormalized, which is only
+// correct for bones without non-uniform scale.
+void SkinLinearBlend(const SkinOutputStreams &out, const SkinInputStreams &in, const Matrix *palette);
+void SkinLinearBlend(const SkinVertexBuffer &out, const SkinInputStreams &in, const Matrix *palette);
+
+// Dual quaternion skinning: the bone transforms are blended with
+// DualQuaternion::Blend and the blend is applied to the vertex. Keeps the
+// volume at twisting joints where blending matrices collapses it.
+void SkinDualQuaternion(const SkinOutputStreams &out, const SkinInputStreams &in, const DualQuaternion *palette);
+void SkinDualQuaternion(const SkinVertexBuffer &out, const SkinInputStreams &in, const DualQuaternion *palette);
+
+#endif // SKINNING_H
@@ -0,0 +1,331 @@
+#include <math.h>
+#include <algorithm>
+#include "SpatialHash.h"
+
+// Work is split into at most this many parts, merged in a fixed order so the
+// results do not depend on the thread count
+#define SPATIALHASH_MAX_PARTS		64
+#define SPATIALHASH_PARALLEL_SIZE	16384
+
+// Inclusive prefix sum in place: part sums in parallel, a serial scan over
+// the parts, then each part offset by the parts before it
+static void PrefixSum(unsigned int *data, int count)
+{
+	int parts = count > SPATIALHASH_PARALLEL_SIZE ? SPATIALHASH_MAX_PARTS : 1;
+	unsigned int sums[SPATIALHASH_MAX_PARTS];
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if(parts > 1)
+#endif
+	for (int p = 0; p < parts; p++)
+	{
+		int begin = int((long long)count * p / parts), end = int((long long)count * (p + 1) / parts);
+		unsigned int sum = 0;
+		for (int i = begin; i < end; i++)
+			data[i] = sum += data[i];
+		sums[p] = sum;
+	}
+
+	unsigned int offset = 0;
+	for (int p = 0; p < parts; p++)
+	{
+		unsigned int sum = sums[p];
+		sums[p] = offset;
+		offset += sum;
+	}
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if(parts > 1)
+#endif
+	for (int p = 1; p < parts; p++)
+	{
+		int begin = int((long long)count * p / parts), end = int((long long)count * (p + 1) / parts);
+		for (int i = begin; i < end; i++)
+			data[i] += sums[p];
+	}
+}
+
+SpatialHashGrid::SpatialHashGrid() : m_cellSize(1.0f), m_invCellSize(1.0f), m_mask(0)
+{
+
+}
+
+inline unsigned int SpatialHashGrid::Bucket(int cx, int cy, int cz) const
+{
+	return ((unsigned int)cx * 73856093u ^ (unsigned int)cy * 19349663u ^ (unsigned int)cz * 83492791u) & m_mask;
+}
+
+inline void SpatialHashGrid::CellOf(int cell[3], float x, float y, float z) const
+{
+	// Clamped so that far away points still give a valid cell
+	float p[3] = {x * m_invCellSize, y * m_invCellSize, z * m_invCellSize};
+	for (int k = 0; k < 3; k++)
+	{
+		float f = p[k] < -1e9f ? -1e9f : (p[k] > 1e9f ? 1e9f : p[k]);
+		int i = int(f);
+		cell[k] = i - (f < float(i) ? 1 : 0);
+	}
+}
+
+void SpatialHashGrid::Build(const CVector *points, int count, float cellSize)
+{
+	if (count > 0)
+		BuildStrided(&points[0].x, &points[0].y, &points[0].z, sizeof(CVector) / sizeof(float), count, cellSize);
+	else
+		BuildStrided(NULL, NULL, NULL, 0, 0, cellSize);
+}
+
+void SpatialHashGrid::Build(const float *x, const float *y, const float *z, int count, float cellSize)
+{
+	BuildStrided(x, y, z, 1, count, cellSize);
+}
+
+void SpatialHashGrid::BuildStrided(const float *x, const float *y, const float *z, int stride, int count, float cellSize)
+{
+	m_cellSize = cellSize;
+	m_invCellSize = 1.0f / cellSize;
+	count = count > 0 ? count : 0;
+
+	// About one bucket per point
+	unsigned int buckets = 1;
+	while (buckets < (unsigned int)count)
+		buckets *= 2;
+	m_mask = buckets - 1;
+
+	std::vector<unsigned int> keys(count);
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if(count > SPATIALHASH_PARALLEL_SIZE)
+#endif
+	for (int i = 0; i < count; i++)
+	{
+		int cell[3];
+		CellOf(cell, x[i * stride], y[i * stride], z[i * stride]);
+		keys[i] = Bucket(cell[0], cell[1], cell[2]);
+	}
+
+	// Counting sort. After the prefix sum m_start[b] is the end of bucket b;
+	// placing the points back to front moves it to the start and keeps the
+	// points of a bucket in their original order.
+	m_start.assign(buckets + 1, 0);
+	for (int i = 0; i < count; i++)
+		m_start[keys[i]]++;
+	PrefixSum(&m_start[0], buckets + 1);
+
+	m_order.resize(count);
+	for (int i = count - 1; i >= 0; i--)
+		m_order[--m_start[keys[i]]] = i;
+
+	m_x.resize(count);
+	m_y.resize(count);
+	m_z.resize(count);
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if(count > SPATIALHASH_PARALLEL_SIZE)
+#endif
+	for (int j = 0; j < count; j++)
+	{
+		int i = m_order[j] * stride;
+		m_x[j] = x[i];
+		m_y[j] = y[i];
+		m_z[j] = z[i];
+	}
+}
+
+// The buckets of the cells lo to hi, each once as several cells may hash to
+// the same one. Returns true, with bucket 0 standing for all points, if the
+// range has more cells than there are buckets.
+bool SpatialHashGrid::Buckets(std::vector<unsigned int> &buckets, const int lo[3], const int hi[3]) const
+{
+	double cells = double(hi[0] - lo[0] + 1) * double(hi[1] - lo[1] + 1) * double(hi[2] - lo[2] + 1);
+	buckets.clear();
+	if (cells > double(m_mask) + 1.0)
+	{
+		buckets.push_back(0);
+		return true;
+	}
+
+	for (int cz = lo[2]; cz <= hi[2]; cz++)
+		for (int cy = lo[1]; cy <= hi[1]; cy++)
+			for (int cx = lo[0]; cx <= hi[0]; cx++)
+				buckets.push_back(Bucket(cx, cy, cz));
+	std::sort(buckets.begin(), buckets.end());
+	buckets.erase(std::unique(buckets.begin(), buckets.end()), buckets.end());
+	return false;
+}
+
+// Appends (squared distance, index) for the points of the buckets within
+// radius of center
+void SpatialHashGrid::Scan(std::vector<std::pair<float, int> > &found, const std::vector<unsigned int> &buckets, bool all,
+						   const CVector &center, float radius) const
+{
+	float radius2 = radius * radius;
+	for (size_t b = 0; b < buckets.size(); b++)
+	{
+		int begin = m_start[buckets[b]];
+		int end = all ? int(m_order.size()) : int(m_start[buckets[b] + 1]);
+		for (int j = begin; j < end; j++)
+		{
+			float dx = m_x[j] - center.x, dy = m_y[j] - center.y, dz = m_z[j] - center.z;
+			float d2 = dx * dx + dy * dy + dz * dz;
+			if (d2 <= radius2)
+				found.push_back(std::make_pair(d2, m_order[j]));
+		}
+	}
+}
+
+// Appends the points within radius, returns true if the range covered all
+// points
+bool SpatialHashGrid::Query(std::vector<std::pair<float, int> > &found, const CVector &center, float radius,
+							std::vector<unsigned int> &buckets) const
+{
+	if (m_order.empty() || !(radius >= 0.0f))
+		return m_order.empty();
+
+	int lo[3], hi[3];
+	CellOf(lo, center.x - radius, center.y - radius, center.z - radius);
+	CellOf(hi, center.x + radius, center.y + radius, center.z + radius);
+	bool all = Buckets(buckets, lo, hi);
+	Scan(found, buckets, all, center, radius);
+	return all;
+}
+
+int SpatialHashGrid::QueryRadius(int *indices, int maxIndices, const CVector &center, float radius) const
+{
+	std::vector<std::pair<float, int> > found;
+	std::vector<unsigned int> buckets;
+	Query(found, center, radius, buckets);
+
+	int count = int(found.size());
+	for (int i = 0; i < count && i < maxIndices; i++)
+		indices[i] = found[i].second;
+	return count;
+}
+
+void SpatialHashGrid::QueryRadius(std::vector<int> &offsets, std::vector<int> &indices, const CVector *centers, int count, float radius) const
+{
+	offsets.assign(count + 1, 0);
+	int parts = count < SPATIALHASH_MAX_PARTS ? (count > 0 ? count : 1) : SPATIALHASH_MAX_PARTS;
+	std::vector<std::vector<int> > results(parts);
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic) if(count > 64)
+#endif
+	for (int p = 0; p < parts; p++)
+	{
+		std::vector<std::pair<float, int> > found;
+		std::vector<unsigned int> buckets;
+		int begin = int((long long)count * p / parts), end = int((long long)count * (p + 1) / parts);
+		for (int i = begin; i < end; i++)
+		{
+			found.clear();
+			Query(found, centers[i], radius, buckets);
+			offsets[i + 1] = int(found.size());
+			for (size_t j = 0; j < found.size(); j++)
+				results[p].push_back(found[j].second);
+		}
+	}
+
+	for (int i = 0; i < count; i++)
+		offsets[i + 1] += offsets[i];
+	indices.resize(offsets[count]);
+	for (int p = 0; p < parts; p++)
+	{
+		if (!results[p].empty())
+			std::copy(results[p].begin(), results[p].end(), indices.begin() + offsets[int((long long)count * p / parts)]);
+	}
+}
+
+// Radius queries from one cell size up, doubling until k points are found or
+// maxRadius is reached. Once k points lie within a radius, no point outside
+// it can be among the k closest.
+int SpatialHashGrid::Nearest(int *indices, float *distances2, int k, const CVector &point, float maxRadius,
+							 std::vector<std::pair<float, int> > &found, std::vector<unsigned int> &buckets) const
+{
+	float radius = m_cellSize < maxRadius ? m_cellSize : maxRadius;
+	for (;;)
+	{
+		found.clear();
+		bool all = Query(found, point, radius, buckets);
+		if (int(found.size()) >= k || radius >= maxRadius)
+			break;
+		radius = !all && 2.0f * radius < maxRadius ? 2.0f * radius : maxRadius;
+	}
+
+	int n = int(found.size()) < k ? int(found.size()) : k;
+	std::partial_sort(found.begin(), found.begin() + n, found.end());
+	for (int i = 0; i < n; i++)
+	{
+		indices[i] = found[i].second;
+		if (distances2 != NULL)
+			distances2[i] = found[i].first;
+	}
+	return n;
+}
+
+int SpatialHashGrid::QueryNearest(int *indices, float *distances2, int k, const CVector &point, float maxRadius) const
+{
+	std::vector<std::pair<float, int> > found;
+	std::vector<unsigned int> buckets;
+	return k > 0 ? Nearest(indices, distances2, k, point, maxRadius, found, buckets) : 0;
+}
+
+void SpatialHashGrid::QueryNearest(int *indices, float *distances2, int k, const CVector *points, int count, float maxRadius) const
+{
+	if (k <= 0)
+		return;
+
+	int parts = count < SPATIALHASH_MAX_PARTS ? (count > 0 ? count : 1) : SPATIALHASH_MAX_PARTS;
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic) if(count > 64)
+#endif
+	for (int p = 0; p < parts; p++)
+	{
+		std::vector<std::pair<float, int> > found;
+		std::vector<unsigned int> buckets;
+		int begin = int((long long)count * p / parts), end = int((long long)count * (p + 1) / parts);
+		for (int i = begin; i < end; i++)
+		{
+			int *result = indices + (size_t)i * k;
+			float *result2 = distances2 != NULL ? distances2 + (size_t)i * k : NULL;
+			int n = Nearest(result, result2, k, points[i], maxRadius, found, buckets);
+			for (int j = n; j < k; j++)
+			{
+				result[j] = -1;
+				if (result2 != NULL)
+					result2[j] = -1.0f;
+			}
+		}
+	}
+}
+
+// A radius query around every point in sorted order, so consecutive queries
+// touch the same buckets; each pair is found from both ends and kept once
+void SpatialHashGrid::FindPairs(std::vector<std::pair<int, int> > &pairs, float radius) const
+{
+	int count = int(m_order.size());
+	int parts = count < SPATIALHASH_MAX_PARTS ? (count > 0 ? count : 1) : SPATIALHASH_MAX_PARTS;
+	std::vector<std::vector<std::pair<int, int> > > results(parts);
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic) if(count > SPATIALHASH_PARALLEL_SIZE)
+#endif
+	for (int p = 0; p < parts; p++)
+	{
+		std::vector<std::pair<float, int> > found;
+		std::vector<unsigned int> buckets;
+		int begin = int((long long)count * p / parts), end = int((long long)count * (p + 1) / parts);
+		for (int j = begin; j < end; j++)
+		{
+			found.clear();
+			Query(found, CVector(m_x[j], m_y[j], m_z[j]), radius, buckets);
+			int a = m_order[j];
+			for (size_t f = 0; f < found.size(); f++)
+				if (a < found[f].second)
+					results[p].push_back(std::make_pair(a, found[f].second));
+		}
+	}
+
+	pairs.clear();
+	for (int p = 0; p < parts; p++)
+		pairs.insert(pairs.end(), results[p].begin(), results[p].end());
+}
@@ -0,0 +1,75 @@
+#ifndef SPATIALHASH_H
+#define SPATIALHASH_H
+#include <vector>
+#include <utility>
+#include "math3d.h"
+#include "Vector.h"
+
+//---------------------------------------------------------------------------
+// class SpatialHashGrid
+//
+// Uniform grid over a point set for proximity queries. Cells of cellSize are
+// hashed into a table of buckets; the points are counting sorted by bucket,
+// and their positions copied in that order, so a bucket is one contiguous
+// run of floats. Cells that collide share a bucket, which costs distance
+// tests but never changes a result.
+//
+// The grid copies the positions and is meant to be rebuilt whenever the
+// points move (once per frame for particles or crowds). Queries are
+// thread safe; the batched ones run in parallel when the library is built
+// with OpenMP. Results are original point indices. Radius tests include
+// points at exactly the radius.
+//
+// A cell size around the typical query radius works best.
+
+class SpatialHashGrid
+{
+public:
+	SpatialHashGrid();
+
+	void Build(const CVector *points, int count, float cellSize);
+	void Build(const float *x, const float *y, const float *z, int count, float cellSize);
+
+	// Points within radius of center. Writes up to maxIndices of them and
+	// returns how many there are in total, in no particular order.
+	int QueryRadius(int *indices, int maxIndices, const CVector &center, float radius) const;
+
+	// One radius query per center. The results of query i are
+	// indices[offsets[i]] to indices[offsets[i + 1] - 1]; offsets gets
+	// count + 1 entries.
+	void QueryRadius(std::vector<int> &offsets, std::vector<int> &indices, const CVector *centers, int count, float radius) const;
+
+	// Up to k points closest to point within maxRadius, nearest first, with
+	// their squared distances (which may be NULL). Returns how many were
+	// found.
+	int QueryNearest(int *indices, float *distances2, int k, const CVector &point, float maxRadius) const;
+
+	// One nearest query per point, k results each; missing ones are -1
+	void QueryNearest(int *indices, float *distances2, int k, const CVector *points, int count, float maxRadius) const;
+
+	// Every pair (i, j), i < j, of points within radius of each other
+	void FindPairs(std::vector<std::pair<int, int> > &pairs, float radius) const;
+
+	int GetCount() const { return int(m_order.size()); }
+	float GetCellSize() const { return m_cellSize; }
+
+private:
+	void BuildStrided(const float *x, const float *y, const float *z, int stride, int count, float cellSize);
+	unsigned int Bucket(int cx, int cy, int cz) const;
+	void CellOf(int cell[3], float x, float y, float z) const;
+	bool Buckets(std::vector<unsigned int> &buckets, const int lo[3], const int hi[3]) const;
+	void Scan(std::vector<std::pair<float, int> > &found, const std::vector<unsigned int> &buckets, bool all,
+			  const CVector &center, float radius) const;
+	bool Query(std::vector<std::pair<float, int> > &found, const CVector &center, float radius, std::vector<unsigned int> &buckets) const;
+	int Nearest(int *indices, float *distances2, int k, const CVector &point, float maxRadius,
+				std::vector<std::pair<float, int> > &found, std::vector<unsigned int> &buckets) const;
+
+	float m_cellSize;
+	float m_invCellSize;
+	unsigned int m_mask;						// bucket count - 1, a power of two
+	std::vector<unsigned int> m_start;			// first sorted point of each bucket, plus the end
+	std::vector<int> m_order;					// original index of each sorted point
+	std::vector<float> m_x, m_y, m_z;			// positions in sorted order
+};
+
+#endif // SPATIALHASH_H
@@ -0,0 +1,284 @@
+#include <limits>
+#include <algorithm>
+#include "SweepAndPrune.h"
+#include "math3dBatch.h"
+
+// The sweep is split into at most this many parts, merged in a fixed order
+// so the pairs do not depend on the thread count
+#define SWEEPANDPRUNE_MAX_PARTS		64
+#define SWEEPANDPRUNE_PARALLEL_SIZE	4096
+
+static inline void AddPair(std::vector<std::pair<int, int> > &pairs, int a, int b)
+{
+	pairs.push_back(a < b ? std::make_pair(a, b) : std::make_pair(b, a));
+}
+
+// Pairs of slot i with the slots after it that start before it ends along
+// the sweep axis and overlap it on the other two
+static void SweepSlot(std::vector<std::pair<int, int> > &pairs, const float *const *min, const float *const *max,
+					  const int *id, int i, int count)
+{
+	float end = max[0][i];
+	float lo1 = min[1][i], hi1 = max[1][i], lo2 = min[2][i], hi2 = max[2][i];
+	int j = i + 1;
+
+#if defined(M3D_AVX)
+	__m256 vEnd = _mm256_set1_ps(end);
+	__m256 vLo1 = _mm256_set1_ps(lo1), vHi1 = _mm256_set1_ps(hi1);
+	__m256 vLo2 = _mm256_set1_ps(lo2), vHi2 = _mm256_set1_ps(hi2);
+	for (; j + 8 <= count; j += 8)
+	{
+		__m256 started = _mm256_cmp_ps(_mm256_loadu_ps(min[0] + j), vEnd, _CMP_LE_OQ);
+		__m256 overlap = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(min[1] + j), vHi1, _CMP_LE_OQ),
+									   _mm256_cmp_ps(_mm256_loadu_ps(max[1] + j), vLo1, _CMP_GE_OQ));
+		overlap = _mm256_and_ps(overlap, _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(min[2] + j), vHi2, _CMP_LE_OQ),
+													   _mm256_cmp_ps(_mm256_loadu_ps(max[2] + j), vLo2, _CMP_GE_OQ)));
+		for (int mask = _mm256_movemask_ps(_mm256_and_ps(started, overlap)), k = 0; mask != 0; mask >>= 1, k++)
+			if (mask & 1)
+				AddPair(pairs, id[i], id[j + k]);
+		if (_mm256_movemask_ps(started) != 0xff)
+			return;
+	}
+#elif defined(M3D_SSE2)
+	__m128 vEnd = _mm_set1_ps(end);
+	__m128 vLo1 = _mm_set1_ps(lo1), vHi1 = _mm_set1_ps(hi1);
+	__m128 vLo2 = _mm_set1_ps(lo2), vHi2 = _mm_set1_ps(hi2);
+	for (; j + 4 <= count; j += 4)
+	{
+		__m128 started = _mm_cmple_ps(_mm_loadu_ps(min[0] + j), vEnd);
+		__m128 overlap = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(min[1] + j), vHi1),
+									_mm_cmpge_ps(_mm_loadu_ps(max[1] + j), vLo1));
+		overlap = _mm_and_ps(overlap, _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(min[2] + j), vHi2),
+												 _mm_cmpge_ps(_mm_loadu_ps(max[2] + j), vLo2)));
+		for (int mask = _mm_movemask_ps(_mm_and_ps(started, overlap)), k = 0; mask != 0; mask >>= 1, k++)
+			if (mask & 1)
+				AddPair(pairs, id[i], id[j + k]);
+		if (_mm_movemask_ps(started) != 0xf)
+			return;
+	}
+#endif
+
+	for (; j < count && min[0][j] <= end; j++)
+	{
+		if (min[1][j] <= hi1 && max[1][j] >= lo1 && min[2][j] <= hi2 && max[2][j] >= lo2)
+			AddPair(pairs, id[i], id[j]);
+	}
+}
+
+SweepAndPrune::SweepAndPrune(int axis) : m_axis(axis >= 0 && axis < 3 ? axis : 0), m_count(0), m_added(0)
+{
+
+}
+
+void SweepAndPrune::SetSlot(int slot, const CVector &min, const CVector &max)
+{
+	for (int k = 0; k < 3; k++)
+	{
+		int c = (m_axis + k) % 3;
+		m_min[k][slot] = (&min.x)[c];
+		m_max[k][slot] = (&max.x)[c];
+	}
+}
+
+void SweepAndPrune::MoveSlot(int to, int from)
+{
+	for (int k = 0; k < 3; k++)
+	{
+		m_min[k][to] = m_min[k][from];
+		m_max[k][to] = m_max[k][from];
+	}
+	m_id[to] = m_id[from];
+	m_slot[m_id[to]] = to;
+}
+
+int SweepAndPrune::Add(const CVector &min, const CVector &max)
+{
+	int id;
+	if (!m_free.empty())
+	{
+		id = m_free.back();
+		m_free.pop_back();
+	}
+	else
+	{
+		id = int(m_slot.size());
+		m_slot.push_back(int(m_id.size()));
+		m_id.push_back(id);
+		for (int k = 0; k < 3; k++)
+		{
+			m_min[k].push_back(0.0f);
+			m_max[k].push_back(0.0f);
+		}
+	}
+	SetSlot(m_slot[id], min, max);
+	m_count++;
+	m_added++;
+	return id;
+}
+
+void SweepAndPrune::Remove(int id)
+{
+	// Sorts after every live body and is never swept
+	int slot = m_slot[id];
+	for (int k = 0; k < 3; k++)
+	{
+		m_min[k][slot] = std::numeric_limits<float>::infinity();
+		m_max[k][slot] = -std::numeric_limits<float>::infinity();
+	}
+	m_free.push_back(id);
+	m_count--;
+}
+
+void SweepAndPrune::Update(int id, const CVector &min, const CVector &max)
+{
+	SetSlot(m_slot[id], min, max);
+}
+
+void SweepAndPrune::Update(const int *ids, const CVector *mins, const CVector *maxs, int count)
+{
+	for (int i = 0; i < count; i++)
+		SetSlot(m_slot[ids[i]], mins[i], maxs[i]);
+}
+
+void SweepAndPrune::Clear()
+{
+	m_count = 0;
+	m_added = 0;
+	m_slot.clear();
+	m_free.clear();
+	m_id.clear();
+	for (int k = 0; k < 3; k++)
+	{
+		m_min[k].clear();
+		m_max[k].clear();
+	}
+}
+
+void SweepAndPrune::Sort()
+{
+	int slots = int(m_id.size());
+
+	// Many new bodies at unknown places: sort from scratch
+	if (m_added > 64 && m_added > slots / 16)
+	{
+		std::vector<std::pair<float, int> > keys(slots);
+		for (int i = 0; i < slots; i++)
+			keys[i] = std::make_pair(m_min[0][i], i);
+		std::sort(keys.begin(), keys.end());
+
+		std::vector<float> min[3], max[3];
+		std::vector<int> id(slots);
+		for (int k = 0; k < 3; k++)
+		{
+			min[k].resize(slots);
+			max[k].resize(slots);
+			for (int i = 0; i < slots; i++)
+			{
+				min[k][i] = m_min[k][keys[i].second];
+				max[k][i] = m_max[k][keys[i].second];
+			}
+			m_min[k].swap(min[k]);
+			m_max[k].swap(max[k]);
+		}
+		for (int i = 0; i < slots; i++)
+		{
+			id[i] = m_id[keys[i].second];
+			m_slot[id[i]] = i;
+		}
+		m_id.swap(id);
+	}
+	else
+	{
+		// Insertion sort, each body moves about as far as it moved past others
+		for (int i = 1; i < slots; i++)
+		{
+			float key = m_min[0][i];
+			if (!(key < m_min[0][i - 1]))
+				continue;
+
+			float min[3], max[3];
+			for (int k = 0; k < 3; k++)
+			{
+				min[k] = m_min[k][i];
+				max[k] = m_max[k][i];
+			}
+			int id = m_id[i];
+
+			int j = i;
+			for (; j > 0 && m_min[0][j - 1] > key; j--)
+				MoveSlot(j, j - 1);
+
+			for (int k = 0; k < 3; k++)
+			{
+				m_min[k][j] = min[k];
+				m_max[k][j] = max[k];
+			}
+			m_id[j] = id;
+			m_slot[id] = j;
+		}
+	}
+	m_added = 0;
+}
+
+// Sweeps the live slots into the first parts of m_parts, returns the number
+// of pairs
+int SweepAndPrune::Sweep(int &parts)
+{
+	int count = m_count;
+	parts = count > SWEEPANDPRUNE_PARALLEL_SIZE ? SWEEPANDPRUNE_MAX_PARTS : 1;
+	if (int(m_parts.size()) < parts)
+		m_parts.resize(parts);
+
+	const float *min[3], *max[3];
+	for (int k = 0; k < 3; k++)
+	{
+		min[k] = count > 0 ? &m_min[k][0] : NULL;
+		max[k] = count > 0 ? &m_max[k][0] : NULL;
+	}
+	const int *id = count > 0 ? &m_id[0] : NULL;
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic) if(parts > 1)
+#endif
+	for (int p = 0; p < parts; p++)
+	{
+		m_parts[p].clear();
+		int begin = int((long long)count * p / parts), end = int((long long)count * (p + 1) / parts);
+		for (int i = begin; i < end; i++)
+			SweepSlot(m_parts[p], min, max, id, i, count);
+	}
+
+	int total = 0;
+	for (int p = 0; p < parts; p++)
+		total += int(m_parts[p].size());
+	return total;
+}
+
+int SweepAndPrune::FindPairs(std::pair<int, int> *pairs, int maxPairs)
+{
+	Sort();
+	int parts;
+	int total = Sweep(parts);
+
+	int n = 0;
+	for (int p = 0; p < parts; p++)
+	{
+		for (size_t i = 0; i < m_parts[p].size() && n < maxPairs; i++)
+			pairs[n++] = m_parts[p][i];
+	}
+	return total;
+}
+
+void SweepAndPrune::FindPairs(std::vector<std::pair<int, int> > &pairs)
+{
+	Sort();
+	int parts;
+	pairs.resize(Sweep(parts));
+
+	size_t n = 0;
+	for (int p = 0; p < parts; p++)
+	{
+		std::copy(m_parts[p].begin(), m_parts[p].end(), pairs.begin() + n);
+		n += m_parts[p].size();
+	}
+}
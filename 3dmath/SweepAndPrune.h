@@ -0,0 +1,62 @@
+#ifndef SWEEPANDPRUNE_H
+#define SWEEPANDPRUNE_H
+#include <vector>
+#include <utility>
+#include "math3d.h"
+#include "Vector.h"
+
+//---------------------------------------------------------------------------
+// class SweepAndPrune
+//
+// Broadphase over axis aligned bounds of moving bodies. The bounds are kept
+// sorted by their minimum along one axis, as structure of arrays; from one
+// frame to the next the order barely changes, so an insertion sort restores
+// it in close to linear time. The sweep then compares every body with those
+// that start before it ends along that axis, testing the two other axes
+// four or eight at a time with SSE or AVX.
+//
+// Pairs are written to a caller buffer, or to a vector that keeps its
+// capacity, and the parts of the sweep that run in parallel (with OpenMP)
+// reuse their buffers, so a steady state frame allocates nothing. Bounds
+// must be finite; touching bounds overlap.
+
+class SweepAndPrune
+{
+public:
+	// axis is the one to sweep along (0, 1 or 2), best the one along which
+	// the bodies spread out most
+	SweepAndPrune(int axis = 0);
+
+	// Returns the id of the body; ids are reused after Remove
+	int Add(const CVector &min, const CVector &max);
+	void Remove(int id);
+	void Update(int id, const CVector &min, const CVector &max);
+	void Update(const int *ids, const CVector *mins, const CVector *maxs, int count);
+	void Clear();
+
+	// Restores the order and finds all overlapping pairs (a, b) of ids, a < b.
+	// Writes up to maxPairs of them and returns how many there are in total.
+	int FindPairs(std::pair<int, int> *pairs, int maxPairs);
+	void FindPairs(std::vector<std::pair<int, int> > &pairs);
+
+	int GetCount() const { return m_count; }
+	int GetAxis() const { return m_axis; }
+
+private:
+	void Sort();
+	int Sweep(int &parts);
+	void SetSlot(int slot, const CVector &min, const CVector &max);
+	void MoveSlot(int to, int from);
+
+	int m_axis;
+	int m_count;					// live bodies, they take the first slots once sorted
+	int m_added;					// bodies added since the last sort
+	std::vector<int> m_slot;		// slot of each id, free ones included
+	std::vector<int> m_free;		// removed ids, their slots sort last
+	// Sorted by m_min[0], axes rotated so that 0 is the sweep axis
+	std::vector<float> m_min[3], m_max[3];
+	std::vector<int> m_id;
+	std::vector<std::vector<std::pair<int, int> > > m_parts;
+};
+
+#endif // SWEEPANDPRUNE_H
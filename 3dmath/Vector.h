@@ -268,19 +268,32 @@ public:
 		return result;
 	}
 
+	// As above, but false for a line parallel to the plane instead of a zero
+	// result, which can't be told from a hit at the origin
+	static bool GetLinePosInPlane(const CVector &planePoint, const CVector &planeNormal, const CVector &linePoint, const CVector &lineDir, CVector &result)
+	{
+		float vpt = planeNormal.DotProduct(lineDir);
+		if (vpt == 0.0f)
+		{
+			return false;
+		}
+		result = GetLinePosInPlane(planePoint, planeNormal, linePoint, lineDir);
+		return true;
+	}
+
 	static bool GetShortestBridge(const CVector &lineAPoint1, const CVector &lineAPoint2, const CVector &lineBPoint1, const CVector &lineBPoint2, CVector &bridgePointA, CVector &bridgePointB)
 	{
 		CVector lineADir = lineAPoint2 - lineAPoint1;
 		CVector lineBDir = lineBPoint2 - lineBPoint1;
 		lineADir.Normalize();
 		lineBDir.Normalize();
-		double dotResult = lineADir.DotProduct(lineBDir);
+		CVector abNormal = lineADir.CrossProduct(lineBDir);
 
-		if(dotResult == 0.0)
+		// Parallel lines have no single bridge; perpendicular ones do
+		if(abNormal.Length() <= 1e-6f)
 		{
 			return false;
 		}
-		CVector abNormal = lineADir.CrossProduct(lineBDir);
 		abNormal.Normalize();
 		CVector aPlaneNormal = abNormal.CrossProduct(lineADir);
 		bridgePointB =  GetLinePosInPlane(lineAPoint1, aPlaneNormal, lineBPoint1, lineBDir);
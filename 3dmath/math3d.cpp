@@ -6,16 +6,13 @@
 #include <math.h>
 #include "math3d.h"
 
+// This used to be the 0x5f3759df bit trick, reading the float through a long*.
+// long is 8 bytes on LP64 platforms so that was undefined, and even where it
+// worked the single Newton step left the quaternions from m3dMatToQuat visibly
+// non-unit. A hardware square root is exact and no slower on current CPUs.
 float ReciprocalSqrt( float x )
 {
-	long i;
-	float y, r;
-	y = x * 0.5f;
-	i = *(long *)( &x );
-	i = 0x5f3759df - ( i >> 1 );
-	r = *(float *)( &i );
-	r = r * ( 1.5f - r * r * y );
-	return r;
+	return 1.0f / sqrtf( x );
 }
 void m3dMatToQuat( float q[4], const M3DMatrix44f m)
 {
@@ -753,6 +750,96 @@ bool m3dInvertMatrix44(M3DMatrix44d dst, const M3DMatrix44d src)
 
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Determinant and inverse of a 3x3. The columns of the inverse transpose are
+// the cross products of the columns, so the rows of the inverse are.
+float m3dDeterminant33(const M3DMatrix33f m)
+	{
+	M3DVector3f yz;
+	m3dCrossProduct(yz, &m[3], &m[6]);
+	return m3dDotProduct(&m[0], yz);
+	}
+
+double m3dDeterminant33(const M3DMatrix33d m)
+	{
+	M3DVector3d yz;
+	m3dCrossProduct(yz, &m[3], &m[6]);
+	return m3dDotProduct(&m[0], yz);
+	}
+
+bool m3dInvertMatrix33(M3DMatrix33f dst, const M3DMatrix33f src)
+	{
+	M3DMatrix33f rows;
+	m3dCrossProduct(&rows[0], &src[3], &src[6]);
+	m3dCrossProduct(&rows[3], &src[6], &src[0]);
+	m3dCrossProduct(&rows[6], &src[0], &src[3]);
+	float det = m3dDotProduct(&src[0], &rows[0]);
+	if(det == 0.0f)
+		return false;
+
+	float invDet = 1.0f / det;
+	for(int c = 0; c < 3; c++)
+		for(int r = 0; r < 3; r++)
+			dst[c*3+r] = rows[r*3+c] * invDet;
+	return true;
+	}
+
+bool m3dInvertMatrix33(M3DMatrix33d dst, const M3DMatrix33d src)
+	{
+	M3DMatrix33d rows;
+	m3dCrossProduct(&rows[0], &src[3], &src[6]);
+	m3dCrossProduct(&rows[3], &src[6], &src[0]);
+	m3dCrossProduct(&rows[6], &src[0], &src[3]);
+	double det = m3dDotProduct(&src[0], &rows[0]);
+	if(det == 0.0)
+		return false;
+
+	double invDet = 1.0 / det;
+	for(int c = 0; c < 3; c++)
+		for(int r = 0; r < 3; r++)
+			dst[c*3+r] = rows[r*3+c] * invDet;
+	return true;
+	}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Decompose an affine matrix into translation, rotation and scale
+bool m3dDecomposeMatrix44(M3DVector3f translation, float rotation[4], M3DVector3f scale, const M3DMatrix44f m)
+	{
+	translation[0] = m[12];
+	translation[1] = m[13];
+	translation[2] = m[14];
+
+	// Scale is the length of the basis vectors (columns)
+	scale[0] = m3dGetVectorLength(&m[0]);
+	scale[1] = m3dGetVectorLength(&m[4]);
+	scale[2] = m3dGetVectorLength(&m[8]);
+	if(scale[0] == 0.0f || scale[1] == 0.0f || scale[2] == 0.0f)
+		{
+		rotation[0] = rotation[1] = rotation[2] = 0.0f;
+		rotation[3] = 1.0f;
+		return false;
+		}
+
+	// A negative determinant means a mirror, put it in the x scale
+	M3DVector3f yz;
+	m3dCrossProduct(yz, &m[4], &m[8]);
+	if(m3dDotProduct(&m[0], yz) < 0.0f)
+		scale[0] = -scale[0];
+
+	M3DMatrix44f r;
+	for(int c = 0; c < 3; c++)
+		{
+		float inv = 1.0f / scale[c];
+		r[c*4] = m[c*4] * inv;
+		r[c*4+1] = m[c*4+1] * inv;
+		r[c*4+2] = m[c*4+2] * inv;
+		}
+	m3dMatToQuat(rotation, r);
+	return true;
+	}
+
+
 ///////////////////////////////////////////////////////////////////////////////////////
 // Get Window coordinates, discard Z...
 void m3dProjectXY(const M3DMatrix44f mModelView, const M3DMatrix44f mProjection, const int iViewPort[4], const M3DVector3f vPointIn, M3DVector2f vPointOut)
@@ -1031,6 +1118,55 @@ float m3dRaySphereTest(const M3DVector3f point, const M3DVector3f ray, const M3D
 	}
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Determine if the ray (starting at point) intersects the triangle v0 v1 v2,
+// from either side. Same return convention as m3dRaySphereTest: < 0 if the
+// ray misses, otherwise the distance along the ray in units of its length.
+// Moller-Trumbore: solve origin + t * ray = v0 + u * (v1 - v0) + v * (v2 - v0)
+// with Cramer's rule.
+double m3dRayTriangleTest(const M3DVector3d point, const M3DVector3d ray, const M3DVector3d v0, const M3DVector3d v1, const M3DVector3d v2)
+	{
+	M3DVector3d e1, e2, p, s, q;
+	m3dSubtractVectors3(e1, v1, v0);
+	m3dSubtractVectors3(e2, v2, v0);
+	m3dCrossProduct(p, ray, e2);
+	double det = m3dDotProduct(e1, p);
+	if(det == 0.0)
+		return -1.0;
+
+	double invDet = 1.0 / det;
+	m3dSubtractVectors3(s, point, v0);
+	double u = m3dDotProduct(s, p) * invDet;
+	m3dCrossProduct(q, s, e1);
+	double v = m3dDotProduct(ray, q) * invDet;
+	double t = m3dDotProduct(e2, q) * invDet;
+	if(u < 0.0 || u > 1.0 || v < 0.0 || u + v > 1.0 || t < 0.0)
+		return -1.0;
+	return t;
+	}
+
+float m3dRayTriangleTest(const M3DVector3f point, const M3DVector3f ray, const M3DVector3f v0, const M3DVector3f v1, const M3DVector3f v2)
+	{
+	M3DVector3f e1, e2, p, s, q;
+	m3dSubtractVectors3(e1, v1, v0);
+	m3dSubtractVectors3(e2, v2, v0);
+	m3dCrossProduct(p, ray, e2);
+	float det = m3dDotProduct(e1, p);
+	if(det == 0.0f)
+		return -1.0f;
+
+	float invDet = 1.0f / det;
+	m3dSubtractVectors3(s, point, v0);
+	float u = m3dDotProduct(s, p) * invDet;
+	m3dCrossProduct(q, s, e1);
+	float v = m3dDotProduct(ray, q) * invDet;
+	float t = m3dDotProduct(e2, q) * invDet;
+	if(u < 0.0f || u > 1.0f || v < 0.0f || u + v > 1.0f || t < 0.0f)
+		return -1.0f;
+	return t;
+	}
+
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // Calculate the tangent basis for a triangle on the surface of a model
 // This vector is needed for most normal mapping shaders 
@@ -1219,3 +1355,134 @@ float m3dClosestPointOnRay(M3DVector3f vPointOnRay, const M3DVector3f vRayOrigin
 	
 	return m3dGetDistanceSquared(vPointOnRay, vPointInSpace);
 	}
+
+///////////////////////////////////////////////////////////////////////////////
+// Closest points of two segments (Ericson, Real-Time Collision Detection
+// 5.1.9). Minimize |a0 + s * da - b0 - t * db| over s, t in [0, 1]: solve
+// for s with the lines, clamp it, find t for that s, and if t has to be
+// clamped recompute s for the clamped t. For (nearly) parallel segments the
+// lines give no s; start from s = 0 and let the clamping find the pair.
+static inline double Clamp01(double x)
+	{
+	return x < 0.0 ? 0.0 : (x > 1.0 ? 1.0 : x);
+	}
+
+static inline float Clamp01(float x)
+	{
+	return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+	}
+
+double m3dClosestPointsOnSegments(M3DVector3d pointA, M3DVector3d pointB, const M3DVector3d a0, const M3DVector3d a1,
+								  const M3DVector3d b0, const M3DVector3d b1, double *s, double *t)
+	{
+	M3DVector3d da, db, r;
+	m3dSubtractVectors3(da, a1, a0);
+	m3dSubtractVectors3(db, b1, b0);
+	m3dSubtractVectors3(r, a0, b0);
+	double a = m3dDotProduct(da, da), e = m3dDotProduct(db, db);
+	double b = m3dDotProduct(da, db), c = m3dDotProduct(da, r), f = m3dDotProduct(db, r);
+
+	double sc = 0.0, tc = 0.0;
+	if(a > 0.0 && e > 0.0)
+		{
+		double denom = a * e - b * b;
+		if(denom > 1e-12 * a * e)
+			sc = Clamp01((b * f - c * e) / denom);
+		tc = (b * sc + f) / e;
+		if(tc < 0.0)
+			{
+			tc = 0.0;
+			sc = Clamp01(-c / a);
+			}
+		else if(tc > 1.0)
+			{
+			tc = 1.0;
+			sc = Clamp01((b - c) / a);
+			}
+		}
+	else if(a > 0.0)
+		sc = Clamp01(-c / a);
+	else if(e > 0.0)
+		tc = Clamp01(f / e);
+
+	for(int k = 0; k < 3; k++)
+		{
+		pointA[k] = a0[k] + da[k] * sc;
+		pointB[k] = b0[k] + db[k] * tc;
+		}
+	if(s != NULL)
+		*s = sc;
+	if(t != NULL)
+		*t = tc;
+	return m3dGetDistanceSquared(pointA, pointB);
+	}
+
+float m3dClosestPointsOnSegments(M3DVector3f pointA, M3DVector3f pointB, const M3DVector3f a0, const M3DVector3f a1,
+								 const M3DVector3f b0, const M3DVector3f b1, float *s, float *t)
+	{
+	M3DVector3f da, db, r;
+	m3dSubtractVectors3(da, a1, a0);
+	m3dSubtractVectors3(db, b1, b0);
+	m3dSubtractVectors3(r, a0, b0);
+	float a = m3dDotProduct(da, da), e = m3dDotProduct(db, db);
+	float b = m3dDotProduct(da, db), c = m3dDotProduct(da, r), f = m3dDotProduct(db, r);
+
+	float sc = 0.0f, tc = 0.0f;
+	if(a > 0.0f && e > 0.0f)
+		{
+		float denom = a * e - b * b;
+		if(denom > 1e-6f * a * e)
+			sc = Clamp01((b * f - c * e) / denom);
+		tc = (b * sc + f) / e;
+		if(tc < 0.0f)
+			{
+			tc = 0.0f;
+			sc = Clamp01(-c / a);
+			}
+		else if(tc > 1.0f)
+			{
+			tc = 1.0f;
+			sc = Clamp01((b - c) / a);
+			}
+		}
+	else if(a > 0.0f)
+		sc = Clamp01(-c / a);
+	else if(e > 0.0f)
+		tc = Clamp01(f / e);
+
+	for(int k = 0; k < 3; k++)
+		{
+		pointA[k] = a0[k] + da[k] * sc;
+		pointB[k] = b0[k] + db[k] * tc;
+		}
+	if(s != NULL)
+		*s = sc;
+	if(t != NULL)
+		*t = tc;
+	return m3dGetDistanceSquared(pointA, pointB);
+	}
+
+bool m3dCapsulesOverlap(const M3DVector3d a0, const M3DVector3d a1, double radiusA, const M3DVector3d b0, const M3DVector3d b1, double radiusB)
+	{
+	M3DVector3d pointA, pointB;
+	double radius = radiusA + radiusB;
+	return m3dClosestPointsOnSegments(pointA, pointB, a0, a1, b0, b1) <= radius * radius;
+	}
+
+bool m3dCapsulesOverlap(const M3DVector3f a0, const M3DVector3f a1, float radiusA, const M3DVector3f b0, const M3DVector3f b1, float radiusB)
+	{
+	M3DVector3f pointA, pointB;
+	float radius = radiusA + radiusB;
+	return m3dClosestPointsOnSegments(pointA, pointB, a0, a1, b0, b1) <= radius * radius;
+	}
+
+// A sphere is a capsule of zero length
+bool m3dCapsuleOverlapsSphere(const M3DVector3d a0, const M3DVector3d a1, double radius, const M3DVector3d sphereCenter, double sphereRadius)
+	{
+	return m3dCapsulesOverlap(a0, a1, radius, sphereCenter, sphereCenter, sphereRadius);
+	}
+
+bool m3dCapsuleOverlapsSphere(const M3DVector3f a0, const M3DVector3f a1, float radius, const M3DVector3f sphereCenter, float sphereRadius)
+	{
+	return m3dCapsulesOverlap(a0, a1, radius, sphereCenter, sphereCenter, sphereRadius);
+	}
@@ -393,17 +393,17 @@ inline void m3dExtractRotation(M3DMatrix33d dst, const M3DMatrix44d src)
 // Inject Rotation (3x3) into a full 4x4 matrix...
 inline void m3dInjectRotation(M3DMatrix44f dst, const M3DMatrix33f src)
 {
-	memcpy(dst, src, sizeof(float) * 4);
-	memcpy(dst + 4, src + 4, sizeof(float) * 4);
-	memcpy(dst + 8, src + 8, sizeof(float) * 4);
+	memcpy(dst, src, sizeof(float) * 3); // X column
+	memcpy(dst + 4, src + 3, sizeof(float) * 3); // Y column
+	memcpy(dst + 8, src + 6, sizeof(float) * 3); // Z column
 }
 
 // Ditto above for doubles
 inline void m3dInjectRotation(M3DMatrix44d dst, const M3DMatrix33d src)
 {
-	memcpy(dst, src, sizeof(double) * 4);
-	memcpy(dst + 4, src + 4, sizeof(double) * 4);
-	memcpy(dst + 8, src + 8, sizeof(double) * 4);
+	memcpy(dst, src, sizeof(double) * 3); // X column
+	memcpy(dst + 4, src + 3, sizeof(double) * 3); // Y column
+	memcpy(dst + 8, src + 6, sizeof(double) * 3); // Z column
 }
 
 
@@ -543,6 +543,51 @@ inline void m3dTransposeMatrix44(M3DMatrix44d dst, const M3DMatrix44d src)
 bool m3dInvertMatrix44(M3DMatrix44f dst, const M3DMatrix44f src);
 bool m3dInvertMatrix44(M3DMatrix44d dst, const M3DMatrix44d src);
 
+// 3x3 versions. The inverse is the transposed cofactor matrix over the
+// determinant; false (and dst untouched) if the matrix is singular.
+inline void m3dTransposeMatrix33(M3DMatrix33f dst, const M3DMatrix33f src)
+{ for (int c = 0; c < 3; c++) for (int r = 0; r < 3; r++) dst[c*3+r] = src[r*3+c]; }
+inline void m3dTransposeMatrix33(M3DMatrix33d dst, const M3DMatrix33d src)
+{ for (int c = 0; c < 3; c++) for (int r = 0; r < 3; r++) dst[c*3+r] = src[r*3+c]; }
+float m3dDeterminant33(const M3DMatrix33f m);
+double m3dDeterminant33(const M3DMatrix33d m);
+bool m3dInvertMatrix33(M3DMatrix33f dst, const M3DMatrix33f src);
+bool m3dInvertMatrix33(M3DMatrix33d dst, const M3DMatrix33d src);
+
+// Split an affine matrix into m = T * R * S: translation, rotation as a
+// quaternion (x, y, z, w) in the form m3dMatToQuat returns, and scale along
+// the three axes. A mirroring matrix gets a negative x scale. Shear is not
+// representable; split it off with m3dPolarDecompose33 first. Returns false
+// if a scale is zero.
+// Implemented in math3d.cpp
+bool m3dDecomposeMatrix44(M3DVector3f translation, float rotation[4], M3DVector3f scale, const M3DMatrix44f m);
+
+// Singular value decomposition a = u * diag(sigma) * v^T. u and v are
+// rotations, sigma is sorted by decreasing magnitude and only sigma[2] can be
+// negative, when a mirrors. Singular values much smaller than the largest
+// are only accurate relative to it.
+// Implemented in math3dBatch.cpp, which also has a batch version
+void m3dSVD33(M3DMatrix33f u, M3DVector3f sigma, M3DMatrix33f v, const M3DMatrix33f a);
+void m3dSVD33(M3DMatrix33d u, M3DVector3d sigma, M3DMatrix33d v, const M3DMatrix33d a);
+
+// Polar decomposition a = r * s of a 3x3 matrix into a rotation r and a
+// symmetric stretch s, which takes any shear, from the SVD: r = u * v^T and
+// s = v * diag(sigma) * v^T. r is the rotation closest to a; for a mirroring
+// a only the axis of the smallest singular value is flipped, and s gets the
+// negative value. Returns false for a singular a, but r and s are still
+// valid.
+// Implemented in math3dBatch.cpp, which also has a batch version
+bool m3dPolarDecompose33(M3DMatrix33f r, M3DMatrix33f s, const M3DMatrix33f a);
+bool m3dPolarDecompose33(M3DMatrix33d r, M3DMatrix33d s, const M3DMatrix33d a);
+
+// Eigen decomposition of a symmetric 3x3 s = vectors * diag(values) *
+// vectors^T, by the same Jacobi sweeps as m3dSVD33. The eigenvectors are
+// the columns of vectors, which is a rotation; values are in decreasing
+// order. Only the lower triangle of s is read.
+// Implemented in math3dBatch.cpp, which also has a batch version
+void m3dEigenSymmetric33(M3DMatrix33f vectors, M3DVector3f values, const M3DMatrix33f s);
+void m3dEigenSymmetric33(M3DMatrix33d vectors, M3DVector3d values, const M3DMatrix33d s);
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -573,6 +618,10 @@ void m3dGetPlaneEquation(M3DVector4d planeEq, const M3DVector3d p1, const M3DVec
 double m3dRaySphereTest(const M3DVector3d point, const M3DVector3d ray, const M3DVector3d sphereCenter, double sphereRadius);
 float m3dRaySphereTest(const M3DVector3f point, const M3DVector3f ray, const M3DVector3f sphereCenter, float sphereRadius);
 
+// Determine if a ray intersects a triangle (either side), < 0 if not
+double m3dRayTriangleTest(const M3DVector3d point, const M3DVector3d ray, const M3DVector3d v0, const M3DVector3d v1, const M3DVector3d v2);
+float m3dRayTriangleTest(const M3DVector3f point, const M3DVector3f ray, const M3DVector3f v0, const M3DVector3f v1, const M3DVector3f v2);
+
 // Etc. etc.
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -620,4 +669,19 @@ double m3dClosestPointOnRay(M3DVector3d vPointOnRay, const M3DVector3d vRayOrigi
 float m3dClosestPointOnRay(M3DVector3f vPointOnRay, const M3DVector3f vRayOrigin, const M3DVector3f vUnitRayDir, 
 							const M3DVector3f vPointInSpace);
 
+// Closest points of the segments a0-a1 and b0-b1, returning their squared
+// distance. Parallel and zero length segments are handled; of several
+// closest pairs one is picked. s and t, if not NULL, get the positions along
+// the segments, 0 at a0 (b0) to 1 at a1 (b1).
+double m3dClosestPointsOnSegments(M3DVector3d pointA, M3DVector3d pointB, const M3DVector3d a0, const M3DVector3d a1,
+								  const M3DVector3d b0, const M3DVector3d b1, double *s = NULL, double *t = NULL);
+float m3dClosestPointsOnSegments(M3DVector3f pointA, M3DVector3f pointB, const M3DVector3f a0, const M3DVector3f a1,
+								 const M3DVector3f b0, const M3DVector3f b1, float *s = NULL, float *t = NULL);
+
+// Capsules are segments with a radius. True if they touch or overlap.
+bool m3dCapsulesOverlap(const M3DVector3d a0, const M3DVector3d a1, double radiusA, const M3DVector3d b0, const M3DVector3d b1, double radiusB);
+bool m3dCapsulesOverlap(const M3DVector3f a0, const M3DVector3f a1, float radiusA, const M3DVector3f b0, const M3DVector3f b1, float radiusB);
+bool m3dCapsuleOverlapsSphere(const M3DVector3d a0, const M3DVector3d a1, double radius, const M3DVector3d sphereCenter, double sphereRadius);
+bool m3dCapsuleOverlapsSphere(const M3DVector3f a0, const M3DVector3f a1, float radius, const M3DVector3f sphereCenter, float sphereRadius);
+
 #endif
@@ -0,0 +1,2454 @@
+// math3dBatch.cpp
+// Implementation of the batch Math3d kernels. Each kernel has an SSE2 path that
+// handles four elements per iteration and a scalar path for the remainder (and
+// for compilers without SSE2).
+
+#include <float.h>
+#include <math.h>
+#include <stddef.h>
+#include "math3dBatch.h"
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Upper 3x3 of T * R * S for one element, as the nine column-major entries
+// m[0], m[1], m[2], m[4], ... m[10] of the 4x4.
+static inline void ComposeRotationScale(float r[9], const M3DTransformSoA &trs, int i)
+	{
+	float x = trs.qx[i], y = trs.qy[i], z = trs.qz[i], w = trs.qw[i];
+	float sx = 1.0f, sy = 1.0f, sz = 1.0f;
+	if(trs.sx != NULL)
+		{
+		sx = trs.sx[i];
+		sy = trs.sy[i];
+		sz = trs.sz[i];
+		}
+
+	float x2 = x + x, y2 = y + y, z2 = z + z;
+	float xx = x * x2, yy = y * y2, zz = z * z2;
+	float xy = x * y2, xz = x * z2, yz = y * z2;
+	float wx = w * x2, wy = w * y2, wz = w * z2;
+
+	r[0] = (1.0f - yy - zz) * sx;
+	r[1] = (xy - wz) * sx;
+	r[2] = (xz + wy) * sx;
+
+	r[3] = (xy + wz) * sy;
+	r[4] = (1.0f - xx - zz) * sy;
+	r[5] = (yz - wx) * sy;
+
+	r[6] = (xz - wy) * sz;
+	r[7] = (yz + wx) * sz;
+	r[8] = (1.0f - xx - yy) * sz;
+	}
+
+static void ComposeMatrix44(M3DMatrix44f m, const M3DTransformSoA &trs, int i)
+	{
+	float r[9];
+	ComposeRotationScale(r, trs, i);
+
+	m[0] = r[0]; m[1] = r[1]; m[2] = r[2]; m[3] = 0.0f;
+	m[4] = r[3]; m[5] = r[4]; m[6] = r[5]; m[7] = 0.0f;
+	m[8] = r[6]; m[9] = r[7]; m[10] = r[8]; m[11] = 0.0f;
+	m[12] = trs.tx[i]; m[13] = trs.ty[i]; m[14] = trs.tz[i]; m[15] = 1.0f;
+	}
+
+static void ComposeMatrix34(M3DMatrix34f m, const M3DTransformSoA &trs, int i)
+	{
+	float r[9];
+	ComposeRotationScale(r, trs, i);
+
+	m[0] = r[0]; m[1] = r[3]; m[2] = r[6]; m[3] = trs.tx[i];
+	m[4] = r[1]; m[5] = r[4]; m[6] = r[7]; m[7] = trs.ty[i];
+	m[8] = r[2]; m[9] = r[5]; m[10] = r[8]; m[11] = trs.tz[i];
+	}
+
+
+#ifdef M3D_SSE2
+///////////////////////////////////////////////////////////////////////////////
+// Four elements of ComposeRotationScale at once, r[k] holds entry k of
+// elements i..i+3.
+static inline void ComposeRotationScale4(__m128 r[9], const M3DTransformSoA &trs, int i)
+	{
+	__m128 x = _mm_loadu_ps(trs.qx + i);
+	__m128 y = _mm_loadu_ps(trs.qy + i);
+	__m128 z = _mm_loadu_ps(trs.qz + i);
+	__m128 w = _mm_loadu_ps(trs.qw + i);
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 sx = one, sy = one, sz = one;
+	if(trs.sx != NULL)
+		{
+		sx = _mm_loadu_ps(trs.sx + i);
+		sy = _mm_loadu_ps(trs.sy + i);
+		sz = _mm_loadu_ps(trs.sz + i);
+		}
+
+	__m128 x2 = _mm_add_ps(x, x), y2 = _mm_add_ps(y, y), z2 = _mm_add_ps(z, z);
+	__m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+	__m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+	__m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+
+	r[0] = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(one, yy), zz), sx);
+	r[1] = _mm_mul_ps(_mm_sub_ps(xy, wz), sx);
+	r[2] = _mm_mul_ps(_mm_add_ps(xz, wy), sx);
+
+	r[3] = _mm_mul_ps(_mm_add_ps(xy, wz), sy);
+	r[4] = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(one, xx), zz), sy);
+	r[5] = _mm_mul_ps(_mm_sub_ps(yz, wx), sy);
+
+	r[6] = _mm_mul_ps(_mm_sub_ps(xz, wy), sz);
+	r[7] = _mm_mul_ps(_mm_add_ps(yz, wx), sz);
+	r[8] = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(one, xx), yy), sz);
+	}
+
+// Transpose four component vectors into four consecutive float4s of four
+// consecutive elements, spaced stride floats apart.
+template <bool stream>
+static inline void Store4x4(float *dst, int stride, __m128 a, __m128 b, __m128 c, __m128 d)
+	{
+	_MM_TRANSPOSE4_PS(a, b, c, d);
+	if(stream)
+		{
+		_mm_stream_ps(dst, a);
+		_mm_stream_ps(dst + stride, b);
+		_mm_stream_ps(dst + stride * 2, c);
+		_mm_stream_ps(dst + stride * 3, d);
+		}
+	else
+		{
+		_mm_storeu_ps(dst, a);
+		_mm_storeu_ps(dst + stride, b);
+		_mm_storeu_ps(dst + stride * 2, c);
+		_mm_storeu_ps(dst + stride * 3, d);
+		}
+	}
+
+template <bool stream>
+static int ComposeMatrices44SSE(M3DMatrix44f *palette, const M3DTransformSoA &trs, int count)
+	{
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 r[9];
+	int i = 0;
+
+	for(; i + 4 <= count; i += 4)
+		{
+		ComposeRotationScale4(r, trs, i);
+		float *dst = palette[i];
+		Store4x4<stream>(dst, 16, r[0], r[1], r[2], zero);
+		Store4x4<stream>(dst + 4, 16, r[3], r[4], r[5], zero);
+		Store4x4<stream>(dst + 8, 16, r[6], r[7], r[8], zero);
+		Store4x4<stream>(dst + 12, 16, _mm_loadu_ps(trs.tx + i), _mm_loadu_ps(trs.ty + i), _mm_loadu_ps(trs.tz + i), one);
+		}
+
+	if(stream)
+		_mm_sfence();
+	return i;
+	}
+
+template <bool stream>
+static int ComposeMatrices34SSE(M3DMatrix34f *palette, const M3DTransformSoA &trs, int count)
+	{
+	__m128 r[9];
+	int i = 0;
+
+	for(; i + 4 <= count; i += 4)
+		{
+		ComposeRotationScale4(r, trs, i);
+		float *dst = palette[i];
+		Store4x4<stream>(dst, 12, r[0], r[3], r[6], _mm_loadu_ps(trs.tx + i));
+		Store4x4<stream>(dst + 4, 12, r[1], r[4], r[7], _mm_loadu_ps(trs.ty + i));
+		Store4x4<stream>(dst + 8, 12, r[2], r[5], r[8], _mm_loadu_ps(trs.tz + i));
+		}
+
+	if(stream)
+		_mm_sfence();
+	return i;
+	}
+
+// Non-temporal stores need 16 byte alignment and only pay off for outputs
+// that won't fit in the cache anyway.
+static inline bool ShouldStream(const void *dst, size_t bytes)
+	{
+	return bytes >= M3D_STREAM_THRESHOLD && (((size_t)dst) & 15) == 0;
+	}
+
+// mask ? a : b, SSE2 has no blend instruction
+static inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+	{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+// 1 / sqrt(x) to near full precision, the hardware estimate plus one
+// Newton step
+static inline __m128 ReciprocalSqrt4(__m128 x)
+	{
+	__m128 r = _mm_rsqrt_ps(x);
+	__m128 half = _mm_mul_ps(x, _mm_set1_ps(0.5f));
+	return _mm_mul_ps(r, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(half, _mm_mul_ps(r, r))));
+	}
+
+static int MatToQuatsSSE(float q[][4], const M3DMatrix44f *m, int count)
+	{
+	__m128 one = _mm_set1_ps(1.0f);
+	int i = 0;
+
+	for(; i + 4 <= count; i += 4)
+		{
+		// Load the upper 3x3 of four matrices, one entry per register
+		__m128 m0 = _mm_loadu_ps(m[i]), m1 = _mm_loadu_ps(m[i + 1]);
+		__m128 m2 = _mm_loadu_ps(m[i + 2]), m3 = _mm_loadu_ps(m[i + 3]);
+		_MM_TRANSPOSE4_PS(m0, m1, m2, m3);
+		__m128 m4 = _mm_loadu_ps(m[i] + 4), m5 = _mm_loadu_ps(m[i + 1] + 4);
+		__m128 m6 = _mm_loadu_ps(m[i + 2] + 4), m7 = _mm_loadu_ps(m[i + 3] + 4);
+		_MM_TRANSPOSE4_PS(m4, m5, m6, m7);
+		__m128 m8 = _mm_loadu_ps(m[i] + 8), m9 = _mm_loadu_ps(m[i + 1] + 8);
+		__m128 m10 = _mm_loadu_ps(m[i + 2] + 8), m11 = _mm_loadu_ps(m[i + 3] + 8);
+		_MM_TRANSPOSE4_PS(m8, m9, m10, m11);
+
+		// Pick the same case m3dMatToQuat would branch to
+		__m128 trace = _mm_add_ps(_mm_add_ps(m0, m5), m10);
+		__m128 c0 = _mm_cmpgt_ps(trace, _mm_setzero_ps());
+		__m128 c1 = _mm_andnot_ps(c0, _mm_and_ps(_mm_cmpgt_ps(m0, m5), _mm_cmpgt_ps(m0, m10)));
+		__m128 c2 = _mm_andnot_ps(_mm_or_ps(c0, c1), _mm_cmpgt_ps(m5, m10));
+
+		__m128 t0 = _mm_add_ps(trace, one);
+		__m128 t1 = _mm_sub_ps(_mm_sub_ps(_mm_add_ps(one, m0), m5), m10);
+		__m128 t2 = _mm_sub_ps(_mm_sub_ps(_mm_add_ps(one, m5), m0), m10);
+		__m128 t3 = _mm_sub_ps(_mm_sub_ps(_mm_add_ps(one, m10), m0), m5);
+		__m128 t = Select(c0, t0, Select(c1, t1, Select(c2, t2, t3)));
+		__m128 s = _mm_mul_ps(ReciprocalSqrt4(t), _mm_set1_ps(0.5f));
+
+		__m128 a = _mm_sub_ps(m4, m1), b = _mm_sub_ps(m2, m8), c = _mm_sub_ps(m9, m6);
+		__m128 sxy = _mm_add_ps(m4, m1), sxz = _mm_add_ps(m2, m8), syz = _mm_add_ps(m9, m6);
+
+		// Each component is one of four terms depending on the case
+		__m128 x = _mm_mul_ps(s, Select(c0, c, Select(c1, t, Select(c2, sxy, sxz))));
+		__m128 y = _mm_mul_ps(s, Select(c0, b, Select(c1, sxy, Select(c2, t, syz))));
+		__m128 z = _mm_mul_ps(s, Select(c0, a, Select(c1, sxz, Select(c2, syz, t))));
+		__m128 w = _mm_mul_ps(s, Select(c0, t, Select(c1, c, Select(c2, b, a))));
+
+		Store4x4<false>(q[i], 4, x, y, z, w);
+		}
+
+	return i;
+	}
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Build a palette of T * R * S matrices from SoA streams
+void m3dComposeMatrices44(M3DMatrix44f *palette, const M3DTransformSoA &trs, int count)
+	{
+	int i = 0;
+
+#ifdef M3D_SSE2
+	if(ShouldStream(palette, sizeof(M3DMatrix44f) * count))
+		i = ComposeMatrices44SSE<true>(palette, trs, count);
+	else
+		i = ComposeMatrices44SSE<false>(palette, trs, count);
+#endif
+
+	for(; i < count; i++)
+		ComposeMatrix44(palette[i], trs, i);
+	}
+
+// Ditto above, but for 3x4 row major palettes
+void m3dComposeMatrices34(M3DMatrix34f *palette, const M3DTransformSoA &trs, int count)
+	{
+	int i = 0;
+
+#ifdef M3D_SSE2
+	if(ShouldStream(palette, sizeof(M3DMatrix34f) * count))
+		i = ComposeMatrices34SSE<true>(palette, trs, count);
+	else
+		i = ComposeMatrices34SSE<false>(palette, trs, count);
+#endif
+
+	for(; i < count; i++)
+		ComposeMatrix34(palette[i], trs, i);
+	}
+
+///////////////////////////////////////////////////////////////////////////////
+// Extract rotation quaternions from an array of matrices
+void m3dMatToQuats(float q[][4], const M3DMatrix44f *m, int count)
+	{
+	int i = 0;
+
+#ifdef M3D_SSE2
+	i = MatToQuatsSSE(q, m, count);
+#endif
+
+	for(; i < count; i++)
+		m3dMatToQuat(q[i], m[i]);
+	}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Euler angle conversions
+
+// Axes in application order and the parity of the permutation. For the even
+// orders (cyclic permutations of XYZ) the axis after i is j, for the odd ones
+// it is k, which flips the sign of every cross term below.
+static const int eulerAxes[6][3] = { {0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0} };
+static const float eulerParity[6] = { 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f };
+
+// q = qk * qj * qi (Hamilton product, qi applied first) from the sines and
+// cosines of the half angles
+static inline void EulerHalfAnglesToQuat(float q[4], float sa, float ca, float sb, float cb, float sc, float cc, int order)
+	{
+	const int *axes = eulerAxes[order];
+	float parity = eulerParity[order];
+
+	// p = qj * qi
+	float pw = ca * cb;
+	float pi = sa * cb;
+	float pj = ca * sb;
+	float pk = -parity * sa * sb;
+
+	q[axes[0]] = cc * pi - parity * sc * pj;
+	q[axes[1]] = cc * pj + parity * sc * pi;
+	q[axes[2]] = cc * pk + sc * pw;
+	q[3] = cc * pw - sc * pk;
+	}
+
+// Euler angles from a rotation matrix in math notation, r[row][col] applied
+// to column vectors, r = Rk * Rj * Ri
+static inline void RotationToEuler(float e[3], const float r[3][3], int order)
+	{
+	const int *axes = eulerAxes[order];
+	int i = axes[0], j = axes[1], k = axes[2];
+	float parity = eulerParity[order];
+
+	// cos(b) from the rest of column i, which keeps b precise near +-pi/2
+	// where asin(r[k][i]) would not be
+	float sb = -parity * r[k][i];
+	float cb = float(sqrt(r[i][i] * r[i][i] + r[j][i] * r[j][i]));
+	e[j] = float(atan2(sb, cb));
+
+	if(cb < 1e-6f)
+		{
+		// Gimbal lock, only a + c (or a - c) is defined. Put it all in a,
+		// with c = 0 row j of r depends on a alone.
+		e[i] = float(atan2(-parity * r[j][k], r[j][j]));
+		e[k] = 0.0f;
+		}
+	else
+		{
+		e[i] = float(atan2(parity * r[k][j], r[k][k]));
+		e[k] = float(atan2(parity * r[j][i], r[i][i]));
+		}
+	}
+
+// Math notation rotation matrix of a unit quaternion. This is the transpose
+// of the upper 3x3 m3dQuaternionMatrix writes.
+static inline void QuatToRotation(float r[3][3], float x, float y, float z, float w)
+	{
+	float x2 = x + x, y2 = y + y, z2 = z + z;
+	float xx = x * x2, yy = y * y2, zz = z * z2;
+	float xy = x * y2, xz = x * z2, yz = y * z2;
+	float wx = w * x2, wy = w * y2, wz = w * z2;
+
+	r[0][0] = 1.0f - yy - zz; r[0][1] = xy - wz; r[0][2] = xz + wy;
+	r[1][0] = xy + wz; r[1][1] = 1.0f - xx - zz; r[1][2] = yz - wx;
+	r[2][0] = xz - wy; r[2][1] = yz + wx; r[2][2] = 1.0f - xx - yy;
+	}
+
+
+#ifdef M3D_SSE2
+///////////////////////////////////////////////////////////////////////////////
+// Four sines and cosines at once. Cephes style: reduce to [-pi/4, pi/4] with
+// an extended precision pi/4, evaluate both minimax polynomials and swap and
+// negate them per octant.
+static inline void SinCos4(__m128 x, __m128 &s, __m128 &c)
+	{
+	const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+	__m128 signSin = _mm_and_ps(x, signMask);
+	x = _mm_andnot_ps(signMask, x);
+
+	// Octant, rounded up to even
+	__m128i octant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f)));
+	octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+	__m128 y = _mm_cvtepi32_ps(octant);
+
+	// x - y * pi/4 in three steps to keep the precision
+	x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(0.78515625f)));
+	x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(2.4187564849853515625e-4f)));
+	x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(3.77489497744594108e-8f)));
+
+	__m128 swapSin = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29));
+	__m128 signCos = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+	__m128 usePoly = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+	signSin = _mm_xor_ps(signSin, swapSin);
+
+	__m128 z = _mm_mul_ps(x, x);
+
+	// cos(x) on [-pi/4, pi/4]
+	__m128 pc = _mm_set1_ps(2.443315711809948e-5f);
+	pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(-1.388731625493765e-3f));
+	pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(4.166664568298827e-2f));
+	pc = _mm_mul_ps(_mm_mul_ps(pc, z), z);
+	pc = _mm_add_ps(_mm_sub_ps(pc, _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+	// sin(x) on [-pi/4, pi/4]
+	__m128 ps = _mm_set1_ps(-1.9515295891e-4f);
+	ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(8.3321608736e-3f));
+	ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(-1.6666654611e-1f));
+	ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, z), x), x);
+
+	s = _mm_xor_ps(Select(usePoly, ps, pc), signSin);
+	c = _mm_xor_ps(Select(usePoly, pc, ps), signCos);
+	}
+
+static int SinCosSSE(float *s, float *c, const float *angles, int count)
+	{
+	int i = 0;
+	for(; i + 4 <= count; i += 4)
+		{
+		__m128 vs, vc;
+		SinCos4(_mm_loadu_ps(angles + i), vs, vc);
+		_mm_storeu_ps(s + i, vs);
+		_mm_storeu_ps(c + i, vc);
+		}
+	return i;
+	}
+
+static int EulerToQuatsSSE(float *q[4], const float *e[3], int order, int count)
+	{
+	const int *axes = eulerAxes[order];
+	__m128 parity = _mm_set1_ps(eulerParity[order]);
+	__m128 half = _mm_set1_ps(0.5f);
+	int i = 0;
+
+	for(; i + 4 <= count; i += 4)
+		{
+		__m128 sa, ca, sb, cb, sc, cc;
+		SinCos4(_mm_mul_ps(_mm_loadu_ps(e[axes[0]] + i), half), sa, ca);
+		SinCos4(_mm_mul_ps(_mm_loadu_ps(e[axes[1]] + i), half), sb, cb);
+		SinCos4(_mm_mul_ps(_mm_loadu_ps(e[axes[2]] + i), half), sc, cc);
+
+		__m128 pw = _mm_mul_ps(ca, cb);
+		__m128 pi = _mm_mul_ps(sa, cb);
+		__m128 pj = _mm_mul_ps(ca, sb);
+		__m128 pk = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(parity, _mm_mul_ps(sa, sb)));
+
+		_mm_storeu_ps(q[axes[0]] + i, _mm_sub_ps(_mm_mul_ps(cc, pi), _mm_mul_ps(parity, _mm_mul_ps(sc, pj))));
+		_mm_storeu_ps(q[axes[1]] + i, _mm_add_ps(_mm_mul_ps(cc, pj), _mm_mul_ps(parity, _mm_mul_ps(sc, pi))));
+		_mm_storeu_ps(q[axes[2]] + i, _mm_add_ps(_mm_mul_ps(cc, pk), _mm_mul_ps(sc, pw)));
+		_mm_storeu_ps(q[3] + i, _mm_sub_ps(_mm_mul_ps(cc, pw), _mm_mul_ps(sc, pk)));
+		}
+
+	return i;
+	}
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Sine and cosine of an array of angles
+void m3dSinCos(float *s, float *c, const float *angles, int count)
+	{
+	int i = 0;
+
+#ifdef M3D_SSE2
+	i = SinCosSSE(s, c, angles, count);
+#endif
+
+	for(; i < count; i++)
+		{
+		s[i] = float(sin(angles[i]));
+		c[i] = float(cos(angles[i]));
+		}
+	}
+
+///////////////////////////////////////////////////////////////////////////////
+// Euler angles to quaternions, all three half angle sincos evaluated together
+void m3dEulerToQuats(float *qx, float *qy, float *qz, float *qw, const float *ex, const float *ey, const float *ez, M3DEulerOrder order, int count)
+	{
+	float *q[4] = { qx, qy, qz, qw };
+	const float *e[3] = { ex, ey, ez };
+	const int *axes = eulerAxes[order];
+	int i = 0;
+
+#ifdef M3D_SSE2
+	i = EulerToQuatsSSE(q, e, order, count);
+#endif
+
+	for(; i < count; i++)
+		{
+		float a = e[axes[0]][i] * 0.5f, b = e[axes[1]][i] * 0.5f, c = e[axes[2]][i] * 0.5f;
+		float result[4];
+		EulerHalfAnglesToQuat(result, float(sin(a)), float(cos(a)), float(sin(b)), float(cos(b)), float(sin(c)), float(cos(c)), order);
+		qx[i] = result[0];
+		qy[i] = result[1];
+		qz[i] = result[2];
+		qw[i] = result[3];
+		}
+	}
+
+///////////////////////////////////////////////////////////////////////////////
+// Euler angles to rotation matrices. Goes through quaternions a block at a
+// time, which is cheaper than building and multiplying three axis matrices.
+void m3dEulerToMatrices44(M3DMatrix44f *m, const float *ex, const float *ey, const float *ez, M3DEulerOrder order, int count)
+	{
+	const int blockSize = 64;
+	float qx[blockSize], qy[blockSize], qz[blockSize], qw[blockSize];
+	float zero[blockSize];
+	memset(zero, 0, sizeof(zero));
+
+	M3DTransformSoA trs = { zero, zero, zero, qx, qy, qz, qw, NULL, NULL, NULL };
+
+	for(int i = 0; i < count; i += blockSize)
+		{
+		int n = count - i < blockSize ? count - i : blockSize;
+		m3dEulerToQuats(qx, qy, qz, qw, ex + i, ey + i, ez + i, order, n);
+		m3dComposeMatrices44(m + i, trs, n);
+		}
+	}
+
+///////////////////////////////////////////////////////////////////////////////
+// Quaternions to Euler angles
+void m3dQuatsToEuler(float *ex, float *ey, float *ez, const float *qx, const float *qy, const float *qz, const float *qw, M3DEulerOrder order, int count)
+	{
+	for(int i = 0; i < count; i++)
+		{
+		float r[3][3], e[3];
+		QuatToRotation(r, qx[i], qy[i], qz[i], qw[i]);
+		RotationToEuler(e, r, order);
+		ex[i] = e[0];
+		ey[i] = e[1];
+		ez[i] = e[2];
+		}
+	}
+
+///////////////////////////////////////////////////////////////////////////////
+// Rotation matrices to Euler angles. The matrices hold the transpose of the
+// math notation rotation, see m3dQuaternionMatrix.
+void m3dMatricesToEuler(float *ex, float *ey, float *ez, const M3DMatrix44f *m, M3DEulerOrder order, int count)
+	{
+	for(int i = 0; i < count; i++)
+		{
+		float r[3][3], e[3];
+		for(int row = 0; row < 3; row++)
+			for(int col = 0; col < 3; col++)
+				r[row][col] = m[i][row * 4 + col];
+
+		RotationToEuler(e, r, order);
+		ex[i] = e[0];
+		ey[i] = e[1];
+		ez[i] = e[2];
+		}
+	}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Quaternion rotation of point arrays. With one quaternion for the whole
+// array it is cheaper to expand it to a 3x3 once (9 multiplies per point)
+// than to evaluate the cross products for every point (15). Per point
+// quaternions use v' = v + w * t + q x t, t = 2 * (q x v).
+
+static inline void RotateByQuat(float out[3], float x, float y, float z, float qx, float qy, float qz, float qw)
+	{
+	float tx = 2.0f * (qy * z - qz * y);
+	float ty = 2.0f * (qz * x - qx * z);
+	float tz = 2.0f * (qx * y - qy * x);
+
+	out[0] = x + qw * tx + (qy * tz - qz * ty);
+	out[1] = y + qw * ty + (qz * tx - qx * tz);
+	out[2] = z + qw * tz + (qx * ty - qy * tx);
+	}
+
+
+#ifdef M3D_SSE2
+static inline void RotateByMatrix4(__m128 &ox, __m128 &oy, __m128 &oz, __m128 x, __m128 y, __m128 z, const __m128 r[9])
+	{
+	ox = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[0], x), _mm_mul_ps(r[1], y)), _mm_mul_ps(r[2], z));
+	oy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[3], x), _mm_mul_ps(r[4], y)), _mm_mul_ps(r[5], z));
+	oz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[6], x), _mm_mul_ps(r[7], y)), _mm_mul_ps(r[8], z));
+	}
+
+static inline void RotateByQuat4(__m128 &ox, __m128 &oy, __m128 &oz, __m128 x, __m128 y, __m128 z,
+								 __m128 qx, __m128 qy, __m128 qz, __m128 qw)
+	{
+	__m128 tx = _mm_sub_ps(_mm_mul_ps(qy, z), _mm_mul_ps(qz, y));
+	__m128 ty = _mm_sub_ps(_mm_mul_ps(qz, x), _mm_mul_ps(qx, z));
+	__m128 tz = _mm_sub_ps(_mm_mul_ps(qx, y), _mm_mul_ps(qy, x));
+	tx = _mm_add_ps(tx, tx);
+	ty = _mm_add_ps(ty, ty);
+	tz = _mm_add_ps(tz, tz);
+
+	ox = _mm_add_ps(_mm_add_ps(x, _mm_mul_ps(qw, tx)), _mm_sub_ps(_mm_mul_ps(qy, tz), _mm_mul_ps(qz, ty)));
+	oy = _mm_add_ps(_mm_add_ps(y, _mm_mul_ps(qw, ty)), _mm_sub_ps(_mm_mul_ps(qz, tx), _mm_mul_ps(qx, tz)));
+	oz = _mm_add_ps(_mm_add_ps(z, _mm_mul_ps(qw, tz)), _mm_sub_ps(_mm_mul_ps(qx, ty), _mm_mul_ps(qy, tx)));
+	}
+
+// (p[i], p[i], q[j], q[j])
+#define M3D_PAIR(p, q, i, j)	_mm_shuffle_ps(p, q, _MM_SHUFFLE(j, j, i, i))
+// (u[0], u[2], v[0], v[2])
+#define M3D_EVENS(u, v)			_mm_shuffle_ps(u, v, _MM_SHUFFLE(2, 0, 2, 0))
+
+// Four packed xyz points (12 floats) to x, y and z registers and back
+static inline void LoadPoints4(__m128 &x, __m128 &y, __m128 &z, const float *src)
+	{
+	__m128 a = _mm_loadu_ps(src);		// x0 y0 z0 x1
+	__m128 b = _mm_loadu_ps(src + 4);	// y1 z1 x2 y2
+	__m128 c = _mm_loadu_ps(src + 8);	// z2 x3 y3 z3
+
+	x = M3D_EVENS(M3D_PAIR(a, a, 0, 3), M3D_PAIR(b, c, 2, 1));
+	y = M3D_EVENS(M3D_PAIR(a, b, 1, 0), M3D_PAIR(b, c, 3, 2));
+	z = M3D_EVENS(M3D_PAIR(a, b, 2, 1), M3D_PAIR(c, c, 0, 3));
+	}
+
+static inline void StorePoints4(float *dst, __m128 x, __m128 y, __m128 z)
+	{
+	_mm_storeu_ps(dst, M3D_EVENS(M3D_PAIR(x, y, 0, 0), M3D_PAIR(z, x, 0, 1)));
+	_mm_storeu_ps(dst + 4, M3D_EVENS(M3D_PAIR(y, z, 1, 1), M3D_PAIR(x, y, 2, 2)));
+	_mm_storeu_ps(dst + 8, M3D_EVENS(M3D_PAIR(z, x, 2, 3), M3D_PAIR(y, z, 3, 3)));
+	}
+
+#undef M3D_PAIR
+#undef M3D_EVENS
+
+static int RotateVectorsSSE(M3DVector3f *out, const M3DVector3f *in, const float r[3][3], int count)
+	{
+	__m128 vr[9];
+	for(int k = 0; k < 9; k++)
+		vr[k] = _mm_set1_ps(r[k / 3][k % 3]);
+
+	int i = 0;
+	for(; i + 4 <= count; i += 4)
+		{
+		__m128 x, y, z;
+		LoadPoints4(x, y, z, in[i]);
+		RotateByMatrix4(x, y, z, x, y, z, vr);
+		StorePoints4(out[i], x, y, z);
+		}
+	return i;
+	}
+
+static int RotateVectorsByQuatsSSE(M3DVector3f *out, const M3DVector3f *in, const float q[][4], int count)
+	{
+	int i = 0;
+	for(; i + 4 <= count; i += 4)
+		{
+		__m128 qx = _mm_loadu_ps(q[i]), qy = _mm_loadu_ps(q[i + 1]);
+		__m128 qz = _mm_loadu_ps(q[i + 2]), qw = _mm_loadu_ps(q[i + 3]);
+		_MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+
+		__m128 x, y, z;
+		LoadPoints4(x, y, z, in[i]);
+		RotateByQuat4(x, y, z, x, y, z, qx, qy, qz, qw);
+		StorePoints4(out[i], x, y, z);
+		}
+	return i;
+	}
+#endif
+
+
+#ifdef M3D_AVX
+static int RotateVectorsAVX(float *outX, float *outY, float *outZ, const float *x, const float *y, const float *z, const float r[3][3], int count)
+	{
+	__m256 vr[9];
+	for(int k = 0; k < 9; k++)
+		vr[k] = _mm256_set1_ps(r[k / 3][k % 3]);
+
+	int i = 0;
+	for(; i + 8 <= count; i += 8)
+		{
+		__m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+		_mm256_storeu_ps(outX + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vr[0], vx), _mm256_mul_ps(vr[1], vy)), _mm256_mul_ps(vr[2], vz)));
+		_mm256_storeu_ps(outY + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vr[3], vx), _mm256_mul_ps(vr[4], vy)), _mm256_mul_ps(vr[5], vz)));
+		_mm256_storeu_ps(outZ + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vr[6], vx), _mm256_mul_ps(vr[7], vy)), _mm256_mul_ps(vr[8], vz)));
+		}
+	return i;
+	}
+
+static int RotateVectorsByQuatsAVX(float *outX, float *outY, float *outZ, const float *x, const float *y, const float *z,
+								   const float *qx, const float *qy, const float *qz, const float *qw, int count)
+	{
+	int i = 0;
+	for(; i + 8 <= count; i += 8)
+		{
+		__m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+		__m256 ux = _mm256_loadu_ps(qx + i), uy = _mm256_loadu_ps(qy + i), uz = _mm256_loadu_ps(qz + i);
+		__m256 w = _mm256_loadu_ps(qw + i);
+
+		__m256 tx = _mm256_sub_ps(_mm256_mul_ps(uy, vz), _mm256_mul_ps(uz, vy));
+		__m256 ty = _mm256_sub_ps(_mm256_mul_ps(uz, vx), _mm256_mul_ps(ux, vz));
+		__m256 tz = _mm256_sub_ps(_mm256_mul_ps(ux, vy), _mm256_mul_ps(uy, vx));
+		tx = _mm256_add_ps(tx, tx);
+		ty = _mm256_add_ps(ty, ty);
+		tz = _mm256_add_ps(tz, tz);
+
+		_mm256_storeu_ps(outX + i, _mm256_add_ps(_mm256_add_ps(vx, _mm256_mul_ps(w, tx)), _mm256_sub_ps(_mm256_mul_ps(uy, tz), _mm256_mul_ps(uz, ty))));
+		_mm256_storeu_ps(outY + i, _mm256_add_ps(_mm256_add_ps(vy, _mm256_mul_ps(w, ty)), _mm256_sub_ps(_mm256_mul_ps(uz, tx), _mm256_mul_ps(ux, tz))));
+		_mm256_storeu_ps(outZ + i, _mm256_add_ps(_mm256_add_ps(vz, _mm256_mul_ps(w, tz)), _mm256_sub_ps(_mm256_mul_ps(ux, ty), _mm256_mul_ps(uy, tx))));
+		}
+	return i;
+	}
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Rotate SoA points by one quaternion
+void m3dRotateVectors(float *outX, float *outY, float *outZ, const float *x, const float *y, const float *z, const float q[4], int count)
+	{
+	float r[3][3];
+	QuatToRotation(r, q[0], q[1], q[2], q[3]);
+	int i = 0;
+
+#if defined(M3D_AVX)
+	i = RotateVectorsAVX(outX, outY, outZ, x, y, z, r, count);
+#elif defined(M3D_SSE2)
+	__m128 vr[9];
+	for(int k = 0; k < 9; k++)
+		vr[k] = _mm_set1_ps(r[k / 3][k % 3]);
+	for(; i + 4 <= count; i += 4)
+		{
+		__m128 vx, vy, vz;
+		RotateByMatrix4(vx, vy, vz, _mm_loadu_ps(x + i), _mm_loadu_ps(y + i), _mm_loadu_ps(z + i), vr);
+		_mm_storeu_ps(outX + i, vx);
+		_mm_storeu_ps(outY + i, vy);
+		_mm_storeu_ps(outZ + i, vz);
+		}
+#endif
+
+	for(; i < count; i++)
+		{
+		float vx = x[i], vy = y[i], vz = z[i];
+		outX[i] = r[0][0] * vx + r[0][1] * vy + r[0][2] * vz;
+		outY[i] = r[1][0] * vx + r[1][1] * vy + r[1][2] * vz;
+		outZ[i] = r[2][0] * vx + r[2][1] * vy + r[2][2] * vz;
+		}
+	}
+
+// Ditto above, but for packed xyz points
+void m3dRotateVectors(M3DVector3f *out, const M3DVector3f *in, const float q[4], int count)
+	{
+	float r[3][3];
+	QuatToRotation(r, q[0], q[1], q[2], q[3]);
+	int i = 0;
+
+#ifdef M3D_SSE2
+	i = RotateVectorsSSE(out, in, r, count);
+#endif
+
+	for(; i < count; i++)
+		{
+		float vx = in[i][0], vy = in[i][1], vz = in[i][2];
+		out[i][0] = r[0][0] * vx + r[0][1] * vy + r[0][2] * vz;
+		out[i][1] = r[1][0] * vx + r[1][1] * vy + r[1][2] * vz;
+		out[i][2] = r[2][0] * vx + r[2][1] * vy + r[2][2] * vz;
+		}
+	}
+
+///////////////////////////////////////////////////////////////////////////////
+// Rotate SoA points, each by its own quaternion
+void m3dRotateVectorsByQuats(float *outX, float *outY, float *outZ, const float *x, const float *y, const float *z,
+							 const float *qx, const float *qy, const float *qz, const float *qw, int count)
+	{
+	int i = 0;
+
+#if defined(M3D_AVX)
+	i = RotateVectorsByQuatsAVX(outX, outY, outZ, x, y, z, qx, qy, qz, qw, count);
+#elif defined(M3D_SSE2)
+	for(; i + 4 <= count; i += 4)
+		{
+		__m128 vx, vy, vz;
+		RotateByQuat4(vx, vy, vz, _mm_loadu_ps(x + i), _mm_loadu_ps(y + i), _mm_loadu_ps(z + i),
+					  _mm_loadu_ps(qx + i), _mm_loadu_ps(qy + i), _mm_loadu_ps(qz + i), _mm_loadu_ps(qw + i));
+		_mm_storeu_ps(outX + i, vx);
+		_mm_storeu_ps(outY + i, vy);
+		_mm_storeu_ps(outZ + i, vz);
+		}
+#endif
+
+	for(; i < count; i++)
+		{
+		float v[3];
+		RotateByQuat(v, x[i], y[i], z[i], qx[i], qy[i], qz[i], qw[i]);
+		outX[i] = v[0];
+		outY[i] = v[1];
+		outZ[i] = v[2];
+		}
+	}
+
+// Ditto above, but for packed xyz points and (x, y, z, w) quaternions
+void m3dRotateVectorsByQuats(M3DVector3f *out, const M3DVector3f *in, const float q[][4], int count)
+	{
+	int i = 0;
+
+#ifdef M3D_SSE2
+	i = RotateVectorsByQuatsSSE(out, in, q, count);
+#endif
+
+	for(; i < count; i++)
+		RotateByQuat(out[i], in[i][0], in[i][1], in[i][2], q[i][0], q[i][1], q[i][2], q[i][3]);
+	}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Decomposition and interpolation of transform streams. Rotations are
+// slerped along the shorter arc; where the two are within ~1 degree the
+// weights fall back to 1 - t and t. The result is always renormalized.
+
+static inline void SlerpWeights(float &wa, float &wb, float cosAngle, float t)
+	{
+	if(cosAngle > 0.9999f)
+		{
+		wa = 1.0f - t;
+		wb = t;
+		return;
+		}
+
+	float angle = acos(cosAngle);
+	float invSin = 1.0f / sin(angle);
+	wa = sin((1.0f - t) * angle) * invSin;
+	wb = sin(t * angle) * invSin;
+	}
+
+
+#ifdef M3D_SSE2
+// atan(x) for x >= 0, Cephes atanf: reduce by pi/4 or pi/2 and use a degree 9
+// odd polynomial.
+static inline __m128 AtanPositive4(__m128 x)
+	{
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 big = _mm_cmpgt_ps(x, _mm_set1_ps(2.414213562373095f));
+	__m128 mid = _mm_andnot_ps(big, _mm_cmpgt_ps(x, _mm_set1_ps(0.4142135623730950f)));
+	__m128 offset = _mm_or_ps(_mm_and_ps(big, _mm_set1_ps(1.570796326794897f)), _mm_and_ps(mid, _mm_set1_ps(0.7853981633974483f)));
+	x = Select(big, _mm_div_ps(_mm_set1_ps(-1.0f), x), Select(mid, _mm_div_ps(_mm_sub_ps(x, one), _mm_add_ps(x, one)), x));
+
+	__m128 z = _mm_mul_ps(x, x);
+	__m128 p = _mm_set1_ps(8.05374449538e-2f);
+	p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(-1.38776856032e-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(1.99777106478e-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(-3.33329491539e-1f));
+	p = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, z), x), x);
+	return _mm_add_ps(p, offset);
+	}
+
+static inline __m128 Lerp4(__m128 a, __m128 b, __m128 t)
+	{
+	return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+	}
+
+static int InterpolateTRSSSE(const M3DTransformSoA &dst, const M3DTransformSoA &a, const M3DTransformSoA &b, const float *t, int count)
+	{
+	const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+	const __m128 one = _mm_set1_ps(1.0f);
+	int i = 0;
+
+	for(; i + 4 <= count; i += 4)
+		{
+		__m128 vt = _mm_loadu_ps(t + i);
+		_mm_storeu_ps(dst.tx + i, Lerp4(_mm_loadu_ps(a.tx + i), _mm_loadu_ps(b.tx + i), vt));
+		_mm_storeu_ps(dst.ty + i, Lerp4(_mm_loadu_ps(a.ty + i), _mm_loadu_ps(b.ty + i), vt));
+		_mm_storeu_ps(dst.tz + i, Lerp4(_mm_loadu_ps(a.tz + i), _mm_loadu_ps(b.tz + i), vt));
+		if(dst.sx != NULL)
+			{
+			_mm_storeu_ps(dst.sx + i, Lerp4(_mm_loadu_ps(a.sx + i), _mm_loadu_ps(b.sx + i), vt));
+			_mm_storeu_ps(dst.sy + i, Lerp4(_mm_loadu_ps(a.sy + i), _mm_loadu_ps(b.sy + i), vt));
+			_mm_storeu_ps(dst.sz + i, Lerp4(_mm_loadu_ps(a.sz + i), _mm_loadu_ps(b.sz + i), vt));
+			}
+
+		__m128 ax = _mm_loadu_ps(a.qx + i), ay = _mm_loadu_ps(a.qy + i), az = _mm_loadu_ps(a.qz + i), aw = _mm_loadu_ps(a.qw + i);
+		__m128 bx = _mm_loadu_ps(b.qx + i), by = _mm_loadu_ps(b.qy + i), bz = _mm_loadu_ps(b.qz + i), bw = _mm_loadu_ps(b.qw + i);
+		__m128 cosAngle = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+
+		// Shorter arc: flip b where the dot product is negative
+		__m128 flip = _mm_and_ps(cosAngle, signMask);
+		cosAngle = _mm_xor_ps(cosAngle, flip);
+
+		__m128 sinAngle = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(cosAngle, cosAngle)), _mm_setzero_ps()));
+		__m128 angle = AtanPositive4(_mm_div_ps(sinAngle, cosAngle));
+		__m128 sa, sb, unused;
+		SinCos4(_mm_mul_ps(_mm_sub_ps(one, vt), angle), sa, unused);
+		SinCos4(_mm_mul_ps(vt, angle), sb, unused);
+
+		__m128 close = _mm_cmpgt_ps(cosAngle, _mm_set1_ps(0.9999f));
+		__m128 wa = Select(close, _mm_sub_ps(one, vt), _mm_div_ps(sa, sinAngle));
+		__m128 wb = _mm_xor_ps(Select(close, vt, _mm_div_ps(sb, sinAngle)), flip);
+
+		__m128 qx = _mm_add_ps(_mm_mul_ps(ax, wa), _mm_mul_ps(bx, wb));
+		__m128 qy = _mm_add_ps(_mm_mul_ps(ay, wa), _mm_mul_ps(by, wb));
+		__m128 qz = _mm_add_ps(_mm_mul_ps(az, wa), _mm_mul_ps(bz, wb));
+		__m128 qw = _mm_add_ps(_mm_mul_ps(aw, wa), _mm_mul_ps(bw, wb));
+		__m128 inv = ReciprocalSqrt4(_mm_add_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy)), _mm_add_ps(_mm_mul_ps(qz, qz), _mm_mul_ps(qw, qw))));
+		_mm_storeu_ps(dst.qx + i, _mm_mul_ps(qx, inv));
+		_mm_storeu_ps(dst.qy + i, _mm_mul_ps(qy, inv));
+		_mm_storeu_ps(dst.qz + i, _mm_mul_ps(qz, inv));
+		_mm_storeu_ps(dst.qw + i, _mm_mul_ps(qw, inv));
+		}
+	return i;
+	}
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Decompose count matrices into translation, rotation and scale streams
+void m3dDecomposeMatrices44(const M3DTransformSoA &trs, const M3DMatrix44f *m, int count)
+	{
+	for(int i = 0; i < count; i++)
+		{
+		M3DVector3f t, s;
+		float q[4];
+		m3dDecomposeMatrix44(t, q, s, m[i]);
+
+		trs.tx[i] = t[0];
+		trs.ty[i] = t[1];
+		trs.tz[i] = t[2];
+		trs.qx[i] = q[0];
+		trs.qy[i] = q[1];
+		trs.qz[i] = q[2];
+		trs.qw[i] = q[3];
+		if(trs.sx != NULL)
+			{
+			trs.sx[i] = s[0];
+			trs.sy[i] = s[1];
+			trs.sz[i] = s[2];
+			}
+		}
+	}
+
+///////////////////////////////////////////////////////////////////////////////
+// Interpolate two transform streams with one parameter per element
+void m3dInterpolateTRS(const M3DTransformSoA &dst, const M3DTransformSoA &a, const M3DTransformSoA &b, const float *t, int count)
+	{
+	int i = 0;
+
+#ifdef M3D_SSE2
+	i = InterpolateTRSSSE(dst, a, b, t, count);
+#endif
+
+	for(; i < count; i++)
+		{
+		float ti = t[i];
+		dst.tx[i] = a.tx[i] + (b.tx[i] - a.tx[i]) * ti;
+		dst.ty[i] = a.ty[i] + (b.ty[i] - a.ty[i]) * ti;
+		dst.tz[i] = a.tz[i] + (b.tz[i] - a.tz[i]) * ti;
+		if(dst.sx != NULL)
+			{
+			dst.sx[i] = a.sx[i] + (b.sx[i] - a.sx[i]) * ti;
+			dst.sy[i] = a.sy[i] + (b.sy[i] - a.sy[i]) * ti;
+			dst.sz[i] = a.sz[i] + (b.sz[i] - a.sz[i]) * ti;
+			}
+
+		float cosAngle = a.qx[i] * b.qx[i] + a.qy[i] * b.qy[i] + a.qz[i] * b.qz[i] + a.qw[i] * b.qw[i];
+		float sign = 1.0f;
+		if(cosAngle < 0.0f)
+			{
+			cosAngle = -cosAngle;
+			sign = -1.0f;
+			}
+
+		float wa, wb;
+		SlerpWeights(wa, wb, cosAngle > 1.0f ? 1.0f : cosAngle, ti);
+		wb *= sign;
+
+		float qx = a.qx[i] * wa + b.qx[i] * wb;
+		float qy = a.qy[i] * wa + b.qy[i] * wb;
+		float qz = a.qz[i] * wa + b.qz[i] * wb;
+		float qw = a.qw[i] * wa + b.qw[i] * wb;
+		float inv = 1.0f / sqrtf(qx * qx + qy * qy + qz * qz + qw * qw);
+		dst.qx[i] = qx * inv;
+		dst.qy[i] = qy * inv;
+		dst.qz[i] = qz * inv;
+		dst.qw[i] = qw * inv;
+		}
+	}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Normal matrices. The columns of the inverse transpose of [c0 c1 c2] are
+// c1 x c2, c2 x c0 and c0 x c1 over the determinant c0 . (c1 x c2).
+static inline void NormalMatrix(float *dst, const float *m)
+	{
+	M3DVector3f c0 = {m[0], m[1], m[2]}, c1 = {m[4], m[5], m[6]}, c2 = {m[8], m[9], m[10]};
+	m3dCrossProduct(&dst[0], c1, c2);
+	m3dCrossProduct(&dst[3], c2, c0);
+	m3dCrossProduct(&dst[6], c0, c1);
+
+	float invDet = 1.0f / m3dDotProduct(c0, &dst[0]);
+	for(int k = 0; k < 9; k++)
+		dst[k] *= invDet;
+	}
+
+#ifdef M3D_SSE2
+static inline void Cross4(__m128 &x, __m128 &y, __m128 &z, __m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
+	{
+	x = _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by));
+	y = _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz));
+	z = _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx));
+	}
+
+// Four matrices at a time: transpose their columns into x, y and z registers,
+// do the cross products side by side and transpose the nine results back.
+static int NormalMatricesSSE(M3DMatrix33f *dst, const M3DMatrix44f *src, int count)
+	{
+	int i = 0;
+	for(; i + 4 <= count; i += 4)
+		{
+		__m128 c[3][4];
+		for(int k = 0; k < 3; k++)
+			{
+			c[k][0] = _mm_loadu_ps(src[i] + k * 4);
+			c[k][1] = _mm_loadu_ps(src[i + 1] + k * 4);
+			c[k][2] = _mm_loadu_ps(src[i + 2] + k * 4);
+			c[k][3] = _mm_loadu_ps(src[i + 3] + k * 4);
+			_MM_TRANSPOSE4_PS(c[k][0], c[k][1], c[k][2], c[k][3]);
+			}
+
+		__m128 n[12];
+		Cross4(n[0], n[1], n[2], c[1][0], c[1][1], c[1][2], c[2][0], c[2][1], c[2][2]);
+		Cross4(n[3], n[4], n[5], c[2][0], c[2][1], c[2][2], c[0][0], c[0][1], c[0][2]);
+		Cross4(n[6], n[7], n[8], c[0][0], c[0][1], c[0][2], c[1][0], c[1][1], c[1][2]);
+
+		__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c[0][0], n[0]), _mm_mul_ps(c[0][1], n[1])), _mm_mul_ps(c[0][2], n[2]));
+		__m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+		for(int k = 0; k < 9; k++)
+			n[k] = _mm_mul_ps(n[k], invDet);
+
+		n[9] = n[10] = n[11] = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(n[0], n[1], n[2], n[3]);
+		_MM_TRANSPOSE4_PS(n[4], n[5], n[6], n[7]);
+		_MM_TRANSPOSE4_PS(n[8], n[9], n[10], n[11]);
+		for(int j = 0; j < 4; j++)
+			{
+			_mm_storeu_ps(dst[i + j], n[j]);
+			_mm_storeu_ps(dst[i + j] + 4, n[4 + j]);
+			_mm_store_ss(dst[i + j] + 8, n[8 + j]);
+			}
+		}
+	return i;
+	}
+#endif
+
+void m3dNormalMatrices(M3DMatrix33f *dst, const M3DMatrix44f *src, int count)
+	{
+	int i = 0;
+
+#ifdef M3D_SSE2
+	i = NormalMatricesSSE(dst, src, count);
+#endif
+
+	for(; i < count; i++)
+		NormalMatrix(dst[i], src[i]);
+	}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Lane operations. Kernels written as templates over these run on plain
+// floats and doubles (with bool masks) and on whole SSE or AVX registers
+// (with compare masks), so the SIMD paths and the scalar path share one
+// source.
+
+static inline float Add(float a, float b) { return a + b; }
+static inline float Sub(float a, float b) { return a - b; }
+static inline float Mul(float a, float b) { return a * b; }
+static inline float Max(float a, float b) { return a > b ? a : b; }
+static inline float Min(float a, float b) { return a < b ? a : b; }
+static inline float Abs(float a) { return fabsf(a); }
+static inline float Sqrt(float a) { return sqrtf(a); }
+static inline float ReciprocalSqrt(float a) { return 1.0f / sqrtf(a); }
+static inline bool Less(float a, float b) { return a < b; }
+static inline float Div(float a, float b) { return a / b; }
+static inline bool LessEqual(float a, float b) { return a <= b; }
+static inline float Select(bool mask, float a, float b) { return mask ? a : b; }
+
+static inline double Add(double a, double b) { return a + b; }
+static inline double Sub(double a, double b) { return a - b; }
+static inline double Mul(double a, double b) { return a * b; }
+static inline double Max(double a, double b) { return a > b ? a : b; }
+static inline double Min(double a, double b) { return a < b ? a : b; }
+static inline double Abs(double a) { return fabs(a); }
+static inline double Sqrt(double a) { return sqrt(a); }
+static inline double ReciprocalSqrt(double a) { return 1.0 / sqrt(a); }
+static inline bool Less(double a, double b) { return a < b; }
+static inline double Div(double a, double b) { return a / b; }
+static inline bool LessEqual(double a, double b) { return a <= b; }
+static inline double Select(bool mask, double a, double b) { return mask ? a : b; }
+static inline bool And(bool a, bool b) { return a && b; }
+static inline int MaskBits(bool mask) { return mask ? 1 : 0; }
+
+template<typename V> static inline V Splat(double x);
+template<> inline float Splat<float>(double x) { return float(x); }
+template<> inline double Splat<double>(double x) { return x; }
+
+#ifdef M3D_SSE2
+static inline __m128 Add(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+static inline __m128 Sub(__m128 a, __m128 b) { return _mm_sub_ps(a, b); }
+static inline __m128 Mul(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+static inline __m128 Max(__m128 a, __m128 b) { return _mm_max_ps(a, b); }
+static inline __m128 Min(__m128 a, __m128 b) { return _mm_min_ps(a, b); }
+static inline __m128 Abs(__m128 a) { return _mm_andnot_ps(_mm_castsi128_ps(_mm_set1_epi32(0x80000000)), a); }
+static inline __m128 Sqrt(__m128 a) { return _mm_sqrt_ps(a); }
+static inline __m128 ReciprocalSqrt(__m128 a) { return ReciprocalSqrt4(a); }
+static inline __m128 Div(__m128 a, __m128 b) { return _mm_div_ps(a, b); }
+static inline __m128 Less(__m128 a, __m128 b) { return _mm_cmplt_ps(a, b); }
+static inline __m128 LessEqual(__m128 a, __m128 b) { return _mm_cmple_ps(a, b); }
+static inline __m128 And(__m128 a, __m128 b) { return _mm_and_ps(a, b); }
+static inline int MaskBits(__m128 mask) { return _mm_movemask_ps(mask); }
+template<> inline __m128 Splat<__m128>(double x) { return _mm_set1_ps(float(x)); }
+#endif
+
+#ifdef M3D_AVX
+static inline __m256 Add(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+static inline __m256 Sub(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+static inline __m256 Mul(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+static inline __m256 Max(__m256 a, __m256 b) { return _mm256_max_ps(a, b); }
+static inline __m256 Min(__m256 a, __m256 b) { return _mm256_min_ps(a, b); }
+static inline __m256 Abs(__m256 a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+static inline __m256 Sqrt(__m256 a) { return _mm256_sqrt_ps(a); }
+static inline __m256 ReciprocalSqrt(__m256 a)
+	{
+	__m256 r = _mm256_rsqrt_ps(a);
+	__m256 half = _mm256_mul_ps(a, _mm256_set1_ps(0.5f));
+	return _mm256_mul_ps(r, _mm256_sub_ps(_mm256_set1_ps(1.5f), _mm256_mul_ps(half, _mm256_mul_ps(r, r))));
+	}
+static inline __m256 Div(__m256 a, __m256 b) { return _mm256_div_ps(a, b); }
+static inline __m256 Less(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+static inline __m256 LessEqual(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+static inline __m256 And(__m256 a, __m256 b) { return _mm256_and_ps(a, b); }
+static inline int MaskBits(__m256 mask) { return _mm256_movemask_ps(mask); }
+static inline __m256 Select(__m256 mask, __m256 a, __m256 b) { return _mm256_blendv_ps(b, a, mask); }
+template<> inline __m256 Splat<__m256>(double x) { return _mm256_set1_ps(float(x)); }
+#endif
+
+static inline void LoadLanes(float &v, const float *x) { v = *x; }
+static inline void StoreLanes(float *x, float v) { *x = v; }
+#ifdef M3D_SSE2
+static inline void LoadLanes(__m128 &v, const float *x) { v = _mm_loadu_ps(x); }
+static inline void StoreLanes(float *x, __m128 v) { _mm_storeu_ps(x, v); }
+#endif
+#ifdef M3D_AVX
+static inline void LoadLanes(__m256 &v, const float *x) { v = _mm256_loadu_ps(x); }
+static inline void StoreLanes(float *x, __m256 v) { _mm256_storeu_ps(x, v); }
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////
+// 3x3 singular value decomposition, after McAdams et al., "Computing the
+// Singular Value Decomposition of 3x3 matrices with minimal branching and
+// elementary floating point operations". A fixed number of Jacobi sweeps
+// diagonalizes a^T a, accumulating v as a quaternion; the columns of a * v
+// are sorted by length and a Givens QR of the result gives u and sigma.
+// There are no branches on the data, so the same template runs on plain
+// floats and doubles and on four or eight matrices per SSE or AVX register.
+// The scalar m3dSVD33 overloads live here to share it.
+
+#define M3D_SVD_SWEEPS_FLOAT	6
+#define M3D_SVD_SWEEPS_DOUBLE	8
+
+// One Jacobi step on the symmetric s in the plane (p, q), k the remaining
+// axis, with (p, q, k) a cyclic permutation of (0, 1, 2). The rotation by
+// the half angle (ch, sh) is only approximately the one that zeroes s[p][q],
+// but it needs no trigonometry and the sweeps converge just as well. q is
+// post multiplied by the rotation about axis k.
+template<typename V, typename M, int p, int q, int k>
+static inline void JacobiStep(V s[3][3], V quat[4])
+	{
+	V ch = Mul(Splat<V>(2.0), Sub(s[p][p], s[q][q]));
+	V sh = s[p][q];
+
+	// Fall back to a rotation by pi/4 where the approximation is poor
+	M accurate = Less(Mul(Splat<V>(5.828427124746190), Mul(sh, sh)), Mul(ch, ch));
+	V w = ReciprocalSqrt(Add(Mul(ch, ch), Mul(sh, sh)));
+	ch = Select(accurate, Mul(w, ch), Splat<V>(0.9238795325112867));
+	sh = Select(accurate, Mul(w, sh), Splat<V>(0.3826834323650898));
+
+	V c = Sub(Mul(ch, ch), Mul(sh, sh));
+	V sn = Mul(Splat<V>(2.0), Mul(ch, sh));
+	V cc = Mul(c, c), ss = Mul(sn, sn), cs = Mul(c, sn);
+
+	V spp = s[p][p], sqq = s[q][q], spq = s[p][q], spk = s[p][k], sqk = s[q][k];
+	V cs2pq = Mul(Add(cs, cs), spq);
+	s[p][p] = Add(Add(Mul(cc, spp), cs2pq), Mul(ss, sqq));
+	s[q][q] = Add(Sub(Mul(ss, spp), cs2pq), Mul(cc, sqq));
+	s[p][q] = s[q][p] = Add(Mul(Sub(cc, ss), spq), Mul(cs, Sub(sqq, spp)));
+	s[p][k] = s[k][p] = Add(Mul(c, spk), Mul(sn, sqk));
+	s[q][k] = s[k][q] = Sub(Mul(c, sqk), Mul(sn, spk));
+
+	V qp = quat[p], qq = quat[q], qk = quat[k], qw = quat[3];
+	quat[p] = Add(Mul(ch, qp), Mul(sh, qq));
+	quat[q] = Sub(Mul(ch, qq), Mul(sh, qp));
+	quat[k] = Add(Mul(ch, qk), Mul(sh, qw));
+	quat[3] = Sub(Mul(ch, qw), Mul(sh, qk));
+	}
+
+// Swap columns i and j of a and b (if not NULL) where key[i] < key[j],
+// negating one of them to keep rotations rotations
+template<typename V, typename M, int i, int j>
+static inline void SortColumns(V key[3], V a[9], V b[9])
+	{
+	M swap = Less(key[i], key[j]);
+	for(int r = 0; r < 3; r++)
+		{
+		V t = a[i*3+r];
+		a[i*3+r] = Select(swap, a[j*3+r], t);
+		a[j*3+r] = Select(swap, Sub(Splat<V>(0.0), t), a[j*3+r]);
+		if(b != NULL)
+			{
+			t = b[i*3+r];
+			b[i*3+r] = Select(swap, b[j*3+r], t);
+			b[j*3+r] = Select(swap, Sub(Splat<V>(0.0), t), b[j*3+r]);
+			}
+		}
+	V t = key[i];
+	key[i] = Select(swap, key[j], t);
+	key[j] = Select(swap, t, key[j]);
+	}
+
+// Givens rotation zeroing b(q, p) against b(p, p), leaving b(p, p) >= 0.
+// b = G^T b, u = u G.
+template<typename V, typename M, int p, int q>
+static inline void QRStep(V b[9], V u[9])
+	{
+	const V tiny = Splat<V>(1e-18);
+	V a1 = b[p*3+p], a2 = b[p*3+q];
+	V rho = Sqrt(Add(Mul(a1, a1), Mul(a2, a2)));
+	V sh = Select(Less(tiny, rho), a2, Splat<V>(0.0));
+	V ch = Add(Abs(a1), Max(rho, tiny));
+
+	M negative = Less(a1, Splat<V>(0.0));
+	V t = ch;
+	ch = Select(negative, sh, ch);
+	sh = Select(negative, t, sh);
+	V w = ReciprocalSqrt(Add(Mul(ch, ch), Mul(sh, sh)));
+	ch = Mul(ch, w);
+	sh = Mul(sh, w);
+
+	V c = Sub(Mul(ch, ch), Mul(sh, sh));
+	V sn = Mul(Splat<V>(2.0), Mul(ch, sh));
+	for(int k = 0; k < 3; k++)
+		{
+		V bp = b[k*3+p], bq = b[k*3+q];
+		b[k*3+p] = Add(Mul(c, bp), Mul(sn, bq));
+		b[k*3+q] = Sub(Mul(c, bq), Mul(sn, bp));
+		V up = u[p*3+k], uq = u[q*3+k];
+		u[p*3+k] = Add(Mul(c, up), Mul(sn, uq));
+		u[q*3+k] = Sub(Mul(c, uq), Mul(sn, up));
+		}
+	}
+
+// Diagonalize the symmetric s in place with sweeps Jacobi sweeps, v = the
+// accumulated rotation, so that s_in = v * s_out * v^T
+template<typename V, typename M>
+static inline void Jacobi(V s[3][3], V v[9], int sweeps)
+	{
+	V quat[4] = {Splat<V>(0.0), Splat<V>(0.0), Splat<V>(0.0), Splat<V>(1.0)};
+	for(int sweep = 0; sweep < sweeps; sweep++)
+		{
+		JacobiStep<V, M, 0, 1, 2>(s, quat);
+		JacobiStep<V, M, 1, 2, 0>(s, quat);
+		JacobiStep<V, M, 2, 0, 1>(s, quat);
+		}
+
+	// v from the quaternion, normalized on the way
+	V x = quat[0], y = quat[1], z = quat[2], w = quat[3];
+	V n = Add(Add(Mul(x, x), Mul(y, y)), Add(Mul(z, z), Mul(w, w)));
+	V two = Mul(Splat<V>(2.0), Mul(ReciprocalSqrt(n), ReciprocalSqrt(n)));
+	V xx = Mul(x, Mul(x, two)), yy = Mul(y, Mul(y, two)), zz = Mul(z, Mul(z, two));
+	V xy = Mul(x, Mul(y, two)), xz = Mul(x, Mul(z, two)), yz = Mul(y, Mul(z, two));
+	V wx = Mul(w, Mul(x, two)), wy = Mul(w, Mul(y, two)), wz = Mul(w, Mul(z, two));
+	V one = Splat<V>(1.0);
+	v[0] = Sub(one, Add(yy, zz));	v[3] = Sub(xy, wz);				v[6] = Add(xz, wy);
+	v[1] = Add(xy, wz);				v[4] = Sub(one, Add(xx, zz));	v[7] = Sub(yz, wx);
+	v[2] = Sub(xz, wy);				v[5] = Add(yz, wx);				v[8] = Sub(one, Add(xx, yy));
+	}
+
+// a = u * diag(sigma) * v^T, all matrices column major
+template<typename V, typename M>
+static inline void SVD33(V u[9], V sigma[3], V v[9], const V a[9], int sweeps)
+	{
+	// s = a^T a
+	V s[3][3];
+	for(int i = 0; i < 3; i++)
+		for(int j = 0; j <= i; j++)
+			s[i][j] = s[j][i] = Add(Add(Mul(a[i*3], a[j*3]), Mul(a[i*3+1], a[j*3+1])), Mul(a[i*3+2], a[j*3+2]));
+
+	Jacobi<V, M>(s, v, sweeps);
+
+	// b = a * v, columns sorted by decreasing length
+	V b[9], rho[3];
+	for(int c = 0; c < 3; c++)
+		{
+		for(int r = 0; r < 3; r++)
+			b[c*3+r] = Add(Add(Mul(a[r], v[c*3]), Mul(a[3+r], v[c*3+1])), Mul(a[6+r], v[c*3+2]));
+		rho[c] = Add(Add(Mul(b[c*3], b[c*3]), Mul(b[c*3+1], b[c*3+1])), Mul(b[c*3+2], b[c*3+2]));
+		}
+	SortColumns<V, M, 0, 1>(rho, b, v);
+	SortColumns<V, M, 0, 2>(rho, b, v);
+	SortColumns<V, M, 1, 2>(rho, b, v);
+
+	// b = u * r with r upper triangular, whose diagonal is sigma
+	for(int k = 0; k < 9; k++)
+		u[k] = Splat<V>(k % 4 == 0 ? 1.0 : 0.0);
+	QRStep<V, M, 0, 1>(b, u);
+	QRStep<V, M, 0, 2>(b, u);
+	QRStep<V, M, 1, 2>(b, u);
+	sigma[0] = b[0];
+	sigma[1] = b[4];
+	sigma[2] = b[8];
+	}
+
+// s = vectors * diag(values) * vectors^T for a symmetric s, values sorted
+// in decreasing order
+template<typename V, typename M>
+static inline void EigenSymmetric33(V vectors[9], V values[3], const V s[9], int sweeps)
+	{
+	V d[3][3];
+	for(int c = 0; c < 3; c++)
+		for(int r = c; r < 3; r++)
+			d[c][r] = d[r][c] = s[c*3+r];
+
+	Jacobi<V, M>(d, vectors, sweeps);
+	values[0] = d[0][0];
+	values[1] = d[1][1];
+	values[2] = d[2][2];
+	SortColumns<V, M, 0, 1>(values, vectors, (V *)NULL);
+	SortColumns<V, M, 0, 2>(values, vectors, (V *)NULL);
+	SortColumns<V, M, 1, 2>(values, vectors, (V *)NULL);
+	}
+
+// r = u * v^T, s = v * diag(sigma) * v^T
+template<typename V>
+static inline void PolarFromSVD(V r[9], V s[9], const V u[9], const V sigma[3], const V v[9])
+	{
+	for(int c = 0; c < 3; c++)
+		for(int row = 0; row < 3; row++)
+			{
+			r[c*3+row] = Add(Add(Mul(u[row], v[c]), Mul(u[3+row], v[3+c])), Mul(u[6+row], v[6+c]));
+			if(s != NULL)
+				s[c*3+row] = Add(Add(Mul(Mul(v[row], sigma[0]), v[c]), Mul(Mul(v[3+row], sigma[1]), v[3+c])),
+								 Mul(Mul(v[6+row], sigma[2]), v[6+c]));
+			}
+	}
+
+void m3dSVD33(M3DMatrix33f u, M3DVector3f sigma, M3DMatrix33f v, const M3DMatrix33f a)
+	{
+	SVD33<float, bool>(u, sigma, v, a, M3D_SVD_SWEEPS_FLOAT);
+	}
+
+void m3dSVD33(M3DMatrix33d u, M3DVector3d sigma, M3DMatrix33d v, const M3DMatrix33d a)
+	{
+	SVD33<double, bool>(u, sigma, v, a, M3D_SVD_SWEEPS_DOUBLE);
+	}
+
+void m3dEigenSymmetric33(M3DMatrix33f vectors, M3DVector3f values, const M3DMatrix33f s)
+	{
+	EigenSymmetric33<float, bool>(vectors, values, s, M3D_SVD_SWEEPS_FLOAT);
+	}
+
+void m3dEigenSymmetric33(M3DMatrix33d vectors, M3DVector3d values, const M3DMatrix33d s)
+	{
+	EigenSymmetric33<double, bool>(vectors, values, s, M3D_SVD_SWEEPS_DOUBLE);
+	}
+
+// One definition for both precisions, the batch version takes its rotation
+// from the same PolarFromSVD
+template<typename T>
+static bool PolarDecompose33(T r[9], T s[9], const T a[9], int sweeps)
+	{
+	T u[9], v[9], sigma[3];
+	SVD33<T, bool>(u, sigma, v, a, sweeps);
+	PolarFromSVD<T>(r, s, u, sigma, v);
+	return sigma[2] != T(0);
+	}
+
+bool m3dPolarDecompose33(M3DMatrix33f r, M3DMatrix33f s, const M3DMatrix33f a)
+	{
+	return PolarDecompose33<float>(r, s, a, M3D_SVD_SWEEPS_FLOAT);
+	}
+
+bool m3dPolarDecompose33(M3DMatrix33d r, M3DMatrix33d s, const M3DMatrix33d a)
+	{
+	return PolarDecompose33<double>(r, s, a, M3D_SVD_SWEEPS_DOUBLE);
+	}
+
+// N matrices with one array per entry, to load into and store from registers
+template<int N>
+struct SVDLanes
+	{
+	float a[9][N], u[9][N], v[9][N], sigma[3][N];
+	};
+
+
+template<typename V, int N>
+static int SVDMatricesSIMD(M3DMatrix33f *u, M3DVector3f *sigma, M3DMatrix33f *v, const M3DMatrix33f *a, int count, int i)
+	{
+	for(; i + N <= count; i += N)
+		{
+		SVDLanes<N> lanes;
+		for(int j = 0; j < N; j++)
+			for(int k = 0; k < 9; k++)
+				lanes.a[k][j] = a[i + j][k];
+
+		V va[9], vu[9], vv[9], vs[3];
+		for(int k = 0; k < 9; k++)
+			LoadLanes(va[k], lanes.a[k]);
+		SVD33<V, V>(vu, vs, vv, va, M3D_SVD_SWEEPS_FLOAT);
+		for(int k = 0; k < 9; k++)
+			{
+			StoreLanes(lanes.u[k], vu[k]);
+			StoreLanes(lanes.v[k], vv[k]);
+			}
+		for(int k = 0; k < 3; k++)
+			StoreLanes(lanes.sigma[k], vs[k]);
+
+		for(int j = 0; j < N; j++)
+			{
+			for(int k = 0; k < 9; k++)
+				{
+				u[i + j][k] = lanes.u[k][j];
+				v[i + j][k] = lanes.v[k][j];
+				}
+			for(int k = 0; k < 3; k++)
+				sigma[i + j][k] = lanes.sigma[k][j];
+			}
+		}
+	return i;
+	}
+
+template<typename V, int N>
+static int EigenSymmetricMatricesSIMD(M3DMatrix33f *vectors, M3DVector3f *values, const M3DMatrix33f *s, int count, int i)
+	{
+	for(; i + N <= count; i += N)
+		{
+		SVDLanes<N> lanes;
+		for(int j = 0; j < N; j++)
+			for(int k = 0; k < 9; k++)
+				lanes.a[k][j] = s[i + j][k];
+
+		V vs[9], vv[9], vd[3];
+		for(int k = 0; k < 9; k++)
+			LoadLanes(vs[k], lanes.a[k]);
+		EigenSymmetric33<V, V>(vv, vd, vs, M3D_SVD_SWEEPS_FLOAT);
+		for(int k = 0; k < 9; k++)
+			StoreLanes(lanes.v[k], vv[k]);
+		for(int k = 0; k < 3; k++)
+			StoreLanes(lanes.sigma[k], vd[k]);
+
+		for(int j = 0; j < N; j++)
+			{
+			for(int k = 0; k < 9; k++)
+				vectors[i + j][k] = lanes.v[k][j];
+			for(int k = 0; k < 3; k++)
+				values[i + j][k] = lanes.sigma[k][j];
+			}
+		}
+	return i;
+	}
+
+///////////////////////////////////////////////////////////////////////////////
+// SVD and polar decomposition of count 3x3 matrices
+void m3dSVDMatrices33(M3DMatrix33f *u, M3DVector3f *sigma, M3DMatrix33f *v, const M3DMatrix33f *a, int count)
+	{
+	int i = 0;
+
+#ifdef M3D_AVX
+	i = SVDMatricesSIMD<__m256, 8>(u, sigma, v, a, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = SVDMatricesSIMD<__m128, 4>(u, sigma, v, a, count, i);
+#endif
+
+	for(; i < count; i++)
+		m3dSVD33(u[i], sigma[i], v[i], a[i]);
+	}
+
+void m3dPolarDecomposeMatrices33(M3DMatrix33f *r, M3DMatrix33f *s, const M3DMatrix33f *a, int count)
+	{
+	// In chunks through a small local buffer
+	const int chunk = 64;
+	M3DMatrix33f u[chunk], v[chunk];
+	M3DVector3f sigma[chunk];
+
+	for(int i = 0; i < count; i += chunk)
+		{
+		int n = count - i < chunk ? count - i : chunk;
+		m3dSVDMatrices33(u, sigma, v, a + i, n);
+		for(int j = 0; j < n; j++)
+			PolarFromSVD<float>(r[i + j], s != NULL ? s[i + j] : NULL, u[j], sigma[j], v[j]);
+		}
+	}
+
+///////////////////////////////////////////////////////////////////////////////
+// Eigen decomposition of count symmetric 3x3 matrices
+void m3dEigenSymmetricMatrices33(M3DMatrix33f *vectors, M3DVector3f *values, const M3DMatrix33f *s, int count)
+	{
+	int i = 0;
+
+#ifdef M3D_AVX
+	i = EigenSymmetricMatricesSIMD<__m256, 8>(vectors, values, s, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = EigenSymmetricMatricesSIMD<__m128, 4>(vectors, values, s, count, i);
+#endif
+
+	for(; i < count; i++)
+		m3dEigenSymmetric33(vectors[i], values[i], s[i]);
+	}
+
+///////////////////////////////////////////////////////////////////////////////
+// Ray packets. The kernels follow m3dRaySphereTest and m3dRayTriangleTest:
+// a sphere miss leaves the negative discriminant, a triangle miss (including
+// a ray parallel to the plane, where the NaNs and infinities fail every
+// compare) gives -1. Unlike m3dRaySphereTest the sphere kernel takes any
+// direction length: the discriminant is scaled by ray . ray, and the hit
+// divided by it, so the distance is in units of the ray length as for the
+// triangles and the same as m3dRaySphereTest for a unit ray.
+template<typename V, typename M>
+static inline V RaySphere(const V point[3], const V ray[3], const V center[3], V radius)
+	{
+	V d[3] = { Sub(center[0], point[0]), Sub(center[1], point[1]), Sub(center[2], point[2]) };
+	V a = Add(Add(Mul(d[0], ray[0]), Mul(d[1], ray[1])), Mul(d[2], ray[2]));
+	V distance2 = Add(Add(Mul(d[0], d[0]), Mul(d[1], d[1])), Mul(d[2], d[2]));
+	V length2 = Add(Add(Mul(ray[0], ray[0]), Mul(ray[1], ray[1])), Mul(ray[2], ray[2]));
+	V ret = Add(Mul(Sub(Mul(radius, radius), distance2), length2), Mul(a, a));
+	M hit = Less(Splat<V>(0.0), ret);
+	return Select(hit, Div(Sub(a, Sqrt(ret)), length2), ret);
+	}
+
+template<typename V, typename M>
+static inline V RayTriangle(const V point[3], const V ray[3], const V v0[3], const V v1[3], const V v2[3])
+	{
+	V e1[3], e2[3], s[3];
+	for(int k = 0; k < 3; k++)
+		{
+		e1[k] = Sub(v1[k], v0[k]);
+		e2[k] = Sub(v2[k], v0[k]);
+		s[k] = Sub(point[k], v0[k]);
+		}
+
+	V p[3] = { Sub(Mul(ray[1], e2[2]), Mul(ray[2], e2[1])),
+			   Sub(Mul(ray[2], e2[0]), Mul(ray[0], e2[2])),
+			   Sub(Mul(ray[0], e2[1]), Mul(ray[1], e2[0])) };
+	V q[3] = { Sub(Mul(s[1], e1[2]), Mul(s[2], e1[1])),
+			   Sub(Mul(s[2], e1[0]), Mul(s[0], e1[2])),
+			   Sub(Mul(s[0], e1[1]), Mul(s[1], e1[0])) };
+
+	V invDet = Div(Splat<V>(1.0), Add(Add(Mul(e1[0], p[0]), Mul(e1[1], p[1])), Mul(e1[2], p[2])));
+	V u = Mul(Add(Add(Mul(s[0], p[0]), Mul(s[1], p[1])), Mul(s[2], p[2])), invDet);
+	V v = Mul(Add(Add(Mul(ray[0], q[0]), Mul(ray[1], q[1])), Mul(ray[2], q[2])), invDet);
+	V t = Mul(Add(Add(Mul(e2[0], q[0]), Mul(e2[1], q[1])), Mul(e2[2], q[2])), invDet);
+
+	V zero = Splat<V>(0.0), one = Splat<V>(1.0);
+	M hit = And(And(LessEqual(zero, u), LessEqual(u, one)),
+				And(And(LessEqual(zero, v), LessEqual(Add(u, v), one)), LessEqual(zero, t)));
+	return Select(hit, t, Splat<V>(-1.0));
+	}
+
+// Lanes of a ray packet, or one ray broadcast to every lane
+template<typename V>
+static inline void LoadRays(V point[3], V ray[3], const M3DRaySoA &rays, int i)
+	{
+	for(int k = 0; k < 3; k++)
+		{
+		LoadLanes(point[k], rays.origin[k] + i);
+		LoadLanes(ray[k], rays.direction[k] + i);
+		}
+	}
+
+template<typename V>
+static inline void SplatVector(V v[3], const M3DVector3f x)
+	{
+	for(int k = 0; k < 3; k++)
+		v[k] = Splat<V>(x[k]);
+	}
+
+template<typename V, typename M, int N>
+static int RaySphereTestsLanes(float *distance, const M3DRaySoA &rays, const M3DVector3f sphereCenter, float sphereRadius, int count, int i)
+	{
+	V center[3];
+	SplatVector(center, sphereCenter);
+	V radius = Splat<V>(sphereRadius);
+	for(; i + N <= count; i += N)
+		{
+		V point[3], ray[3];
+		LoadRays(point, ray, rays, i);
+		StoreLanes(distance + i, RaySphere<V, M>(point, ray, center, radius));
+		}
+	return i;
+	}
+
+template<typename V, typename M, int N>
+static int RaySphereTestsLanes(float *distance, const M3DVector3f origin, const M3DVector3f direction, const M3DSphereSoA &spheres, int count, int i)
+	{
+	V point[3], ray[3];
+	SplatVector(point, origin);
+	SplatVector(ray, direction);
+	for(; i + N <= count; i += N)
+		{
+		V center[3], radius;
+		for(int k = 0; k < 3; k++)
+			LoadLanes(center[k], spheres.center[k] + i);
+		LoadLanes(radius, spheres.radius + i);
+		StoreLanes(distance + i, RaySphere<V, M>(point, ray, center, radius));
+		}
+	return i;
+	}
+
+template<typename V, int N>
+static int RayTriangleTestsSIMD(float *distance, const M3DRaySoA &rays, const M3DVector3f v0, const M3DVector3f v1, const M3DVector3f v2, int count, int i)
+	{
+	V a[3], b[3], c[3];
+	SplatVector(a, v0);
+	SplatVector(b, v1);
+	SplatVector(c, v2);
+	for(; i + N <= count; i += N)
+		{
+		V point[3], ray[3];
+		LoadRays(point, ray, rays, i);
+		StoreLanes(distance + i, RayTriangle<V, V>(point, ray, a, b, c));
+		}
+	return i;
+	}
+
+template<typename V, int N>
+static int RayTriangleTestsSIMD(float *distance, const M3DVector3f origin, const M3DVector3f direction, const M3DTriangleSoA &triangles, int count, int i)
+	{
+	V point[3], ray[3];
+	SplatVector(point, origin);
+	SplatVector(ray, direction);
+	for(; i + N <= count; i += N)
+		{
+		V a[3], b[3], c[3];
+		for(int k = 0; k < 3; k++)
+			{
+			LoadLanes(a[k], triangles.v0[k] + i);
+			LoadLanes(b[k], triangles.v1[k] + i);
+			LoadLanes(c[k], triangles.v2[k] + i);
+			}
+		StoreLanes(distance + i, RayTriangle<V, V>(point, ray, a, b, c));
+		}
+	return i;
+	}
+
+void m3dRaySphereTests(float *distance, const M3DRaySoA &rays, const M3DVector3f sphereCenter, float sphereRadius, int count)
+	{
+	int i = 0;
+
+#ifdef M3D_AVX
+	i = RaySphereTestsLanes<__m256, __m256, 8>(distance, rays, sphereCenter, sphereRadius, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = RaySphereTestsLanes<__m128, __m128, 4>(distance, rays, sphereCenter, sphereRadius, count, i);
+#endif
+	RaySphereTestsLanes<float, bool, 1>(distance, rays, sphereCenter, sphereRadius, count, i);
+	}
+
+void m3dRaySphereTests(float *distance, const M3DVector3f point, const M3DVector3f ray, const M3DSphereSoA &spheres, int count)
+	{
+	int i = 0;
+
+#ifdef M3D_AVX
+	i = RaySphereTestsLanes<__m256, __m256, 8>(distance, point, ray, spheres, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = RaySphereTestsLanes<__m128, __m128, 4>(distance, point, ray, spheres, count, i);
+#endif
+	RaySphereTestsLanes<float, bool, 1>(distance, point, ray, spheres, count, i);
+	}
+
+void m3dRayTriangleTests(float *distance, const M3DRaySoA &rays, const M3DVector3f v0, const M3DVector3f v1, const M3DVector3f v2, int count)
+	{
+	int i = 0;
+
+#ifdef M3D_AVX
+	i = RayTriangleTestsSIMD<__m256, 8>(distance, rays, v0, v1, v2, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = RayTriangleTestsSIMD<__m128, 4>(distance, rays, v0, v1, v2, count, i);
+#endif
+
+	for(; i < count; i++)
+		{
+		M3DVector3f point = { rays.origin[0][i], rays.origin[1][i], rays.origin[2][i] };
+		M3DVector3f ray = { rays.direction[0][i], rays.direction[1][i], rays.direction[2][i] };
+		distance[i] = m3dRayTriangleTest(point, ray, v0, v1, v2);
+		}
+	}
+
+void m3dRayTriangleTests(float *distance, const M3DVector3f point, const M3DVector3f ray, const M3DTriangleSoA &triangles, int count)
+	{
+	int i = 0;
+
+#ifdef M3D_AVX
+	i = RayTriangleTestsSIMD<__m256, 8>(distance, point, ray, triangles, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = RayTriangleTestsSIMD<__m128, 4>(distance, point, ray, triangles, count, i);
+#endif
+
+	for(; i < count; i++)
+		{
+		M3DVector3f a = { triangles.v0[0][i], triangles.v0[1][i], triangles.v0[2][i] };
+		M3DVector3f b = { triangles.v1[0][i], triangles.v1[1][i], triangles.v1[2][i] };
+		M3DVector3f c = { triangles.v2[0][i], triangles.v2[1][i], triangles.v2[2][i] };
+		distance[i] = m3dRayTriangleTest(point, ray, a, b, c);
+		}
+	}
+
+///////////////////////////////////////////////////////////////////////////////
+// Boxes. The drivers take N lanes at a time from i on and return where they
+// stopped; with V = float and N = 1 they are also the scalar path.
+template<typename V, typename M, int N>
+static int TransformBoxesLanes(const M3DBoxSoA &dst, const M3DBoxSoA &src, const M3DMatrix44f m, int count, int i)
+	{
+	V mat[12], absMat[9];
+	for(int k = 0; k < 12; k++)
+		mat[k] = Splat<V>(m[k < 9 ? k / 3 * 4 + k % 3 : k + 3]);
+	for(int k = 0; k < 9; k++)
+		absMat[k] = Abs(mat[k]);
+
+	V half = Splat<V>(0.5);
+	for(; i + N <= count; i += N)
+		{
+		V center[3], extent[3];
+		for(int k = 0; k < 3; k++)
+			{
+			V lo, hi;
+			LoadLanes(lo, src.min[k] + i);
+			LoadLanes(hi, src.max[k] + i);
+			center[k] = Mul(Add(lo, hi), half);
+			extent[k] = Mul(Sub(hi, lo), half);
+			}
+
+		for(int r = 0; r < 3; r++)
+			{
+			V c = Add(Add(Add(Mul(mat[r], center[0]), Mul(mat[3 + r], center[1])), Mul(mat[6 + r], center[2])), mat[9 + r]);
+			V e = Add(Add(Mul(absMat[r], extent[0]), Mul(absMat[3 + r], extent[1])), Mul(absMat[6 + r], extent[2]));
+			StoreLanes(dst.min[r] + i, Sub(c, e));
+			StoreLanes(dst.max[r] + i, Add(c, e));
+			}
+		}
+	return i;
+	}
+
+template<typename V, typename M, int N>
+static int MergeBoxesLanes(const M3DBoxSoA &dst, const M3DBoxSoA &a, const M3DBoxSoA &b, int count, int i)
+	{
+	for(; i + N <= count; i += N)
+		for(int k = 0; k < 3; k++)
+			{
+			V amin, amax, bmin, bmax;
+			LoadLanes(amin, a.min[k] + i);
+			LoadLanes(amax, a.max[k] + i);
+			LoadLanes(bmin, b.min[k] + i);
+			LoadLanes(bmax, b.max[k] + i);
+			StoreLanes(dst.min[k] + i, Min(amin, bmin));
+			StoreLanes(dst.max[k] + i, Max(amax, bmax));
+			}
+	return i;
+	}
+
+template<typename V, typename M, int N>
+static int ExpandBoxesLanes(const M3DBoxSoA &dst, const M3DBoxSoA &src, float margin, int count, int i)
+	{
+	V d = Splat<V>(margin);
+	for(; i + N <= count; i += N)
+		for(int k = 0; k < 3; k++)
+			{
+			V lo, hi;
+			LoadLanes(lo, src.min[k] + i);
+			LoadLanes(hi, src.max[k] + i);
+			StoreLanes(dst.min[k] + i, Sub(lo, d));
+			StoreLanes(dst.max[k] + i, Add(hi, d));
+			}
+	return i;
+	}
+
+// Running min of the lo arrays and max of the hi arrays, folded into min
+// and max. Points pass their coordinates as both.
+template<typename V, typename M, int N>
+static int BoundsLanes(M3DVector3f min, M3DVector3f max, const float *const lo[3], const float *const hi[3], int count, int i)
+	{
+	if(i + N > count)
+		return i;
+
+	V vmin[3], vmax[3];
+	for(int k = 0; k < 3; k++)
+		{
+		vmin[k] = Splat<V>(min[k]);
+		vmax[k] = Splat<V>(max[k]);
+		}
+	for(; i + N <= count; i += N)
+		for(int k = 0; k < 3; k++)
+			{
+			V a, b;
+			LoadLanes(a, lo[k] + i);
+			LoadLanes(b, hi[k] + i);
+			vmin[k] = Min(vmin[k], a);
+			vmax[k] = Max(vmax[k], b);
+			}
+
+	for(int k = 0; k < 3; k++)
+		{
+		float a[N], b[N];
+		StoreLanes(a, vmin[k]);
+		StoreLanes(b, vmax[k]);
+		for(int j = 0; j < N; j++)
+			{
+			min[k] = Min(min[k], a[j]);
+			max[k] = Max(max[k], b[j]);
+			}
+		}
+	return i;
+	}
+
+// Write the lanes of a mask as 0/1 flags, returning how many are set
+template<int N>
+static inline int StoreFlags(unsigned char *flags, int bits)
+	{
+	int set = 0;
+	for(int j = 0; j < N; j++)
+		{
+		flags[j] = (unsigned char)((bits >> j) & 1);
+		set += flags[j];
+		}
+	return set;
+	}
+
+template<typename V, typename M, int N>
+static int BoxesOverlapBoxLanes(int &overlaps, unsigned char *overlap, const M3DBoxSoA &boxes, const M3DVector3f min, const M3DVector3f max, int count, int i)
+	{
+	V qmin[3], qmax[3];
+	for(int k = 0; k < 3; k++)
+		{
+		qmin[k] = Splat<V>(min[k]);
+		qmax[k] = Splat<V>(max[k]);
+		}
+
+	for(; i + N <= count; i += N)
+		{
+		V lo, hi;
+		LoadLanes(lo, boxes.min[0] + i);
+		LoadLanes(hi, boxes.max[0] + i);
+		M hit = And(LessEqual(qmin[0], hi), LessEqual(lo, qmax[0]));
+		for(int k = 1; k < 3; k++)
+			{
+			LoadLanes(lo, boxes.min[k] + i);
+			LoadLanes(hi, boxes.max[k] + i);
+			hit = And(hit, And(LessEqual(qmin[k], hi), LessEqual(lo, qmax[k])));
+			}
+		overlaps += StoreFlags<N>(overlap + i, MaskBits(hit));
+		}
+	return i;
+	}
+
+template<typename V, typename M, int N>
+static int BoxesOverlapSphereLanes(int &overlaps, unsigned char *overlap, const M3DBoxSoA &boxes, const M3DVector3f sphereCenter, float sphereRadius, int count, int i)
+	{
+	V center[3];
+	for(int k = 0; k < 3; k++)
+		center[k] = Splat<V>(sphereCenter[k]);
+	V zero = Splat<V>(0.0), radius2 = Splat<V>(sphereRadius * sphereRadius);
+
+	for(; i + N <= count; i += N)
+		{
+		// Squared distance from the centre to the nearest point of the box
+		V distance2 = zero;
+		for(int k = 0; k < 3; k++)
+			{
+			V lo, hi;
+			LoadLanes(lo, boxes.min[k] + i);
+			LoadLanes(hi, boxes.max[k] + i);
+			V d = Max(Max(Sub(lo, center[k]), Sub(center[k], hi)), zero);
+			distance2 = Add(distance2, Mul(d, d));
+			}
+		overlaps += StoreFlags<N>(overlap + i, MaskBits(LessEqual(distance2, radius2)));
+		}
+	return i;
+	}
+
+template<typename V, typename M, int N>
+static int ClassifyBoxesLanes(signed char *side, const M3DBoxSoA &boxes, const M3DVector4f plane, int count, int i)
+	{
+	V normal[3], absNormal[3];
+	for(int k = 0; k < 3; k++)
+		{
+		normal[k] = Splat<V>(plane[k]);
+		absNormal[k] = Abs(normal[k]);
+		}
+	V half = Splat<V>(0.5), zero = Splat<V>(0.0);
+
+	for(; i + N <= count; i += N)
+		{
+		// Signed distance of the centre against the projected radius
+		V s = Splat<V>(plane[3]), r = zero;
+		for(int k = 0; k < 3; k++)
+			{
+			V lo, hi;
+			LoadLanes(lo, boxes.min[k] + i);
+			LoadLanes(hi, boxes.max[k] + i);
+			s = Add(s, Mul(normal[k], Mul(Add(lo, hi), half)));
+			r = Add(r, Mul(absNormal[k], Mul(Sub(hi, lo), half)));
+			}
+		int front = MaskBits(Less(r, s));
+		int back = MaskBits(Less(s, Sub(zero, r)));
+		for(int j = 0; j < N; j++)
+			side[i + j] = (signed char)(((front >> j) & 1) - ((back >> j) & 1));
+		}
+	return i;
+	}
+
+template<typename V, typename M, int N>
+static int RayBoxTestsLanes(float *distance, const M3DVector3f point, const M3DVector3f ray, const M3DBoxSoA &boxes, int count, int i)
+	{
+	V origin[3], invRay[3];
+	for(int k = 0; k < 3; k++)
+		{
+		origin[k] = Splat<V>(point[k]);
+		invRay[k] = Splat<V>(1.0f / ray[k]);
+		}
+
+	// A ray parallel to a slab that starts on one of its planes gives
+	// 0 * inf = NaN there. Min and Max would return the other, infinite t
+	// and clip the lane to a miss, but the ray lies in the slab: a slab with
+	// a NaN (which fails every compare, even with itself) is skipped.
+	for(; i + N <= count; i += N)
+		{
+		V tmin = Splat<V>(0.0), tmax = Splat<V>(FLT_MAX);
+		for(int k = 0; k < 3; k++)
+			{
+			V lo, hi;
+			LoadLanes(lo, boxes.min[k] + i);
+			LoadLanes(hi, boxes.max[k] + i);
+			V t0 = Mul(Sub(lo, origin[k]), invRay[k]);
+			V t1 = Mul(Sub(hi, origin[k]), invRay[k]);
+			M clips = And(LessEqual(t0, t0), LessEqual(t1, t1));
+			tmin = Select(clips, Max(Min(t0, t1), tmin), tmin);
+			tmax = Select(clips, Min(Max(t0, t1), tmax), tmax);
+			}
+		M hit = LessEqual(tmin, tmax);
+		StoreLanes(distance + i, Select(hit, tmin, Splat<V>(-1.0)));
+		}
+	return i;
+	}
+
+// Ray against plane: t = -(n . origin + d) / (n . ray), a hit where the
+// denominator is not zero (and t is not negative for a ray). The outputs of
+// a miss are masked to zero.
+template<typename V, typename M, int N>
+static inline int RayPlane(unsigned char *hit, const M3DHitSoA &hits, const V point[3], const V ray[3],
+						   const V normal[3], V d, bool lines, int i)
+	{
+	V zero = Splat<V>(0.0);
+	V denom = Add(Add(Mul(normal[0], ray[0]), Mul(normal[1], ray[1])), Mul(normal[2], ray[2]));
+	V side = Add(Add(Add(Mul(normal[0], point[0]), Mul(normal[1], point[1])), Mul(normal[2], point[2])), d);
+	M valid = Less(zero, Abs(denom));
+	V t = Div(Sub(zero, side), Select(valid, denom, Splat<V>(1.0)));
+	if(!lines)
+		valid = And(valid, LessEqual(zero, t));
+	t = Select(valid, t, zero);
+
+	if(hits.distance != NULL)
+		StoreLanes(hits.distance + i, t);
+	for(int k = 0; k < 3; k++)
+		if(hits.point[k] != NULL)
+			StoreLanes(hits.point[k] + i, Select(valid, Add(point[k], Mul(ray[k], t)), zero));
+	return StoreFlags<N>(hit + i, MaskBits(valid));
+	}
+
+template<typename V, typename M, int N>
+static int RayPlaneTestsLanes(int &hitCount, unsigned char *hit, const M3DHitSoA &hits, const M3DRaySoA &rays,
+							  const M3DVector4f plane, bool lines, int count, int i)
+	{
+	V normal[3];
+	SplatVector(normal, plane);
+	V d = Splat<V>(plane[3]);
+	for(; i + N <= count; i += N)
+		{
+		V point[3], ray[3];
+		LoadRays(point, ray, rays, i);
+		hitCount += RayPlane<V, M, N>(hit, hits, point, ray, normal, d, lines, i);
+		}
+	return i;
+	}
+
+template<typename V, typename M, int N>
+static int RayPlaneTestsLanes(int &hitCount, unsigned char *hit, const M3DHitSoA &hits, const M3DVector3f origin,
+							  const M3DVector3f direction, const M3DPlaneSoA &planes, bool lines, int count, int i)
+	{
+	V point[3], ray[3];
+	SplatVector(point, origin);
+	SplatVector(ray, direction);
+	for(; i + N <= count; i += N)
+		{
+		V normal[3], d;
+		for(int k = 0; k < 3; k++)
+			LoadLanes(normal[k], planes.normal[k] + i);
+		if(planes.d != NULL)
+			LoadLanes(d, planes.d + i);
+		else
+			{
+			V p[3];
+			for(int k = 0; k < 3; k++)
+				LoadLanes(p[k], planes.point[k] + i);
+			d = Sub(Splat<V>(0.0), Add(Add(Mul(normal[0], p[0]), Mul(normal[1], p[1])), Mul(normal[2], p[2])));
+			}
+		hitCount += RayPlane<V, M, N>(hit, hits, point, ray, normal, d, lines, i);
+		}
+	return i;
+	}
+
+// Segments. The kernel is m3dClosestPointsOnSegments with the branches
+// turned into selects; a zero length segment a has a = b = c = 0, which
+// keeps its s at 0, and a zero length b needs its s set after the fact.
+template<typename V, typename M>
+static inline V ClosestOnSegments(V &s, V &t, const V a0[3], const V a1[3], const V b0[3], const V b1[3])
+	{
+	V da[3], db[3], r[3];
+	for(int k = 0; k < 3; k++)
+		{
+		da[k] = Sub(a1[k], a0[k]);
+		db[k] = Sub(b1[k], b0[k]);
+		r[k] = Sub(a0[k], b0[k]);
+		}
+	V a = Add(Add(Mul(da[0], da[0]), Mul(da[1], da[1])), Mul(da[2], da[2]));
+	V e = Add(Add(Mul(db[0], db[0]), Mul(db[1], db[1])), Mul(db[2], db[2]));
+	V b = Add(Add(Mul(da[0], db[0]), Mul(da[1], db[1])), Mul(da[2], db[2]));
+	V c = Add(Add(Mul(da[0], r[0]), Mul(da[1], r[1])), Mul(da[2], r[2]));
+	V f = Add(Add(Mul(db[0], r[0]), Mul(db[1], r[1])), Mul(db[2], r[2]));
+
+	V zero = Splat<V>(0.0), one = Splat<V>(1.0);
+	M hasA = Less(zero, a), hasB = Less(zero, e);
+	V safeA = Select(hasA, a, one), safeE = Select(hasB, e, one);
+	V denom = Sub(Mul(a, e), Mul(b, b));
+	M skew = Less(Mul(Splat<V>(1e-6), Mul(a, e)), denom);
+
+	s = Select(skew, Min(Max(Div(Sub(Mul(b, f), Mul(c, e)), Select(skew, denom, one)), zero), one), zero);
+	t = Div(Add(Mul(b, s), f), safeE);
+	V sLow = Min(Max(Div(Sub(zero, c), safeA), zero), one);
+	V sHigh = Min(Max(Div(Sub(b, c), safeA), zero), one);
+	s = Select(Less(t, zero), sLow, Select(Less(one, t), sHigh, s));
+	s = Select(hasB, s, sLow);
+	t = Min(Max(t, zero), one);
+
+	V distance2 = zero;
+	for(int k = 0; k < 3; k++)
+		{
+		V d = Sub(Add(a0[k], Mul(da[k], s)), Add(b0[k], Mul(db[k], t)));
+		distance2 = Add(distance2, Mul(d, d));
+		}
+	return distance2;
+	}
+
+template<typename V>
+static inline void LoadSegments(V start[3], V end[3], const M3DSegmentSoA &segments, int i)
+	{
+	for(int k = 0; k < 3; k++)
+		{
+		LoadLanes(start[k], segments.start[k] + i);
+		LoadLanes(end[k], segments.end[k] + i);
+		}
+	}
+
+template<typename V, typename M, int N>
+static int ClosestPointsOnSegmentsLanes(float *distance2, float *s, float *t, const M3DSegmentSoA &a, const M3DSegmentSoA &b, int count, int i)
+	{
+	for(; i + N <= count; i += N)
+		{
+		V a0[3], a1[3], b0[3], b1[3], sa, tb;
+		LoadSegments(a0, a1, a, i);
+		LoadSegments(b0, b1, b, i);
+		StoreLanes(distance2 + i, ClosestOnSegments<V, M>(sa, tb, a0, a1, b0, b1));
+		if(s != NULL)
+			StoreLanes(s + i, sa);
+		if(t != NULL)
+			StoreLanes(t + i, tb);
+		}
+	return i;
+	}
+
+template<typename V, typename M, int N>
+static int CapsulesOverlapLanes(int &overlaps, unsigned char *overlap, const M3DSegmentSoA &a, const float *radiusA,
+								const M3DSegmentSoA &b, const float *radiusB, int count, int i)
+	{
+	for(; i + N <= count; i += N)
+		{
+		V a0[3], a1[3], b0[3], b1[3], ra, rb, sa, tb;
+		LoadSegments(a0, a1, a, i);
+		LoadSegments(b0, b1, b, i);
+		LoadLanes(ra, radiusA + i);
+		LoadLanes(rb, radiusB + i);
+		V radius = Add(ra, rb);
+		V distance2 = ClosestOnSegments<V, M>(sa, tb, a0, a1, b0, b1);
+		overlaps += StoreFlags<N>(overlap + i, MaskBits(LessEqual(distance2, Mul(radius, radius))));
+		}
+	return i;
+	}
+
+// The sphere is a segment of zero length
+template<typename V, typename M, int N>
+static int CapsulesOverlapSpheresLanes(int &overlaps, unsigned char *overlap, const M3DSegmentSoA &capsules, const float *radius,
+									   const M3DSphereSoA &spheres, int count, int i)
+	{
+	for(; i + N <= count; i += N)
+		{
+		V a0[3], a1[3], center[3], ra, rb, sa, tb;
+		LoadSegments(a0, a1, capsules, i);
+		for(int k = 0; k < 3; k++)
+			LoadLanes(center[k], spheres.center[k] + i);
+		LoadLanes(ra, radius + i);
+		LoadLanes(rb, spheres.radius + i);
+		V r = Add(ra, rb);
+		V distance2 = ClosestOnSegments<V, M>(sa, tb, a0, a1, center, center);
+		overlaps += StoreFlags<N>(overlap + i, MaskBits(LessEqual(distance2, Mul(r, r))));
+		}
+	return i;
+	}
+
+void m3dTransformBoxes(const M3DBoxSoA &dst, const M3DBoxSoA &src, const M3DMatrix44f m, int count)
+	{
+	int i = 0;
+
+#ifdef M3D_AVX
+	i = TransformBoxesLanes<__m256, __m256, 8>(dst, src, m, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = TransformBoxesLanes<__m128, __m128, 4>(dst, src, m, count, i);
+#endif
+	TransformBoxesLanes<float, bool, 1>(dst, src, m, count, i);
+	}
+
+void m3dMergeBoxes(const M3DBoxSoA &dst, const M3DBoxSoA &a, const M3DBoxSoA &b, int count)
+	{
+	int i = 0;
+
+#ifdef M3D_AVX
+	i = MergeBoxesLanes<__m256, __m256, 8>(dst, a, b, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = MergeBoxesLanes<__m128, __m128, 4>(dst, a, b, count, i);
+#endif
+	MergeBoxesLanes<float, bool, 1>(dst, a, b, count, i);
+	}
+
+void m3dExpandBoxes(const M3DBoxSoA &dst, const M3DBoxSoA &src, float margin, int count)
+	{
+	int i = 0;
+
+#ifdef M3D_AVX
+	i = ExpandBoxesLanes<__m256, __m256, 8>(dst, src, margin, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = ExpandBoxesLanes<__m128, __m128, 4>(dst, src, margin, count, i);
+#endif
+	ExpandBoxesLanes<float, bool, 1>(dst, src, margin, count, i);
+	}
+
+static void Bounds(M3DVector3f min, M3DVector3f max, const float *const lo[3], const float *const hi[3], int count)
+	{
+	for(int k = 0; k < 3; k++)
+		{
+		min[k] = FLT_MAX;
+		max[k] = -FLT_MAX;
+		}
+
+	int i = 0;
+#ifdef M3D_AVX
+	i = BoundsLanes<__m256, __m256, 8>(min, max, lo, hi, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = BoundsLanes<__m128, __m128, 4>(min, max, lo, hi, count, i);
+#endif
+	BoundsLanes<float, bool, 1>(min, max, lo, hi, count, i);
+	}
+
+void m3dBoxBounds(M3DVector3f min, M3DVector3f max, const M3DBoxSoA &boxes, int count)
+	{
+	const float *lo[3] = { boxes.min[0], boxes.min[1], boxes.min[2] };
+	const float *hi[3] = { boxes.max[0], boxes.max[1], boxes.max[2] };
+	Bounds(min, max, lo, hi, count);
+	}
+
+void m3dPointBounds(M3DVector3f min, M3DVector3f max, const float *x, const float *y, const float *z, int count)
+	{
+	const float *p[3] = { x, y, z };
+	Bounds(min, max, p, p, count);
+	}
+
+int m3dBoxesOverlapBox(unsigned char *overlap, const M3DBoxSoA &boxes, const M3DVector3f min, const M3DVector3f max, int count)
+	{
+	int i = 0, overlaps = 0;
+
+#ifdef M3D_AVX
+	i = BoxesOverlapBoxLanes<__m256, __m256, 8>(overlaps, overlap, boxes, min, max, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = BoxesOverlapBoxLanes<__m128, __m128, 4>(overlaps, overlap, boxes, min, max, count, i);
+#endif
+	BoxesOverlapBoxLanes<float, bool, 1>(overlaps, overlap, boxes, min, max, count, i);
+	return overlaps;
+	}
+
+int m3dBoxesOverlapSphere(unsigned char *overlap, const M3DBoxSoA &boxes, const M3DVector3f sphereCenter, float sphereRadius, int count)
+	{
+	int i = 0, overlaps = 0;
+
+#ifdef M3D_AVX
+	i = BoxesOverlapSphereLanes<__m256, __m256, 8>(overlaps, overlap, boxes, sphereCenter, sphereRadius, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = BoxesOverlapSphereLanes<__m128, __m128, 4>(overlaps, overlap, boxes, sphereCenter, sphereRadius, count, i);
+#endif
+	BoxesOverlapSphereLanes<float, bool, 1>(overlaps, overlap, boxes, sphereCenter, sphereRadius, count, i);
+	return overlaps;
+	}
+
+void m3dClassifyBoxes(signed char *side, const M3DBoxSoA &boxes, const M3DVector4f plane, int count)
+	{
+	int i = 0;
+
+#ifdef M3D_AVX
+	i = ClassifyBoxesLanes<__m256, __m256, 8>(side, boxes, plane, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = ClassifyBoxesLanes<__m128, __m128, 4>(side, boxes, plane, count, i);
+#endif
+	ClassifyBoxesLanes<float, bool, 1>(side, boxes, plane, count, i);
+	}
+
+void m3dRayBoxTests(float *distance, const M3DVector3f point, const M3DVector3f ray, const M3DBoxSoA &boxes, int count)
+	{
+	int i = 0;
+
+#ifdef M3D_AVX
+	i = RayBoxTestsLanes<__m256, __m256, 8>(distance, point, ray, boxes, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = RayBoxTestsLanes<__m128, __m128, 4>(distance, point, ray, boxes, count, i);
+#endif
+	RayBoxTestsLanes<float, bool, 1>(distance, point, ray, boxes, count, i);
+	}
+
+void m3dClosestPointsOnSegments(float *distance2, float *s, float *t, const M3DSegmentSoA &a, const M3DSegmentSoA &b, int count)
+	{
+	int i = 0;
+
+#ifdef M3D_AVX
+	i = ClosestPointsOnSegmentsLanes<__m256, __m256, 8>(distance2, s, t, a, b, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = ClosestPointsOnSegmentsLanes<__m128, __m128, 4>(distance2, s, t, a, b, count, i);
+#endif
+	ClosestPointsOnSegmentsLanes<float, bool, 1>(distance2, s, t, a, b, count, i);
+	}
+
+int m3dCapsulesOverlap(unsigned char *overlap, const M3DSegmentSoA &a, const float *radiusA,
+					   const M3DSegmentSoA &b, const float *radiusB, int count)
+	{
+	int i = 0, overlaps = 0;
+
+#ifdef M3D_AVX
+	i = CapsulesOverlapLanes<__m256, __m256, 8>(overlaps, overlap, a, radiusA, b, radiusB, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = CapsulesOverlapLanes<__m128, __m128, 4>(overlaps, overlap, a, radiusA, b, radiusB, count, i);
+#endif
+	CapsulesOverlapLanes<float, bool, 1>(overlaps, overlap, a, radiusA, b, radiusB, count, i);
+	return overlaps;
+	}
+
+int m3dCapsulesOverlapSpheres(unsigned char *overlap, const M3DSegmentSoA &capsules, const float *radius,
+							  const M3DSphereSoA &spheres, int count)
+	{
+	int i = 0, overlaps = 0;
+
+#ifdef M3D_AVX
+	i = CapsulesOverlapSpheresLanes<__m256, __m256, 8>(overlaps, overlap, capsules, radius, spheres, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = CapsulesOverlapSpheresLanes<__m128, __m128, 4>(overlaps, overlap, capsules, radius, spheres, count, i);
+#endif
+	CapsulesOverlapSpheresLanes<float, bool, 1>(overlaps, overlap, capsules, radius, spheres, count, i);
+	return overlaps;
+	}
+
+int m3dRayPlaneTests(unsigned char *hit, const M3DHitSoA &hits, const M3DRaySoA &rays, const M3DVector4f plane, bool lines, int count)
+	{
+	int i = 0, hitCount = 0;
+
+#ifdef M3D_AVX
+	i = RayPlaneTestsLanes<__m256, __m256, 8>(hitCount, hit, hits, rays, plane, lines, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = RayPlaneTestsLanes<__m128, __m128, 4>(hitCount, hit, hits, rays, plane, lines, count, i);
+#endif
+	RayPlaneTestsLanes<float, bool, 1>(hitCount, hit, hits, rays, plane, lines, count, i);
+	return hitCount;
+	}
+
+int m3dRayPlaneTests(unsigned char *hit, const M3DHitSoA &hits, const M3DRaySoA &rays, const M3DVector3f planePoint,
+					 const M3DVector3f planeNormal, bool lines, int count)
+	{
+	M3DVector4f plane = { planeNormal[0], planeNormal[1], planeNormal[2], -m3dDotProduct(planeNormal, planePoint) };
+	return m3dRayPlaneTests(hit, hits, rays, plane, lines, count);
+	}
+
+int m3dRayPlaneTests(unsigned char *hit, const M3DHitSoA &hits, const M3DVector3f point, const M3DVector3f ray,
+					 const M3DPlaneSoA &planes, bool lines, int count)
+	{
+	int i = 0, hitCount = 0;
+
+#ifdef M3D_AVX
+	i = RayPlaneTestsLanes<__m256, __m256, 8>(hitCount, hit, hits, point, ray, planes, lines, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = RayPlaneTestsLanes<__m128, __m128, 4>(hitCount, hit, hits, point, ray, planes, lines, count, i);
+#endif
+	RayPlaneTestsLanes<float, bool, 1>(hitCount, hit, hits, point, ray, planes, lines, count, i);
+	return hitCount;
+	}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Triangle normals and angles
+
+template<typename V>
+static inline void LoadTriangle(V v0[3], V v1[3], V v2[3], const M3DTriangleSoA &triangles, int i)
+	{
+	for(int k = 0; k < 3; k++)
+		{
+		LoadLanes(v0[k], triangles.v0[k] + i);
+		LoadLanes(v1[k], triangles.v1[k] + i);
+		LoadLanes(v2[k], triangles.v2[k] + i);
+		}
+	}
+
+template<typename V>
+static inline void Cross(V n[3], const V a[3], const V b[3])
+	{
+	n[0] = Sub(Mul(a[1], b[2]), Mul(a[2], b[1]));
+	n[1] = Sub(Mul(a[2], b[0]), Mul(a[0], b[2]));
+	n[2] = Sub(Mul(a[0], b[1]), Mul(a[1], b[0]));
+	}
+
+template<typename V>
+static inline V Dot(const V a[3], const V b[3])
+	{
+	return Add(Add(Mul(a[0], b[0]), Mul(a[1], b[1])), Mul(a[2], b[2]));
+	}
+
+// atan2(y, x) for y >= 0. The ratio of the smaller to the larger of |x|
+// and y is reduced and fed to the polynomial of AtanPositive4.
+template<typename V, typename M>
+static inline V Atan2Positive(V y, V x)
+	{
+	V ax = Abs(x);
+	M steep = Less(ax, y);
+	V t = Div(Min(ax, y), Max(Max(ax, y), Splat<V>(FLT_MIN)));
+	M mid = Less(Splat<V>(0.4142135623730950), t);
+	V one = Splat<V>(1.0);
+	t = Select(mid, Div(Sub(t, one), Add(t, one)), t);
+
+	V z = Mul(t, t);
+	V p = Splat<V>(8.05374449538e-2);
+	p = Add(Mul(p, z), Splat<V>(-1.38776856032e-1));
+	p = Add(Mul(p, z), Splat<V>(1.99777106478e-1));
+	p = Add(Mul(p, z), Splat<V>(-3.33329491539e-1));
+	V a = Add(Add(Mul(Mul(p, z), t), t), Select(mid, Splat<V>(0.7853981633974483), Splat<V>(0.0)));
+	a = Select(steep, Sub(Splat<V>(1.570796326794897), a), a);
+	return Select(Less(x, Splat<V>(0.0)), Sub(Splat<V>(3.141592653589793), a), a);
+	}
+
+template<typename V, int N>
+static int FindNormalsLanes(float *x, float *y, float *z, const M3DTriangleSoA &triangles, int count, int i)
+	{
+	for(; i + N <= count; i += N)
+		{
+		V v0[3], v1[3], v2[3], e1[3], e2[3], n[3];
+		LoadTriangle(v0, v1, v2, triangles, i);
+		for(int k = 0; k < 3; k++)
+			{
+			e1[k] = Sub(v1[k], v0[k]);
+			e2[k] = Sub(v2[k], v0[k]);
+			}
+		Cross(n, e1, e2);
+		StoreLanes(x + i, n[0]);
+		StoreLanes(y + i, n[1]);
+		StoreLanes(z + i, n[2]);
+		}
+	return i;
+	}
+
+// Any two edges leaving a corner have the same cross product up to sign,
+// the normal, so only the dot products differ between the corners
+template<typename V, typename M, int N>
+static int TriangleAnglesLanes(float *angle0, float *angle1, float *angle2, const M3DTriangleSoA &triangles, int count, int i)
+	{
+	for(; i + N <= count; i += N)
+		{
+		V v0[3], v1[3], v2[3], e0[3], e1[3], e2[3], n[3];
+		LoadTriangle(v0, v1, v2, triangles, i);
+		for(int k = 0; k < 3; k++)
+			{
+			e0[k] = Sub(v1[k], v0[k]);
+			e1[k] = Sub(v2[k], v1[k]);
+			e2[k] = Sub(v0[k], v2[k]);
+			}
+		Cross(n, e0, e1);
+		V area = Sqrt(Dot(n, n)), zero = Splat<V>(0.0);
+		StoreLanes(angle0 + i, Atan2Positive<V, M>(area, Sub(zero, Dot(e0, e2))));
+		StoreLanes(angle1 + i, Atan2Positive<V, M>(area, Sub(zero, Dot(e1, e0))));
+		StoreLanes(angle2 + i, Atan2Positive<V, M>(area, Sub(zero, Dot(e2, e1))));
+		}
+	return i;
+	}
+
+template<typename V, typename M, int N>
+static int NormalizeVectorsLanes(float *x, float *y, float *z, int count, int i)
+	{
+	for(; i + N <= count; i += N)
+		{
+		V v[3];
+		LoadLanes(v[0], x + i);
+		LoadLanes(v[1], y + i);
+		LoadLanes(v[2], z + i);
+		V length2 = Dot(v, v), zero = Splat<V>(0.0);
+		V scale = Select(Less(zero, length2), Div(Splat<V>(1.0), Sqrt(length2)), zero);
+		StoreLanes(x + i, Mul(v[0], scale));
+		StoreLanes(y + i, Mul(v[1], scale));
+		StoreLanes(z + i, Mul(v[2], scale));
+		}
+	return i;
+	}
+
+void m3dFindNormals(float *x, float *y, float *z, const M3DTriangleSoA &triangles, int count)
+	{
+	int i = 0;
+
+#ifdef M3D_AVX
+	i = FindNormalsLanes<__m256, 8>(x, y, z, triangles, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = FindNormalsLanes<__m128, 4>(x, y, z, triangles, count, i);
+#endif
+	FindNormalsLanes<float, 1>(x, y, z, triangles, count, i);
+	}
+
+void m3dTriangleAngles(float *angle0, float *angle1, float *angle2, const M3DTriangleSoA &triangles, int count)
+	{
+	int i = 0;
+
+#ifdef M3D_AVX
+	i = TriangleAnglesLanes<__m256, __m256, 8>(angle0, angle1, angle2, triangles, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = TriangleAnglesLanes<__m128, __m128, 4>(angle0, angle1, angle2, triangles, count, i);
+#endif
+	TriangleAnglesLanes<float, bool, 1>(angle0, angle1, angle2, triangles, count, i);
+	}
+
+void m3dNormalizeVectors(float *x, float *y, float *z, int count)
+	{
+	int i = 0;
+
+#ifdef M3D_AVX
+	i = NormalizeVectorsLanes<__m256, __m256, 8>(x, y, z, count, i);
+#endif
+#ifdef M3D_SSE2
+	i = NormalizeVectorsLanes<__m128, __m128, 4>(x, y, z, count, i);
+#endif
+	NormalizeVectorsLanes<float, bool, 1>(x, y, z, count, i);
+	}
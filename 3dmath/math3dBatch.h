@@ -0,0 +1,290 @@
+// math3dBatch.h
+// Batch versions of the Math3d routines. Where math3d.h works on one vector or
+// matrix per call, these work on whole arrays at once. Inputs are laid out as
+// structure-of-arrays (one float array per component) so that the kernels can
+// process four or eight elements per SIMD register.
+#ifndef _MATH3D_BATCH_LIBRARY__
+#define _MATH3D_BATCH_LIBRARY__
+
+#include "math3d.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// SIMD support. SSE2 is used wherever the compiler targets it (always on x64),
+// AVX/AVX2 only when enabled on the command line (-mavx2, /arch:AVX2).
+// Every kernel also has a plain C++ path that produces the same results.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define M3D_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX__)
+#define M3D_AVX
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define M3D_AVX2
+#endif
+
+// Outputs larger than this many bytes are written with non-temporal stores
+// so that they don't evict the working set of the caller.
+#define M3D_STREAM_THRESHOLD	(256 * 1024)
+
+
+///////////////////////////////////////////////////////////////////////////////
+// 3x4 affine matrix - row major. The last row of the 4x4 (0, 0, 0, 1) is
+// implied. Each row is one float4, which is the layout shaders expect for
+// bone palettes.
+//	0	1	2	3
+//	4	5	6	7
+//	8	9	10	11
+typedef float M3DMatrix34f[12];
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Translation, rotation and scale streams, one array per component.
+// Rotations are unit quaternions in (x, y, z, w) order, the same as
+// m3dQuaternionMatrix. The scale arrays may be NULL for unit scale.
+struct M3DTransformSoA
+	{
+	float *tx, *ty, *tz;			// Translation
+	float *qx, *qy, *qz, *qw;		// Rotation
+	float *sx, *sy, *sz;			// Scale
+	};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Build a palette of count matrices, palette[i] = T * R * S. The rotation
+// block matches m3dQuaternionMatrix, so the result is the same as
+// TranslationMatrix(t) * RotationMatrix(q) * ScaleMatrix(s).
+// Large palettes (see M3D_STREAM_THRESHOLD) are streamed past the cache if the
+// palette is 16 byte aligned.
+void m3dComposeMatrices44(M3DMatrix44f *palette, const M3DTransformSoA &trs, int count);
+void m3dComposeMatrices34(M3DMatrix34f *palette, const M3DTransformSoA &trs, int count);
+
+///////////////////////////////////////////////////////////////////////////////
+// Extract the rotation of count matrices as (x, y, z, w) quaternions, the
+// same result as calling m3dMatToQuat on each. The SIMD path evaluates all
+// four cases of m3dMatToQuat and blends them instead of branching.
+void m3dMatToQuats(float q[][4], const M3DMatrix44f *m, int count);
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Sine and cosine of count angles (radians) in one pass. Accurate to a few
+// ulp for |angle| < 8192.
+void m3dSinCos(float *s, float *c, const float *angles, int count);
+
+///////////////////////////////////////////////////////////////////////////////
+// Euler angle rotation orders. The name lists the axes in the order the
+// rotations are applied, so M3D_EULER_XYZ rotates about X first and about Z
+// last. M3D_EULER_XYZ is the convention of Quaternion::FromEuler and
+// m3dRotationMatrix44(m, angles).
+enum M3DEulerOrder
+	{
+	M3D_EULER_XYZ,
+	M3D_EULER_XZY,
+	M3D_EULER_YXZ,
+	M3D_EULER_YZX,
+	M3D_EULER_ZXY,
+	M3D_EULER_ZYX
+	};
+
+// Euler angles are passed as three arrays holding the rotation about the X, Y
+// and Z axis (radians), whatever the order. Quaternions are (x, y, z, w)
+// arrays and matrices follow m3dQuaternionMatrix. Going back to Euler angles
+// returns the middle angle in [-pi/2, pi/2]; at gimbal lock the last angle is
+// set to zero.
+void m3dEulerToQuats(float *qx, float *qy, float *qz, float *qw, const float *ex, const float *ey, const float *ez, M3DEulerOrder order, int count);
+void m3dEulerToMatrices44(M3DMatrix44f *m, const float *ex, const float *ey, const float *ez, M3DEulerOrder order, int count);
+void m3dQuatsToEuler(float *ex, float *ey, float *ez, const float *qx, const float *qy, const float *qz, const float *qw, M3DEulerOrder order, int count);
+void m3dMatricesToEuler(float *ex, float *ey, float *ez, const M3DMatrix44f *m, M3DEulerOrder order, int count);
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Rotate arrays of points by a quaternion (x, y, z, w). This is the rotation
+// Quaternion::RotateVector applies (q * v * q^-1), which is the transpose of
+// what m3dQuaternionMatrix builds. Input and output arrays may be the same.
+// One quaternion for all points, SoA and AoS layouts
+void m3dRotateVectors(float *outX, float *outY, float *outZ, const float *x, const float *y, const float *z, const float q[4], int count);
+void m3dRotateVectors(M3DVector3f *out, const M3DVector3f *in, const float q[4], int count);
+
+// One quaternion per point
+void m3dRotateVectorsByQuats(float *outX, float *outY, float *outZ, const float *x, const float *y, const float *z,
+							 const float *qx, const float *qy, const float *qz, const float *qw, int count);
+void m3dRotateVectorsByQuats(M3DVector3f *out, const M3DVector3f *in, const float q[][4], int count);
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Decompose count affine matrices into translation, rotation and scale
+// streams with m3dDecomposeMatrix44. The scale arrays may be NULL.
+void m3dDecomposeMatrices44(const M3DTransformSoA &trs, const M3DMatrix44f *m, int count);
+
+// dst = a + (b - a) * t[i] per element: translation and scale are lerped,
+// rotation slerped along the shorter arc and renormalized. Scale is skipped
+// if dst.sx is NULL, otherwise a and b must have scale too. dst may be a or b.
+// Feed the result to m3dComposeMatrices44 to get blended matrices.
+void m3dInterpolateTRS(const M3DTransformSoA &dst, const M3DTransformSoA &a, const M3DTransformSoA &b, const float *t, int count);
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Normal matrices: dst[i] is the inverse transpose of the upper 3x3 of
+// src[i], for transforming normals by matrices with non-uniform scale. The
+// cofactors are divided by the determinant without a check, so a singular
+// block gives non-finite entries.
+void m3dNormalMatrices(M3DMatrix33f *dst, const M3DMatrix44f *src, int count);
+
+///////////////////////////////////////////////////////////////////////////////
+// m3dSVD33 on count matrices, eight or four at a time in SIMD registers. The
+// polar decomposition a = r * s is taken from the SVD: r = u * v^T is the
+// closest rotation even for a singular or mirroring a, s = r^T * a. s may
+// be NULL.
+void m3dSVDMatrices33(M3DMatrix33f *u, M3DVector3f *sigma, M3DMatrix33f *v, const M3DMatrix33f *a, int count);
+void m3dPolarDecomposeMatrices33(M3DMatrix33f *r, M3DMatrix33f *s, const M3DMatrix33f *a, int count);
+
+// m3dEigenSymmetric33 on count matrices, eight or four at a time
+void m3dEigenSymmetricMatrices33(M3DMatrix33f *vectors, M3DVector3f *values, const M3DMatrix33f *s, int count);
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Ray packets and primitive streams, one array per component. Rays are
+// origin + t * direction; the directions need not be unit length.
+struct M3DRaySoA
+	{
+	const float *origin[3];
+	const float *direction[3];
+	};
+
+struct M3DSphereSoA
+	{
+	const float *center[3];
+	const float *radius;
+	};
+
+struct M3DTriangleSoA
+	{
+	const float *v0[3], *v1[3], *v2[3];
+	};
+
+// m3dRaySphereTest and m3dRayTriangleTest on many rays against one primitive,
+// or on one ray against many primitives, with the same return convention:
+// distance[i] < 0 for a miss, otherwise the distance along the ray in units
+// of its length. The sphere tests, unlike m3dRaySphereTest, do not need unit
+// directions. Lanes are processed eight (AVX) or four (SSE) at a time, so a
+// 16 ray packet is two AVX iterations; the rest one at a time.
+void m3dRaySphereTests(float *distance, const M3DRaySoA &rays, const M3DVector3f sphereCenter, float sphereRadius, int count);
+void m3dRaySphereTests(float *distance, const M3DVector3f point, const M3DVector3f ray, const M3DSphereSoA &spheres, int count);
+void m3dRayTriangleTests(float *distance, const M3DRaySoA &rays, const M3DVector3f v0, const M3DVector3f v1, const M3DVector3f v2, int count);
+void m3dRayTriangleTests(float *distance, const M3DVector3f point, const M3DVector3f ray, const M3DTriangleSoA &triangles, int count);
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Axis aligned boxes, one array per component (see AABB in BoundingBox.h)
+struct M3DBoxSoA
+	{
+	float *min[3];
+	float *max[3];
+	};
+
+// Bounds of count boxes after the affine matrix m, in the center/extent form
+// of Arvo's method: center' = m * center, extent' = |m| * extent. dst may be
+// src. The boxes must not be empty.
+void m3dTransformBoxes(const M3DBoxSoA &dst, const M3DBoxSoA &src, const M3DMatrix44f m, int count);
+
+// dst[i] = union of a[i] and b[i], as when refitting a level of a BVH.
+// dst may be a or b.
+void m3dMergeBoxes(const M3DBoxSoA &dst, const M3DBoxSoA &a, const M3DBoxSoA &b, int count);
+
+// Grow every box by margin on each side, e.g. the fat boxes of a broad phase.
+// dst may be src.
+void m3dExpandBoxes(const M3DBoxSoA &dst, const M3DBoxSoA &src, float margin, int count);
+
+// Union of count boxes, bounds of count points. Empty (min = FLT_MAX,
+// max = -FLT_MAX) for count 0.
+void m3dBoxBounds(M3DVector3f min, M3DVector3f max, const M3DBoxSoA &boxes, int count);
+void m3dPointBounds(M3DVector3f min, M3DVector3f max, const float *x, const float *y, const float *z, int count);
+
+// count boxes against one query box or sphere. overlap[i] is 1 where they
+// touch or overlap, otherwise 0; returns the number of overlaps.
+int m3dBoxesOverlapBox(unsigned char *overlap, const M3DBoxSoA &boxes, const M3DVector3f min, const M3DVector3f max, int count);
+int m3dBoxesOverlapSphere(unsigned char *overlap, const M3DBoxSoA &boxes, const M3DVector3f sphereCenter, float sphereRadius, int count);
+
+// side[i] is 1 for a box entirely in front of the plane, -1 for one entirely
+// behind it and 0 where the plane cuts it. The plane is in the form of
+// m3dGetPlaneEquation.
+void m3dClassifyBoxes(signed char *side, const M3DBoxSoA &boxes, const M3DVector4f plane, int count);
+
+// Slab test of one ray against count boxes. Same convention as
+// m3dRaySphereTests: distance[i] < 0 for a miss, otherwise where the ray
+// enters the box (0 if it starts inside).
+void m3dRayBoxTests(float *distance, const M3DVector3f point, const M3DVector3f ray, const M3DBoxSoA &boxes, int count);
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Segments, one array per component. A capsule is a segment and a radius.
+struct M3DSegmentSoA
+	{
+	const float *start[3];
+	const float *end[3];
+	};
+
+// m3dClosestPointsOnSegments on the pairs a[i], b[i]: distance2[i] is their
+// squared distance, s[i] and t[i] the positions of the closest points along
+// each, 0 at the start to 1 at the end. s and t may be NULL.
+void m3dClosestPointsOnSegments(float *distance2, float *s, float *t, const M3DSegmentSoA &a, const M3DSegmentSoA &b, int count);
+
+// Capsule a[i] against capsule b[i], capsule i against sphere i. overlap[i]
+// is 1 where they touch or overlap, otherwise 0; returns the number of
+// overlaps.
+int m3dCapsulesOverlap(unsigned char *overlap, const M3DSegmentSoA &a, const float *radiusA,
+					   const M3DSegmentSoA &b, const float *radiusB, int count);
+int m3dCapsulesOverlapSpheres(unsigned char *overlap, const M3DSegmentSoA &capsules, const float *radius,
+							  const M3DSphereSoA &spheres, int count);
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Planes, one array per component. They are normal . x + d = 0, the form of
+// m3dGetPlaneEquation, if d is set; if d is NULL they are given by a point on
+// them and the normal instead. Normals need not be unit length.
+struct M3DPlaneSoA
+	{
+	const float *normal[3];
+	const float *point[3];
+	const float *d;
+	};
+
+// Where intersections go: the distance along the ray in units of its
+// direction, and the point. Any of the arrays may be NULL.
+struct M3DHitSoA
+	{
+	float *distance;
+	float *point[3];
+	};
+
+// Many rays against one plane, or one ray against many planes. hit[i] is 1
+// where ray i meets the plane, otherwise 0, and the outputs of a miss are 0;
+// returns the number of hits. Rays parallel to the plane never hit, not even
+// those lying in it. With lines set the rays extend both ways, so a hit may
+// be at a negative distance.
+int m3dRayPlaneTests(unsigned char *hit, const M3DHitSoA &hits, const M3DRaySoA &rays, const M3DVector4f plane, bool lines, int count);
+int m3dRayPlaneTests(unsigned char *hit, const M3DHitSoA &hits, const M3DRaySoA &rays, const M3DVector3f planePoint,
+					 const M3DVector3f planeNormal, bool lines, int count);
+int m3dRayPlaneTests(unsigned char *hit, const M3DHitSoA &hits, const M3DVector3f point, const M3DVector3f ray,
+					 const M3DPlaneSoA &planes, bool lines, int count);
+
+
+///////////////////////////////////////////////////////////////////////////////
+// m3dFindNormal on count triangles. The normals are not normalized: each is
+// (v1 - v0) x (v2 - v0), twice the area of the triangle long, which is what
+// area weighted vertex normals sum.
+void m3dFindNormals(float *x, float *y, float *z, const M3DTriangleSoA &triangles, int count);
+
+// Interior angle of each triangle at v0, v1 and v2, in radians. They come
+// from atan2 of the cross and dot products of the edges, which unlike acos
+// stays accurate for needle triangles. A degenerate triangle has angles of
+// 0 or pi.
+void m3dTriangleAngles(float *angle0, float *angle1, float *angle2, const M3DTriangleSoA &triangles, int count);
+
+// m3dNormalizeVector on count vectors in place. Zero vectors stay zero.
+void m3dNormalizeVectors(float *x, float *y, float *z, int count);
+
+#endif
@@ -0,0 +1,109 @@
+// Convex distance queries between boxes, capsules and 32 point hulls at
+// random poses, about a third of them overlapping. Per pair cost in ns, cold
+// (empty caches) and warm (caches from the frame before, poses nudged),
+// one query at a time and through ConvexDistances.
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "Convex.h"
+#include "TestCommon.h"
+
+static ConvexShape RandomShape(int kind, const std::vector<CVector> &hull)
+{
+	switch (kind % 3)
+	{
+	case 0:
+		return ConvexShape::Box(CVector(0.5f + 0.25f * Random(), 0.5f + 0.25f * Random(), 0.5f + 0.25f * Random()));
+	case 1:
+		return ConvexShape::Capsule(0.3f + 0.1f * Random(), 0.5f + 0.25f * Random());
+	default:
+		return ConvexShape::Hull(&hull[0], int(hull.size()));
+	}
+}
+
+static void Pose(ConvexShape &shape, const CVector &position)
+{
+	Quaternion q;
+	CVector axis(Random(), Random(), Random());
+	if (axis % axis < 0.01f)
+		axis = CVector(0, 0, 1);
+	q.SetToRotateAboutAxis(axis.UnitVector(), 3.14159265f * Random());
+	shape.SetTransform(position, q);
+}
+
+// Moves every B a little, as one frame of a simulation would
+static void Nudge(std::vector<ConvexShape> &b)
+{
+	for (size_t i = 0; i < b.size(); i++)
+		b[i].position += CVector(Random(), Random(), Random()) * 0.01f;
+}
+
+static void Bench(int count, int runs, const std::vector<CVector> &hull)
+{
+	std::vector<ConvexShape> a, b;
+	for (int i = 0; i < count; i++)
+	{
+		a.push_back(RandomShape(i, hull));
+		b.push_back(RandomShape(i / 3, hull));
+		Pose(a[i], CVector(0, 0, 0));
+		// Centres 0.5 to 2.5 apart: deep, touching and clear of each other
+		CVector offset(Random(), Random(), Random());
+		if (offset % offset < 0.01f)
+			offset = CVector(1, 0, 0);
+		Pose(b[i], offset.UnitVector() * (1.5f + Random()));
+	}
+	std::vector<ConvexResult> results(count);
+	std::vector<ConvexCache> caches(count);
+
+	double single[2] = {0.0, 0.0}, batch[2] = {0.0, 0.0};
+	int overlapping = 0;
+	for (int r = 0; r < runs; r++)
+	{
+		// Cold: every cache emptied first
+		for (int i = 0; i < count; i++)
+			caches[i].count = 0;
+		double start = Seconds();
+		for (int i = 0; i < count; i++)
+			ConvexDistance(results[i], a[i], b[i], &caches[i]);
+		single[0] += Seconds() - start;
+
+		// Warm: the caches of the frame before
+		Nudge(b);
+		start = Seconds();
+		for (int i = 0; i < count; i++)
+			ConvexDistance(results[i], a[i], b[i], &caches[i]);
+		single[1] += Seconds() - start;
+
+		for (int i = 0; i < count; i++)
+			caches[i].count = 0;
+		start = Seconds();
+		ConvexDistances(&results[0], &a[0], &b[0], &caches[0], count);
+		batch[0] += Seconds() - start;
+
+		Nudge(b);
+		start = Seconds();
+		ConvexDistances(&results[0], &a[0], &b[0], &caches[0], count);
+		batch[1] += Seconds() - start;
+	}
+	for (int i = 0; i < count; i++)
+		overlapping += results[i].distance < 0.0f;
+
+	double scale = 1e9 / (double(runs) * count);
+	printf("%6d pairs  %5d overlapping  single %6.1f cold %6.1f warm ns/pair  batch %6.1f cold %6.1f warm ns/pair\n",
+		   count, overlapping, single[0] * scale, single[1] * scale, batch[0] * scale, batch[1] * scale);
+}
+
+int main()
+{
+	srand(1);
+	std::vector<CVector> hull;
+	while (hull.size() < 32)
+	{
+		CVector p(Random(), Random(), Random());
+		if (p % p > 0.01f && p % p <= 1.0f)
+			hull.push_back(p.UnitVector() * 0.6f);
+	}
+	for (int count = 1024; count <= 65536; count *= 4)
+		Bench(count, 10, hull);
+	return 0;
+}
@@ -0,0 +1,49 @@
+// Convex hulls of 1M point clouds: uniform in a cube, in a ball, and near a
+// sphere, where most points end up close to the hull. Best of three builds.
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "ConvexHull.h"
+#include "TestCommon.h"
+
+static void Bench(const char *cloud, const std::vector<CVector> &points)
+{
+	ConvexHull hull;
+	double best = 1e30;
+	for (int run = 0; run < 3; run++)
+	{
+		double start = Seconds();
+		hull.Build(&points[0], int(points.size()));
+		double seconds = Seconds() - start;
+		best = seconds < best ? seconds : best;
+	}
+	printf("%-6s %8d points  %8.1f ms  %6d vertices  %6d triangles\n", cloud, int(points.size()), best * 1000.0,
+		   hull.GetVertexCount(), hull.GetTriangleCount());
+}
+
+int main()
+{
+	const int count = 1000000;
+	std::vector<CVector> cube, ball, shell;
+	srand(1);
+	while (int(cube.size()) < count)
+		cube.push_back(CVector(Random(), Random(), Random()));
+	while (int(ball.size()) < count)
+	{
+		CVector p(Random(), Random(), Random());
+		if (p % p <= 1.0f)
+			ball.push_back(p);
+	}
+	// Within 0.1% of the unit sphere
+	while (int(shell.size()) < count)
+	{
+		CVector p(Random(), Random(), Random());
+		if (p % p > 0.01f && p % p <= 1.0f)
+			shell.push_back(p.UnitVector() * (1.0f - 0.001f * (Random() + 1.0f) * 0.5f));
+	}
+
+	Bench("cube", cube);
+	Bench("ball", ball);
+	Bench("shell", shell);
+	return 0;
+}
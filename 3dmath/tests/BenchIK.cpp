@@ -0,0 +1,87 @@
+// IK batches of 1k to 64k chains: two bone limbs and eight joint FABRIK and
+// CCD chains, in milliseconds per batch.
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "IK.h"
+#include "TestCommon.h"
+
+static void BenchTwoBone(int count, int runs)
+{
+	std::vector<float> data(23 * size_t(count));
+	float *p = &data[0];
+	IKTwoBoneSoA chains;
+	for (int k = 0; k < 3; k++)
+	{
+		chains.root[k] = p + (0 + k) * size_t(count);
+		chains.mid[k] = p + (3 + k) * size_t(count);
+		chains.end[k] = p + (6 + k) * size_t(count);
+		chains.target[k] = p + (9 + k) * size_t(count);
+		chains.pole[k] = p + (12 + k) * size_t(count);
+	}
+	for (int k = 0; k < 4; k++)
+	{
+		chains.rootDelta[k] = p + (15 + k) * size_t(count);
+		chains.midDelta[k] = p + (19 + k) * size_t(count);
+	}
+	for (size_t i = 0; i < 15 * size_t(count); i++)
+		p[i] = Random();
+
+	int reached = 0;
+	double start = Seconds();
+	for (int r = 0; r < runs; r++)
+		reached = SolveTwoBoneIK(chains, count);
+	double ms = (Seconds() - start) * 1000.0 / runs;
+	printf("two bone  %6d chains  %8.3f ms  %5.1f ns/chain  %d reached\n", count, ms, ms * 1e6 / count, reached);
+}
+
+static void BenchChains(const char *name, int (*solve)(const IKChainSoA &, const IKChainSettings &), int count, int runs)
+{
+	const int joints = 8;
+	std::vector<float> start(3 * joints * size_t(count)), joint(start.size()), target(3 * size_t(count));
+	// Zig-zag chains along x, targets within reach
+	for (int j = 0; j < joints; j++)
+		for (int c = 0; c < count; c++)
+		{
+			size_t index = size_t(j) * count + c;
+			start[index] = float(j);
+			start[joints * size_t(count) + index] = (j & 1) ? 0.2f : 0.0f;
+			start[2 * joints * size_t(count) + index] = 0.1f * Random();
+		}
+	for (size_t i = 0; i < target.size(); i++)
+		target[i] = 3.0f * Random();
+
+	IKChainSoA chains;
+	for (int k = 0; k < 3; k++)
+	{
+		chains.joint[k] = &joint[k * joints * size_t(count)];
+		chains.target[k] = &target[k * size_t(count)];
+	}
+	chains.joints = joints;
+	chains.chains = count;
+	IKChainSettings settings = {16, 1e-3f, NULL};
+
+	int reached = 0;
+	double seconds = 0.0;
+	for (int r = 0; r < runs; r++)
+	{
+		joint = start;
+		double t = Seconds();
+		reached = solve(chains, settings);
+		seconds += Seconds() - t;
+	}
+	double ms = seconds * 1000.0 / runs;
+	printf("%-8s  %6d chains  %8.3f ms  %5.1f ns/chain  %d reached\n", name, count, ms, ms * 1e6 / count, reached);
+}
+
+int main()
+{
+	srand(1);
+	for (int count = 1024; count <= 65536; count *= 4)
+	{
+		BenchTwoBone(count, 20);
+		BenchChains("FABRIK", SolveFABRIK, count, 10);
+		BenchChains("CCD", SolveCCD, count, 10);
+	}
+	return 0;
+}
@@ -0,0 +1,95 @@
+// BVH ray casts: packets must agree with single rays, including rays along
+// an axis that start on the planes of the node boxes.
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include "BVH.h"
+#include "TestCommon.h"
+
+// A terrain of unit squares over an integer grid, heights on integers too,
+// so node boxes have their planes on the integer coordinates
+static void BuildTerrain(std::vector<CVector> &vertices, std::vector<unsigned int> &indices, int size)
+{
+	for (int y = 0; y <= size; y++)
+		for (int x = 0; x <= size; x++)
+			vertices.push_back(CVector(float(x), float(y), float((x * 7 + y * 3) % 11)));
+	for (int y = 0; y < size; y++)
+		for (int x = 0; x < size; x++)
+		{
+			unsigned int a = y * (size + 1) + x, b = a + 1, c = a + size + 1, d = c + 1;
+			unsigned int quad[6] = {a, b, d, a, d, c};
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+}
+
+static void TestRays(const BVH &bvh, const char *name, const std::vector<float> (&origin)[3], const std::vector<float> (&direction)[3])
+{
+	int count = int(origin[0].size());
+	std::vector<float> maxDistance(count, 100.0f);
+	std::vector<BVHHit> hits(count);
+	M3DRaySoA rays = {{&origin[0][0], &origin[1][0], &origin[2][0]}, {&direction[0][0], &direction[1][0], &direction[2][0]}};
+	bvh.Intersect(&hits[0], rays, &maxDistance[0], count);
+
+	int wrong = 0;
+	for (int i = 0; i < count; i++)
+	{
+		M3DVector3f o = {origin[0][i], origin[1][i], origin[2][i]};
+		M3DVector3f d = {direction[0][i], direction[1][i], direction[2][i]};
+		BVHHit hit;
+		bool found = bvh.Intersect(hit, o, d, maxDistance[i]);
+		bool same = found == (hits[i].distance >= 0.0f) && (!found || fabs(hit.distance - hits[i].distance) < 1e-4f);
+		Check(!found || bvh.Occluded(o, d, maxDistance[i]), "Occluded misses a hit", i);
+		wrong += same ? 0 : 1;
+	}
+	if (wrong != 0)
+		printf("%s: %d of %d packet rays differ from single rays\n", name, wrong, count);
+	Check(wrong == 0, "packet and single ray hits differ", name);
+}
+
+int main()
+{
+	const int size = 40;
+	std::vector<CVector> vertices;
+	std::vector<unsigned int> indices;
+	BuildTerrain(vertices, indices, size);
+	BVH bvh;
+	bvh.Build(&vertices[0], &indices[0], int(indices.size() / 3));
+
+	// Straight down from the integer points and from the cell centres, and
+	// along x and y from integer heights and positions
+	std::vector<float> origin[3], direction[3];
+	for (int y = 0; y <= size; y++)
+		for (int x = 0; x <= size; x++)
+			for (int half = 0; half < 2; half++)
+			{
+				float o[3] = {float(x) + 0.5f * half, float(y) + 0.5f * half, 20.0f};
+				float d[3] = {0.0f, 0.0f, -1.0f};
+				for (int k = 0; k < 3; k++)
+				{
+					origin[k].push_back(o[k]);
+					direction[k].push_back(d[k]);
+				}
+			}
+	TestRays(bvh, "down", origin, direction);
+
+	for (int k = 0; k < 3; k++)
+	{
+		origin[k].clear();
+		direction[k].clear();
+	}
+	for (int z = 0; z <= 10; z++)
+		for (int i = 0; i <= size; i++)
+			for (int axis = 0; axis < 2; axis++)
+			{
+				float o[3] = {axis == 0 ? -1.0f : float(i), axis == 0 ? float(i) : -1.0f, float(z)};
+				float d[3] = {axis == 0 ? 1.0f : 0.0f, axis == 0 ? 0.0f : 1.0f, 0.0f};
+				for (int k = 0; k < 3; k++)
+				{
+					origin[k].push_back(o[k]);
+					direction[k].push_back(d[k]);
+				}
+			}
+	TestRays(bvh, "level", origin, direction);
+
+	return TestResult("TestBVH");
+}
@@ -0,0 +1,61 @@
+#ifndef TESTCOMMON_H
+#define TESTCOMMON_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+//---------------------------------------------------------------------------
+// Shared by the test and benchmark programs in this directory, one program
+// per file, built by its Makefile. A test counts the checks that fail and
+// returns TestResult from main, nonzero if any did.
+
+static int testFailures = 0;
+
+// Report what failed, for a numbered or a named case
+inline void Check(bool ok, const char *what, int i)
+{
+	if (!ok)
+	{
+		printf("FAIL %s, case %d\n", what, i);
+		testFailures++;
+	}
+}
+
+inline void Check(bool ok, const char *what, const char *name)
+{
+	if (!ok)
+	{
+		printf("FAIL %s, %s\n", what, name);
+		testFailures++;
+	}
+}
+
+inline int TestResult(const char *test)
+{
+	if (testFailures == 0)
+		printf("%s passed\n", test);
+	else
+		printf("%s: %d failures\n", test, testFailures);
+	return testFailures == 0 ? 0 : 1;
+}
+
+// Uniform in [-1, 1]
+inline float Random()
+{
+	return float(rand()) / float(RAND_MAX) * 2.0f - 1.0f;
+}
+
+// Wall clock time with OpenMP, processor time without
+inline double Seconds()
+{
+#ifdef _OPENMP
+	return omp_get_wtime();
+#else
+	return double(clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+#endif // TESTCOMMON_H
@@ -0,0 +1,98 @@
+// Convex shapes posed by a matrix must sit where the matrix puts them:
+// support points against mat * local point, and a sphere inside a rotated
+// box must penetrate it. Two dense sphere hulls overlapping deeply must
+// report a depth no larger than the spheres' and a normal along the offset.
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include "Convex.h"
+#include "Matrix.h"
+#include "TestCommon.h"
+
+// Upper 3x3 block of mat, transposed, applied to v
+static CVector TransposeRotate(const Matrix &mat, const CVector &v)
+{
+	const float *m = mat.m_data;
+	return CVector(m[0] * v.x + m[1] * v.y + m[2] * v.z,
+				   m[4] * v.x + m[5] * v.y + m[6] * v.z,
+				   m[8] * v.x + m[9] * v.y + m[10] * v.z);
+}
+
+int main()
+{
+	Matrix poses[3];
+	poses[0] = Matrix::RotationMatrix(45.0, CVector(0, 0, 1));
+	poses[1] = Matrix::TranslationMatrix(CVector(1.0f, -2.0f, 0.5f)) * Matrix::RotationMatrix(70.0, CVector(1, 2, 3));
+	poses[2] = Matrix::TranslationMatrix(CVector(-3.0f, 0.0f, 4.0f)) * Matrix::RotationMatrix(160.0, CVector(0, 1, 0));
+	CVector directions[4] = {CVector(1, 0, 0), CVector(0.3f, -0.8f, 0.5f), CVector(-1, -1, 1), CVector(0, 0.2f, -1)};
+
+	for (int p = 0; p < 3; p++)
+	{
+		const Matrix &mat = poses[p];
+		ConvexShape box = ConvexShape::Box(CVector(2.0f, 0.1f, 0.1f));
+		box.SetTransform(mat);
+
+		// The world support point along d is mat * (local support along
+		// the direction taken back into the local frame)
+		for (int d = 0; d < 4; d++)
+		{
+			CVector local = box.LocalSupport(TransposeRotate(mat, directions[d]));
+			CVector expected = mat * local;
+			CVector world = box.position + box.rotation.RotateVector(local);
+			Check((world - expected).Length() < 1e-4f, "support point is not mat * local point", 4 * p + d);
+		}
+
+		// A small sphere near the end of the long box axis is inside
+		ConvexShape sphere = ConvexShape::Sphere(0.05f);
+		sphere.SetTransform(mat * CVector(1.9f, 0.0f, 0.0f), Quaternion());
+		ConvexResult result;
+		float distance = ConvexDistance(result, box, sphere);
+		Check(fabs(distance + 0.15f) < 1e-3f, "sphere inside the box does not penetrate it", p);
+
+		// And one just past the end is 0.05 away
+		sphere.SetTransform(mat * CVector(2.1f, 0.0f, 0.0f), Quaternion());
+		distance = ConvexDistance(result, box, sphere);
+		Check(fabs(distance - 0.05f) < 1e-3f, "sphere past the end is at the wrong distance", p);
+	}
+
+	// Points on the unit sphere: the hull lies inside the sphere, so its
+	// depth is at most 2 - |offset| and is separated along the offset
+	const int pointCount = 20000;
+	std::vector<CVector> points(pointCount);
+	srand(7);
+	for (int i = 0; i < pointCount; i++)
+	{
+		CVector v;
+		do
+			v = CVector(Random(), Random(), Random());
+		while (v.Length() < 0.1f || v.Length() > 1.0f);
+		points[i] = v / v.Length();
+	}
+	ConvexShape a = ConvexShape::Hull(&points[0], pointCount, 0.0f);
+	ConvexShape b = ConvexShape::Hull(&points[0], pointCount, 0.0f);
+	for (int i = 0; i < 40; i++)
+	{
+		CVector axis(Random(), Random(), Random());
+		if (axis.Length() < 0.1f)
+			axis = CVector(0, 0, 1);
+		axis = axis / axis.Length();
+		float length = 0.05f + 0.04f * i;
+		CVector offset = axis * length;
+		a.SetTransform(CVector(0, 0, 0), Quaternion());
+		b.SetTransform(offset, Quaternion());
+		ConvexResult result;
+		float distance = ConvexDistance(result, a, b);
+		Check(-distance <= 2.0f - length + 1e-3f, "deep overlap is deeper than the spheres", i);
+		Check(result.normal.DotProduct(axis) > 0.0f, "deep overlap normal points back", i);
+
+		// Near the centre every direction is almost as shallow, so only
+		// larger offsets pin the depth and normal down
+		if (length > 0.5f)
+		{
+			Check(-distance >= 2.0f - length - 5e-3f, "deep overlap is too shallow", i);
+			Check(result.normal.DotProduct(axis) > 0.99f, "deep overlap normal is not along the offset", i);
+		}
+	}
+
+	return TestResult("TestConvex");
+}
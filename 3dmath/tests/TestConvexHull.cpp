@@ -0,0 +1,91 @@
+// Convex hulls of point clouds must be closed 2-manifolds with
+// V - E + F = 2, and hold every input point within epsilon.
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <map>
+#include <utility>
+#include <vector>
+#include "ConvexHull.h"
+#include "TestCommon.h"
+
+static void TestHull(const char *cloud, const std::vector<CVector> &points, float slack)
+{
+	ConvexHull hull;
+	Check(hull.Build(&points[0], int(points.size())), "Build failed", cloud);
+	const int *triangles = hull.GetTriangles();
+	int faces = hull.GetTriangleCount();
+
+	// Every directed edge once, and its reverse once: closed and oriented
+	std::map<std::pair<int, int>, int> edges;
+	for (int f = 0; f < faces; f++)
+		for (int k = 0; k < 3; k++)
+			edges[std::make_pair(triangles[3 * f + k], triangles[3 * f + (k + 1) % 3])]++;
+	bool manifold = true;
+	for (std::map<std::pair<int, int>, int>::const_iterator e = edges.begin(); e != edges.end(); ++e)
+	{
+		std::map<std::pair<int, int>, int>::const_iterator twin = edges.find(std::make_pair(e->first.second, e->first.first));
+		manifold = manifold && e->second == 1 && twin != edges.end() && twin->second == 1;
+	}
+	Check(manifold, "not a closed oriented manifold", cloud);
+
+	// The triangles use exactly the hull vertices
+	std::vector<bool> used(points.size(), false), vertex(points.size(), false);
+	for (int i = 0; i < 3 * faces; i++)
+		used[triangles[i]] = true;
+	for (int i = 0; i < hull.GetVertexCount(); i++)
+		vertex[hull.GetVertices()[i]] = true;
+	Check(used == vertex, "triangles and vertices differ", cloud);
+
+	int v = hull.GetVertexCount(), e = int(edges.size() / 2);
+	Check(v - e + faces == 2, "Euler characteristic is not 2", cloud);
+
+	// Every point below every face plane, within epsilon
+	float worst = 0.0f;
+	for (int f = 0; f < faces; f++)
+	{
+		const CVector &a = points[triangles[3 * f]], &b = points[triangles[3 * f + 1]], &c = points[triangles[3 * f + 2]];
+		CVector normal = ((b - a) ^ (c - a)).UnitVector();
+		for (size_t i = 0; i < points.size(); i++)
+		{
+			float d = normal % (points[i] - a);
+			worst = d > worst ? d : worst;
+		}
+	}
+	Check(worst <= slack * hull.GetEpsilon(), "points outside the hull", cloud);
+	printf("%-6s %6d points  %5d vertices  %5d triangles  worst %.2f epsilon\n", cloud, int(points.size()), v, faces, worst / hull.GetEpsilon());
+}
+
+int main()
+{
+	const int count = 20000;
+	std::vector<CVector> cube, ball, shell, grid;
+	srand(1);
+	while (int(cube.size()) < count)
+		cube.push_back(CVector(Random(), Random(), Random()));
+	while (int(ball.size()) < count)
+	{
+		CVector p(Random(), Random(), Random());
+		if (p % p <= 1.0f)
+			ball.push_back(p * 10.0f + CVector(100.0f, -50.0f, 20.0f));
+	}
+	while (int(shell.size()) < 2000)
+	{
+		CVector p(Random(), Random(), Random());
+		if (p % p > 0.01f && p % p <= 1.0f)
+			shell.push_back(p.UnitVector());
+	}
+	// Coplanar points and duplicates on the faces of a cube
+	for (int x = 0; x <= 10; x++)
+		for (int y = 0; y <= 10; y++)
+			for (int z = 0; z <= 10; z++)
+				for (int copy = 0; copy < 2; copy++)
+					grid.push_back(CVector(float(x), float(y), float(z)));
+
+	TestHull("cube", cube, 1.0f);
+	TestHull("ball", ball, 1.0f);
+	TestHull("shell", shell, 1.0f);
+	TestHull("grid", grid, 1.0f);
+
+	return TestResult("TestConvexHull");
+}
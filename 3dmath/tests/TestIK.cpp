@@ -0,0 +1,56 @@
+// Two bone IK: bent and straight limbs must reach the target with the
+// middle joint on the side of the pole.
+#include <stdio.h>
+#include <math.h>
+#include "IK.h"
+#include "TestCommon.h"
+
+// Solve, then pose the limb with the deltas and check it
+static void TestLimb(int i, const CVector &root, const CVector &mid, const CVector &end, const CVector &target, const CVector &pole)
+{
+	Quaternion rootDelta, midDelta;
+	bool reached = SolveTwoBoneIK(rootDelta, midDelta, root, mid, end, target, pole);
+	Check(reached, "target not reached", i);
+
+	CVector newMid = root + rootDelta.RotateVector(mid - root);
+	CVector newEnd = newMid + midDelta.RotateVector(end - mid);
+	float scale = (mid - root).Length() + (end - mid).Length();
+	Check((newEnd - target).Length() < 1e-4f * scale, "end is off the target", i);
+	Check(fabs((newMid - root).Length() - (mid - root).Length()) < 1e-4f * scale, "upper bone changed length", i);
+
+	// Middle joint and pole on the same side of the root to target line
+	CVector axis = (target - root).UnitVector();
+	CVector knee = newMid - root, toPole = pole - root;
+	knee -= axis * (axis % knee);
+	toPole -= axis * (axis % toPole);
+	Check(knee % toPole > 0.0f, "middle joint does not face the pole", i);
+	Check((knee ^ toPole).Length() < 1e-3f * knee.Length() * toPole.Length(), "middle joint off the pole plane", i);
+}
+
+int main()
+{
+	CVector root(1.3f, 0.6f, -0.7f);
+	CVector pole(3.0f, -4.0f, 8.0f);
+	// Directions for which the cross product of the straight bones is noise
+	// well off the perpendicular of the limb, and an exactly straight one
+	CVector dirs[4] = {CVector(0.340525955f, 0.118443809f, 0.93274498f), CVector(-0.683255613f, -0.202165812f, -0.701634288f),
+					   CVector(-0.613026142f, -0.590676308f, 0.524690807f), CVector(0.0f, 0.0f, 1.0f)};
+
+	for (int i = 0; i < 4; i++)
+	{
+		CVector dir = dirs[i].UnitVector();
+		CVector side = (dir ^ CVector(0.2f, 0.9f, -0.4f)).UnitVector();
+		CVector target = root + (dir * 0.8f + side * 0.9f);
+
+		// Straight: the cross product of the bones is rounding noise only
+		CVector mid = root + dir * 1.3f;
+		CVector end = mid + dir * 0.7f;
+		TestLimb(i, root, mid, end, target, root + pole);
+
+		// Bent away from the pole
+		mid = root + dir * 1.3f - side * 0.2f;
+		TestLimb(4 + i, root, mid, end, target, root + pole);
+	}
+
+	return TestResult("TestIK");
+}
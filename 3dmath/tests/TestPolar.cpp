@@ -0,0 +1,107 @@
+// Polar decomposition: the float, double and batch versions and the Matrix
+// and Matrix33 wrappers must agree, for proper and mirroring matrices.
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "math3d.h"
+#include "math3dBatch.h"
+#include "Matrix.h"
+#include "Matrix33.h"
+#include "Vector.h"
+#include "Quaternion.h"
+#include "TestCommon.h"
+
+static float Distance(const float *a, const float *b)
+{
+	float d = 0.0f;
+	for (int k = 0; k < 9; k++)
+		d += (a[k] - b[k]) * (a[k] - b[k]);
+	return sqrtf(d);
+}
+
+static float Determinant(const float *m)
+{
+	return m[0] * (m[4] * m[8] - m[5] * m[7]) - m[3] * (m[1] * m[8] - m[2] * m[7]) + m[6] * (m[1] * m[5] - m[2] * m[4]);
+}
+
+int main()
+{
+	const int count = 1000;
+	const float eps = 1e-4f;
+	M3DMatrix33f *a = new M3DMatrix33f[count];
+	M3DMatrix33f *r = new M3DMatrix33f[count];
+	M3DMatrix33f *s = new M3DMatrix33f[count];
+
+	srand(1);
+	for (int i = 0; i < count; i++)
+	{
+		for (int k = 0; k < 9; k++)
+			a[i][k] = Random();
+		// Every other matrix mirrors
+		if ((Determinant(a[i]) < 0.0f) != (i % 2 == 1))
+			for (int k = 0; k < 3; k++)
+				a[i][k] = -a[i][k];
+	}
+	m3dPolarDecomposeMatrices33(r, s, a, count);
+
+	for (int i = 0; i < count; i++)
+	{
+		M3DMatrix33f rf, sf;
+		M3DMatrix33d ad, rd, sd;
+		m3dPolarDecompose33(rf, sf, a[i]);
+		for (int k = 0; k < 9; k++)
+			ad[k] = a[i][k];
+		m3dPolarDecompose33(rd, sd, ad);
+
+		M3DMatrix33f rdf, sdf;
+		for (int k = 0; k < 9; k++)
+		{
+			rdf[k] = float(rd[k]);
+			sdf[k] = float(sd[k]);
+		}
+		Check(Distance(rf, rdf) < eps && Distance(sf, sdf) < eps, "float and double differ", i);
+		Check(Distance(r[i], rdf) < eps && Distance(s[i], sdf) < eps, "batch and double differ", i);
+		Check(fabsf(Determinant(rf) - 1.0f) < eps, "not a rotation", i);
+
+		M3DMatrix33f rs;
+		m3dMatrixMultiply33(rs, rf, sf);
+		Check(Distance(rs, a[i]) < eps, "r * s is not a", i);
+
+		// r is the closest rotation: no small turn of it gets nearer to a
+		float best = Distance(rf, a[i]);
+		for (int axis = 0; axis < 3; axis++)
+			for (int sign = -1; sign <= 1; sign += 2)
+			{
+				M3DMatrix33f turn, turned;
+				M3DMatrix44f turn44;
+				m3dRotationMatrix44(turn44, sign * 0.01f, axis == 0, axis == 1, axis == 2);
+				m3dExtractRotation(turn, turn44);
+				m3dMatrixMultiply33(turned, rf, turn);
+				Check(Distance(turned, a[i]) >= best - 1e-6f, "r is not the closest rotation", i);
+			}
+
+		// The class wrappers
+		Matrix33 a33, r33, s33;
+		for (int k = 0; k < 9; k++)
+			a33.m_data[k] = a[i][k];
+		a33.DecomposePolar(r33, s33);
+		Check(Distance(r33.m_data, rf) < eps && Distance(s33.m_data, sf) < eps, "Matrix33 differs", i);
+
+		Matrix a44;
+		a44.LoadIdentity();
+		m3dInjectRotation(a44.m_data, a[i]);
+		CVector translation;
+		Quaternion rotation;
+		Matrix stretch;
+		a44.DecomposePolar(translation, rotation, stretch);
+		M3DMatrix33f rq, sq;
+		m3dExtractRotation(rq, Matrix::RotationMatrix(rotation).m_data);
+		m3dExtractRotation(sq, stretch.m_data);
+		Check(Distance(rq, rf) < eps && Distance(sq, sf) < eps, "Matrix differs", i);
+	}
+
+	delete[] a;
+	delete[] r;
+	delete[] s;
+	return TestResult("TestPolar");
+}
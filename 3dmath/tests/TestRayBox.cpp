@@ -0,0 +1,64 @@
+// m3dRayBoxTests must agree with AABB::IntersectRay, also for rays along an
+// axis that start on the planes of the boxes, at every batch size so the
+// AVX, SSE and scalar lanes are all run.
+#include <stdio.h>
+#include <float.h>
+#include <math.h>
+#include <vector>
+#include "BoundingBox.h"
+#include "math3dBatch.h"
+#include "TestCommon.h"
+
+int main()
+{
+	// Boxes on the unit grid, some flat
+	std::vector<AABB> boxes;
+	for (int i = 0; i < 9; i++)
+	{
+		CVector lo(float(i % 3), float(i / 3 % 3), 0.0f);
+		boxes.push_back(AABB(lo, lo + CVector(1.0f, 1.0f, i == 4 ? 0.0f : 1.0f)));
+	}
+	std::vector<float> bounds[6];
+	for (size_t b = 0; b < boxes.size(); b++)
+		for (int k = 0; k < 3; k++)
+		{
+			bounds[k].push_back((&boxes[b].min.x)[k]);
+			bounds[3 + k].push_back((&boxes[b].max.x)[k]);
+		}
+	M3DBoxSoA soa = {{&bounds[0][0], &bounds[1][0], &bounds[2][0]}, {&bounds[3][0], &bounds[4][0], &bounds[5][0]}};
+
+	// Origins on the half grid, outside and on the planes, directions along
+	// the axes both ways, including -0 components
+	int ray = 0;
+	for (int x = -1; x <= 7; x++)
+		for (int y = -1; y <= 7; y++)
+			for (int z = -2; z <= 4; z += 2)
+				for (int d = 0; d < 6; d++, ray++)
+				{
+					M3DVector3f origin = {0.5f * x, 0.5f * y, z < 0 ? 5.0f : 0.5f * z};
+					M3DVector3f direction = {0.0f, d % 3 == 1 ? -0.0f : 0.0f, 0.0f};
+					direction[d / 2] = d % 2 == 0 ? 1.0f : -1.0f;
+
+					for (int count = 1; count <= int(boxes.size()); count++)
+					{
+						float distance[16];
+						m3dRayBoxTests(distance, origin, direction, soa, count);
+						for (int b = 0; b < count; b++)
+						{
+							float expected;
+							bool hit = boxes[b].IntersectRay(expected, CVector(origin[0], origin[1], origin[2]),
+															 CVector(direction[0], direction[1], direction[2]), FLT_MAX);
+							bool same = hit ? fabs(distance[b] - expected) < 1e-5f : distance[b] < 0.0f;
+							Check(same, "batch and AABB::IntersectRay differ", ray);
+						}
+					}
+				}
+
+	// The reported case: straight down onto the unit box from the x = 0 plane
+	M3DVector3f origin = {0.0f, 0.5f, 5.0f}, down = {0.0f, 0.0f, -1.0f};
+	float distance[8];
+	m3dRayBoxTests(distance, origin, down, soa, 8);
+	Check(fabs(distance[0] - 4.0f) < 1e-5f, "ray down the face of the unit box misses", 0);
+
+	return TestResult("TestRayBox");
+}